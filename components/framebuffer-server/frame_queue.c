@@ -3,17 +3,19 @@
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "instrumentation_interface.h"
+#include "perf_trace.h"
+#include "perf_clock.h"
 
 void frame_queue_init(frame_queue_t *q) {
     memset(q, 0, sizeof(*q));
     for (int i = 0; i < FRAME_QUEUE_DEPTH; i++) {
         // Use PSRAM for frame buffers to save internal memory
-        q->frames[i] = heap_caps_malloc(FRAME_SIZE + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT | MALLOC_CAP_DMA);
+        q->frames[i] = heap_caps_malloc(FRAME_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT | MALLOC_CAP_DMA);
         if (q->frames[i] == NULL) {
             ESP_LOGE("frame_queue", "Failed to allocate frame buffer %d in PSRAM, falling back to internal memory", i);
-            q->frames[i] = heap_caps_malloc(FRAME_SIZE + 1, MALLOC_CAP_8BIT | MALLOC_CAP_DMA);
+            q->frames[i] = heap_caps_malloc(FRAME_BUFFER_SIZE, MALLOC_CAP_8BIT | MALLOC_CAP_DMA);
         } else {
-            instrumentation_psram_write_operation(FRAME_SIZE + 1);
+            instrumentation_psram_write_operation(FRAME_BUFFER_SIZE);
         }
     }
 }
@@ -24,22 +26,58 @@ uint8_t *frame_queue_get_write_buffer(frame_queue_t *q) {
 }
 
 void frame_queue_submit_frame(frame_queue_t *q) {
+    frame_queue_submit_frame_size(q, FRAME_SIZE + 1);
+}
+
+void frame_queue_submit_frame_size(frame_queue_t *q, size_t size) {
+    q->sizes[q->write_index] = size;
     q->write_index = (q->write_index + 1) % FRAME_QUEUE_DEPTH;
     q->count++;
+    PERF_TRACE_INSTANT(PERF_TRACE_FRAME_SUBMIT, q->count);
+    PERF_TRACE_COUNTER(PERF_TRACE_FRAME_QUEUE_DEPTH, q->count);
     
     // Track PSRAM write operation for frame submission
-    instrumentation_psram_write_operation(FRAME_SIZE);
+    instrumentation_psram_write_operation(size);
 }
 
 uint8_t *frame_queue_get_next_frame(frame_queue_t *q) {
     if (q->count == 0) return NULL;
+    if (q->send_start_us == 0) {
+        q->send_start_us = (uint32_t)perf_now_us() | 1;
+    }
     
     // Track PSRAM read operation for frame retrieval
-    instrumentation_psram_read_operation(FRAME_SIZE);
+    instrumentation_psram_read_operation(q->sizes[q->read_index]);
     return q->frames[q->read_index];
 }
 
+size_t frame_queue_next_frame_size(frame_queue_t *q) {
+    return q->sizes[q->read_index];
+}
+
 void frame_queue_release_frame(frame_queue_t *q) {
+    if (q->send_start_us) {
+        // 1/8 weight EWMA of the time from pickup to release
+        uint32_t held = (uint32_t)perf_now_us() - q->send_start_us;
+        q->send_avg_us = q->send_avg_us ? q->send_avg_us - (q->send_avg_us >> 3) + (held >> 3) : held;
+        q->send_start_us = 0;
+    }
     q->read_index = (q->read_index + 1) % FRAME_QUEUE_DEPTH;
     q->count--;
+    PERF_TRACE_INSTANT(PERF_TRACE_FRAME_RELEASE, q->count);
+    PERF_TRACE_COUNTER(PERF_TRACE_FRAME_QUEUE_DEPTH, q->count);
+}
+
+uint32_t frame_queue_sender_ready_in_us(frame_queue_t *q) {
+    int count = q->count;
+    if (count == 0) return 0;
+
+    uint32_t avg = q->send_avg_us;
+    uint32_t start = q->send_start_us;
+    uint32_t remaining = avg;
+    if (start) {
+        uint32_t held = (uint32_t)perf_now_us() - start;
+        remaining = held < avg ? avg - held : 0;
+    }
+    return remaining + (uint32_t)(count - 1) * avg;
 }
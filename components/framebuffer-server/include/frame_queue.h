@@ -8,15 +8,32 @@
 #define FRAME_SIZE   (FRAME_WIDTH * FRAME_HEIGHT)
 #define FRAME_QUEUE_DEPTH 3
 
+// A slot holds a raw frame (palette byte + FRAME_SIZE) or a typed frame
+// message with a header of up to 16 bytes, then optionally the frame's draw
+// list (WS_MSG_DRAW) as a trailer
+#define FRAME_TRAILER_SIZE 2048
+#define FRAME_BUFFER_SIZE (FRAME_SIZE + 16 + FRAME_TRAILER_SIZE)
+
 typedef struct {
     uint8_t *frames[FRAME_QUEUE_DEPTH];
+    size_t sizes[FRAME_QUEUE_DEPTH];
     volatile int write_index;
     volatile int read_index;
     volatile int count;
+    volatile uint32_t send_start_us;   // when the sender picked up the head frame, 0 if idle
+    volatile uint32_t send_avg_us;     // smoothed time the sender holds a frame
 } frame_queue_t;
 
 void frame_queue_init(frame_queue_t *q);
 uint8_t *frame_queue_get_write_buffer(frame_queue_t *q);
 void frame_queue_submit_frame(frame_queue_t *q);
+// Submit the first size bytes of the write buffer (at most FRAME_BUFFER_SIZE)
+void frame_queue_submit_frame_size(frame_queue_t *q, size_t size);
 uint8_t *frame_queue_get_next_frame(frame_queue_t *q);
+// Bytes in the frame frame_queue_get_next_frame returned
+size_t frame_queue_next_frame_size(frame_queue_t *q);
 void frame_queue_release_frame(frame_queue_t *q);
+
+// Estimated microseconds until the sender can take a newly submitted frame
+// (0 when the queue is empty). Used by the renderer to pace its output.
+uint32_t frame_queue_sender_ready_in_us(frame_queue_t *q);
@@ -26,6 +26,13 @@ typedef struct {
     int data3;    // y movement
 } input_event_t;
 
+// WebSocket message types for input
+#define WS_MSG_INPUT_KEYDOWN    0x01    // [type, browser key code]
+#define WS_MSG_INPUT_KEYUP      0x02    // [type, browser key code]
+#define WS_MSG_INPUT_MOUSE_MOVE 0x03
+#define WS_MSG_INPUT_MOUSE_BTN  0x04    // [type, button mask]
+#define WS_MSG_INPUT_JOYSTICK   0x05
+
 // Input handler configuration
 #define INPUT_QUEUE_SIZE 32
 #define INPUT_QUEUE_ITEM_SIZE sizeof(input_event_t)
@@ -10,8 +10,6 @@ extern "C" {
 // PSRAM bandwidth tracking functions
 void instrumentation_psram_read_operation(uint32_t bytes);
 void instrumentation_psram_write_operation(uint32_t bytes);
-void instrumentation_psram_cache_hit(void);
-void instrumentation_psram_cache_miss(void);
 
 // Network throughput tracking functions
 void instrumentation_network_sent_bytes(uint32_t bytes);
@@ -10,7 +10,7 @@ extern "C" {
 // WebSocket server configuration
 #define WS_PORT 8080
 #define MAX_HEADER 2048
-#define WS_MAX_CLIENTS 1
+#define WS_MAX_CLIENTS 3   // one player plus spectators
 #define WS_FRAME_BUFFER_SIZE 4096
 
 // Enable permessage-deflate support (optional)
@@ -24,6 +24,59 @@ extern "C" {
 #define WS_FRAME_PING         0x9
 #define WS_FRAME_PONG         0xA
 
+// Message types. Raw video frames are exactly FRAME_SIZE + 1 bytes and carry
+// no type byte; every other binary message starts with one.
+// Client -> server: 0x01-0x0F are input (see input_handler.c), 0x10+ control
+#define WS_MSG_STATS_SUBSCRIBE  0x10    // [type, enable]
+#define WS_MSG_AUDIO_SUBSCRIBE  0x11    // [type, enable]
+#define WS_MSG_VIEW_SELECT      0x12    // [type, stream, kind, arg] (kinds in r_views.h)
+// Server -> client
+#define WS_MSG_STATS            0x81    // [type, stats payload]
+#define WS_MSG_AUDIO            0x82    // [type, audio block] (see i_sound.c)
+#define WS_MSG_SOUND            0x83    // [type, sound event batch] (see i_sound.c)
+#define WS_MSG_MUSIC            0x84    // [type, music event batch] (see i_sound.c)
+#define WS_MSG_VIEW             0x85    // [type, stream, width(2), height(2), palette, pixels]
+#define WS_MSG_AUTOMAP          0x86    // [type, automap lines or frame] (see am_map.c)
+#define WS_MSG_LAYERS           0x87    // [type, palette, view rows(2), bar y(2), bar rows(2), view pixels, bar pixels]
+#define WS_MSG_DRAW             0x88    // [type, draw list] (see v_video.c), only as a main frame's trailer
+#define WS_MSG_ROLE             0x89    // [type, stream, player] stream the client watches, 1 if it plays
+
+// Sound and music only go to clients that sent WS_MSG_AUDIO_SUBSCRIBE
+#define WS_MSG_IS_AUDIO(type) ((type) >= WS_MSG_AUDIO && (type) <= WS_MSG_MUSIC)
+
+// Messages that belong to the main view are not sent to spectators. A main
+// frame (raw or WS_MSG_LAYERS) may be followed by its draw list in the same
+// message, so the two are always shown together.
+#define WS_MSG_IS_MAIN_VIEW(type) ((type) == WS_MSG_AUTOMAP || (type) == WS_MSG_DRAW)
+
+// Typed messages queued by other tasks; the server task sends each one whole
+// between video frames, so producers never touch the sockets themselves
+#define WS_OUT_QUEUE_SIZE 8192
+
+// Spectator view streams, numbered from 1; stream 0 is the main view. Only
+// the player watches stream 0, and only its input reaches the game. The
+// first client becomes the player; the others start on stream 1 and can
+// claim stream 0 once the player leaves it. A client watching a spectator
+// stream gets no main frames.
+#define WS_VIEW_STREAMS 2
+#define WS_VIEW_DEFAULT_KIND 2  // chase (r_views.h), for a stream nobody set up yet
+#define WS_VIEW_HEADER 7
+
+// Layered main frames: the rows above the status bar, then the status bar
+// rows only when they changed (bar rows 0 otherwise). Sent through the frame
+// queue like raw frames.
+#define WS_LAYERS_HEADER 8
+
+// Called from the server task when a client points a stream at a viewpoint
+typedef void (*websocket_view_handler_t)(int slot, int kind, int arg);
+
+// Live stats stream
+#define WS_STATS_INTERVAL_MS 1000
+#define WS_STATS_MAX_SIZE 128
+
+// Fills buf with a stats payload (without the type byte); returns its length, 0 to skip
+typedef size_t (*websocket_stats_provider_t)(uint8_t *buf, size_t len);
+
 // Permessage-deflate configuration
 #define WS_DEFLATE_WINDOW_BITS 15
 #define WS_DEFLATE_MEM_LEVEL 8
@@ -45,6 +98,12 @@ typedef struct {
     size_t inflate_buffer_size;
     mz_stream *deflate_stream;
     mz_stream *inflate_stream;
+    int stats_subscribed;
+    int audio_subscribed;
+    int view;   // stream the client watches, 0 for the main view
+    int player; // its input drives the game; only ever one client
+    uint8_t held_keys[32];  // browser key codes down, released if it stops playing
+    uint8_t held_buttons;   // mouse button mask down
 } websocket_client_t;
 
 // WebSocket server state
@@ -64,6 +123,28 @@ int websocket_send_binary_frame(int client_fd, const uint8_t *data, size_t len);
 int websocket_send_text_frame(int client_fd, const char *text);
 int websocket_send_ping(int client_fd);
 int websocket_send_close(int client_fd, uint16_t code);
+void websocket_server_set_stats_provider(websocket_stats_provider_t provider);
+
+// Queue a typed message for every client that wants it. Safe from any task.
+// Returns 0 if queued, -1 if nobody listens or the queue is full.
+int websocket_server_queue_message(const uint8_t *data, size_t len);
+
+// Number of connected clients that subscribed to sound
+int websocket_server_audio_listeners(void);
+
+void websocket_server_set_view_handler(websocket_view_handler_t handler);
+
+// Number of connected clients watching stream
+int websocket_server_view_watchers(int stream);
+
+// Hand over a finished width x height view for stream. Never blocks: while
+// the previous view is still being sent this one is dropped. Returns 0 if
+// stored, -1 if dropped.
+int websocket_server_publish_view(int stream, uint8_t palette, const uint8_t *pixels,
+                                  int width, int height);
+
+// Views dropped by websocket_server_publish_view since startup
+unsigned int websocket_server_views_dropped(void);
 
 // Permessage-deflate functions (only available if WS_ENABLE_PERMESSAGE_DEFLATE is defined)
 #if WS_ENABLE_PERMESSAGE_DEFLATE
@@ -3,19 +3,13 @@
 #include <esp_log.h>
 #include <esp_err.h>
 #include "input_handler.h"
+#include "perf_trace.h"
 
 #define TAG "input_handler"
 
 // Global input queue
 static QueueHandle_t g_input_queue = NULL;
 
-// WebSocket message types for input
-#define WS_MSG_INPUT_KEYDOWN    0x01
-#define WS_MSG_INPUT_KEYUP      0x02
-#define WS_MSG_INPUT_MOUSE_MOVE 0x03
-#define WS_MSG_INPUT_MOUSE_BTN  0x04
-#define WS_MSG_INPUT_JOYSTICK   0x05
-
 // DOOM key codes (from doomdef.h)
 #define KEYD_RIGHTARROW 0xae
 #define KEYD_LEFTARROW  0xac
@@ -88,6 +82,7 @@ int input_handler_process_websocket_message(const uint8_t *data, size_t len) {
     }
     
     uint8_t msg_type = data[0];
+    PERF_TRACE_INSTANT(PERF_TRACE_INPUT_RECV, msg_type);
    
     input_event_t event = {0};
     
@@ -13,14 +13,6 @@ void instrumentation_psram_write_operation(uint32_t bytes) {
     (void)bytes;
 }
 
-void instrumentation_psram_cache_hit(void) {
-    // Stub implementation - will be overridden by main instrumentation
-}
-
-void instrumentation_psram_cache_miss(void) {
-    // Stub implementation - will be overridden by main instrumentation
-}
-
 void instrumentation_network_sent_bytes(uint32_t bytes) {
     // Stub implementation - will be overridden by main instrumentation
     (void)bytes;
@@ -14,6 +14,7 @@
 #include <freertos/task.h>
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
+#include <freertos/ringbuf.h>
 #include <mbedtls/base64.h>
 #include <mbedtls/sha1.h>
 #include "websocket_server.h"
@@ -23,50 +24,45 @@
 #include "input_handler.h"
 #include "instrumentation_interface.h"
 #include "esp_timer.h"
+#include "perf_trace.h"
+#include "perf_histogram.h"
+#include "perf_counters.h"
 
 #define TAG "ws_server"
 
-// WebSocket profiling structures
-typedef struct {
-    uint32_t total_operations;
-    uint32_t total_time_us;
-    uint32_t min_time_us;
-    uint32_t max_time_us;
-    uint32_t avg_time_us;
-    uint32_t last_operation_time;
-} websocket_profile_stats_t;
-
-// Global profiling stats
-static websocket_profile_stats_t handshake_stats = {0};
-static websocket_profile_stats_t compression_stats = {0};
-static websocket_profile_stats_t frame_send_stats = {0};
-static websocket_profile_stats_t frame_recv_stats = {0};
-static websocket_profile_stats_t deflate_stats = {0};
+// WebSocket profiling: per-operation latency histograms (microseconds).
+// Windows are rolled by the periodic instrumentation report.
+static PERF_HISTOGRAM_ATTR perf_latency_t handshake_stats;
+static PERF_HISTOGRAM_ATTR perf_latency_t compression_stats;
+static PERF_HISTOGRAM_ATTR perf_latency_t frame_send_stats;
+static PERF_HISTOGRAM_ATTR perf_latency_t frame_recv_stats;
+static PERF_HISTOGRAM_ATTR perf_latency_t deflate_stats;
 
 // Profiling helper functions
-static void update_profile_stats(websocket_profile_stats_t *stats, uint32_t operation_time_us) {
-    stats->total_operations++;
-    stats->total_time_us += operation_time_us;
-    stats->last_operation_time = operation_time_us;
-    
-    if (operation_time_us < stats->min_time_us || stats->min_time_us == 0) {
-        stats->min_time_us = operation_time_us;
-    }
-    if (operation_time_us > stats->max_time_us) {
-        stats->max_time_us = operation_time_us;
-    }
-    
-    stats->avg_time_us = stats->total_time_us / stats->total_operations;
+static void update_profile_stats(perf_latency_t *stats, uint32_t operation_time_us) {
+    perf_latency_record(stats, operation_time_us);
 }
 
-static void log_profile_stats(const char *operation, websocket_profile_stats_t *stats) {
-    if (stats->total_operations > 0) {
-        ESP_LOGI(TAG, "WebSocket %s Profile: ops=%u, avg=%uus, min=%uus, max=%uus, total=%uus",
-                 operation, stats->total_operations, stats->avg_time_us, 
-                 stats->min_time_us, stats->max_time_us, stats->total_time_us);
+static void register_profile_stats(void) {
+    perf_latency_register(&handshake_stats, "ws_handshake");
+    perf_latency_register(&compression_stats, "ws_compression");
+    perf_latency_register(&frame_send_stats, "ws_frame_send");
+    perf_latency_register(&frame_recv_stats, "ws_frame_recv");
+    perf_latency_register(&deflate_stats, "ws_deflate");
+}
+
+static void log_profile_stats(const char *operation, perf_latency_t *stats) {
+    perf_histogram_summary_t summary;
+    perf_histogram_summarize(&stats->lifetime, &summary);
+    if (summary.count > 0) {
+        ESP_LOGI(TAG, "WebSocket %s Profile: ops=%lu, mean=%luus, p50=%luus, p90=%luus, p99=%luus, p99.9=%luus, max=%luus",
+                 operation, (unsigned long)summary.count, (unsigned long)summary.mean,
+                 (unsigned long)summary.p50, (unsigned long)summary.p90, (unsigned long)summary.p99,
+                 (unsigned long)summary.p999, (unsigned long)summary.max);
     }
 }
 
+// Since-boot latency distribution of every WebSocket operation
 void log_all_websocket_profiles(void) {
     ESP_LOGI(TAG, "=== WEBSOCKET PROFILING REPORT ===");
     log_profile_stats("Handshake", &handshake_stats);
@@ -86,6 +82,26 @@ frame_queue_t g_frame_queue;
 // WebSocket server instance
 static websocket_server_t g_websocket_server;
 
+// Source of the live stats stream (set by the application, may be NULL)
+static websocket_stats_provider_t g_stats_provider = NULL;
+
+// Outgoing typed messages from other tasks (whole messages, never split)
+static RingbufHandle_t g_out_queue = NULL;
+
+// Spectator view streams: one message buffer each, filled by the renderer
+// and sent from the server task. The renderer only ever tries the lock, so a
+// send in progress costs it a dropped view, never a wait.
+typedef struct {
+    uint8_t *message;   // WS_VIEW_HEADER + up to FRAME_SIZE pixels, PSRAM
+    size_t len;
+    volatile int dirty;
+} ws_view_stream_t;
+
+static ws_view_stream_t g_views[WS_VIEW_STREAMS];
+static SemaphoreHandle_t g_view_lock = NULL;
+static websocket_view_handler_t g_view_handler = NULL;
+static volatile unsigned int g_views_dropped;
+
 // Function to compute base64 SHA1 for WebSocket handshake
 static void base64_sha1(const char *key, char *output, size_t output_len) {
     char combined[128];
@@ -369,6 +385,8 @@ int websocket_send_binary_frame(int client_fd, const uint8_t *data, size_t len)
     const uint8_t *frame_data = data;
     size_t frame_len = len;
     
+    PERF_TRACE_BEGIN(PERF_TRACE_SEND);
+    
     // Track PSRAM read operation for frame data
     instrumentation_psram_read_operation(len);
     
@@ -413,11 +431,13 @@ int websocket_send_binary_frame(int client_fd, const uint8_t *data, size_t len)
         
         if (nonblocking_send(client_fd, header, header_len, WS_SEND_TIMEOUT_MS) < 0) {
             ESP_LOGE(TAG, "Failed to send frame header");
+            PERF_TRACE_END(PERF_TRACE_SEND);
             return -1;
         }
         
         if (nonblocking_send(client_fd, frame_data + offset, chunk_size, WS_SEND_TIMEOUT_MS) < 0) {
             ESP_LOGE(TAG, "Failed to send frame data");
+            PERF_TRACE_END(PERF_TRACE_SEND);
             return -1;
         }
         
@@ -429,6 +449,8 @@ int websocket_send_binary_frame(int client_fd, const uint8_t *data, size_t len)
     uint64_t end_time = esp_timer_get_time();
     uint32_t operation_time_us = (uint32_t)(end_time - start_time);
     update_profile_stats(&frame_send_stats, operation_time_us);
+    PERF_TRACE_END(PERF_TRACE_SEND);
+    PERF_TRACE_COUNTER(PERF_TRACE_SEND_BYTES, len);
     
     return 0;
 }
@@ -674,7 +696,9 @@ int websocket_compress_frame(websocket_client_t *client, const uint8_t *input, s
     
     // Use the ws_deflate implementation which properly handles RFC 7692
     size_t compressed_len = *output_len;
+    PERF_TRACE_BEGIN(PERF_TRACE_COMPRESS);
     int result = ws_deflate_compress(input, input_len, client->deflate_buffer, &compressed_len, client->deflate_stream);
+    PERF_TRACE_END(PERF_TRACE_COMPRESS);
     
     if (result == 0) {
         // Only use compression if it actually reduces the size
@@ -726,8 +750,299 @@ int websocket_decompress_frame(websocket_client_t *client, const uint8_t *input,
 
 #endif
 
+// Register the source of the live stats stream
+void websocket_server_set_stats_provider(websocket_stats_provider_t provider) {
+    g_stats_provider = provider;
+}
+
+int websocket_server_audio_listeners(void) {
+    int listeners = 0;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        websocket_client_t *client = &g_websocket_server.clients[i];
+        if (client->fd >= 0 && client->active && client->audio_subscribed) {
+            listeners++;
+        }
+    }
+    return listeners;
+}
+
+void websocket_server_set_view_handler(websocket_view_handler_t handler) {
+    g_view_handler = handler;
+}
+
+int websocket_server_view_watchers(int stream) {
+    int watchers = 0;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        websocket_client_t *client = &g_websocket_server.clients[i];
+        if (client->fd >= 0 && client->active && client->view == stream) {
+            watchers++;
+        }
+    }
+    return watchers;
+}
+
+int websocket_server_publish_view(int stream, uint8_t palette, const uint8_t *pixels,
+                                  int width, int height) {
+    size_t pixels_len = (size_t)width * height;
+    ws_view_stream_t *view;
+    int result = -1;
+
+    if (stream < 1 || stream > WS_VIEW_STREAMS || pixels_len > FRAME_SIZE || g_view_lock == NULL) {
+        return -1;
+    }
+    if (xSemaphoreTake(g_view_lock, 0) != pdTRUE) {
+        g_views_dropped++;
+        return -1;
+    }
+
+    view = &g_views[stream - 1];
+    if (view->message == NULL) {
+        view->message = heap_caps_malloc(WS_VIEW_HEADER + FRAME_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (view->message) {
+        uint8_t *m = view->message;
+        m[0] = WS_MSG_VIEW;
+        m[1] = stream;
+        m[2] = width & 0xff;
+        m[3] = width >> 8;
+        m[4] = height & 0xff;
+        m[5] = height >> 8;
+        m[6] = palette;
+        memcpy(m + WS_VIEW_HEADER, pixels, pixels_len);
+        view->len = WS_VIEW_HEADER + pixels_len;
+        view->dirty = 1;
+        result = 0;
+    }
+    xSemaphoreGive(g_view_lock);
+    return result;
+}
+
+unsigned int websocket_server_views_dropped(void) {
+    return g_views_dropped;
+}
+
+int websocket_server_queue_message(const uint8_t *data, size_t len) {
+    if (g_out_queue == NULL || g_websocket_server.client_count == 0) {
+        return -1;
+    }
+    if (WS_MSG_IS_AUDIO(data[0]) && websocket_server_audio_listeners() == 0) {
+        return -1;
+    }
+    return xRingbufferSend(g_out_queue, data, len, 0) == pdTRUE ? 0 : -1;
+}
+
+// Send everything other tasks queued since the last pass
+static void send_queued_messages(websocket_server_t *server) {
+    size_t len;
+    uint8_t *message;
+
+    while ((message = xRingbufferReceive(g_out_queue, &len, 0)) != NULL) {
+        for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+            websocket_client_t *client = &server->clients[i];
+            if (client->fd < 0 || !client->active) {
+                continue;
+            }
+            if (WS_MSG_IS_AUDIO(message[0]) && !client->audio_subscribed) {
+                continue;
+            }
+            if (WS_MSG_IS_MAIN_VIEW(message[0]) && client->view != 0) {
+                continue;
+            }
+            if (websocket_send_binary_frame(client->fd, message, len) < 0) {
+                ESP_LOGW(TAG, "Failed to send queued message 0x%02x to client %d", message[0], i);
+            }
+        }
+        vRingbufferReturnItem(g_out_queue, message);
+    }
+}
+
+// Send each spectator view the renderer finished since the last pass
+static void send_views(websocket_server_t *server) {
+    for (int s = 0; s < WS_VIEW_STREAMS; s++) {
+        ws_view_stream_t *view = &g_views[s];
+        if (!view->dirty) {
+            continue;
+        }
+        xSemaphoreTake(g_view_lock, portMAX_DELAY);
+        for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+            websocket_client_t *client = &server->clients[i];
+            if (client->fd < 0 || !client->active || client->view != s + 1) {
+                continue;
+            }
+            if (websocket_send_binary_frame(client->fd, view->message, view->len) < 0) {
+                ESP_LOGW(TAG, "Failed to send view %d to client %d", s + 1, i);
+            }
+        }
+        view->dirty = 0;
+        xSemaphoreGive(g_view_lock);
+    }
+}
+
+// Keys and buttons the player holds, so giving up the game never leaves one down
+static void track_player_input(websocket_client_t *client, const uint8_t *payload, size_t len) {
+    if (len < 2) {
+        return;
+    }
+    switch (payload[0]) {
+        case WS_MSG_INPUT_KEYDOWN:
+            client->held_keys[payload[1] >> 3] |= 1 << (payload[1] & 7);
+            break;
+        case WS_MSG_INPUT_KEYUP:
+            client->held_keys[payload[1] >> 3] &= ~(1 << (payload[1] & 7));
+            break;
+        case WS_MSG_INPUT_MOUSE_BTN:
+            client->held_buttons = payload[1];
+            break;
+    }
+}
+
+// Post key-ups for everything the player still holds
+static void release_player_input(websocket_client_t *client) {
+    for (int key = 0; key < 256; key++) {
+        if (client->held_keys[key >> 3] & (1 << (key & 7))) {
+            const uint8_t up[2] = { WS_MSG_INPUT_KEYUP, (uint8_t)key };
+            input_handler_process_websocket_message(up, sizeof(up));
+        }
+    }
+    memset(client->held_keys, 0, sizeof(client->held_keys));
+    if (client->held_buttons) {
+        const uint8_t up[2] = { WS_MSG_INPUT_MOUSE_BTN, 0 };
+        input_handler_process_websocket_message(up, sizeof(up));
+        client->held_buttons = 0;
+    }
+}
+
+static websocket_client_t *find_player(websocket_server_t *server) {
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (server->clients[i].fd >= 0 && server->clients[i].player) {
+            return &server->clients[i];
+        }
+    }
+    return NULL;
+}
+
+// Tell a client which stream it watches and whether it plays
+static void send_role(websocket_client_t *client) {
+    const uint8_t role[3] = { WS_MSG_ROLE, (uint8_t)client->view, (uint8_t)client->player };
+    if (websocket_send_binary_frame(client->fd, role, sizeof(role)) < 0) {
+        ESP_LOGW(TAG, "Failed to send role to client %d", (int)(client - g_websocket_server.clients));
+    }
+}
+
+// Point a client at a stream. Stream 0 makes it the player if nobody else
+// is; otherwise it stays where it is. Leaving stream 0 gives up the game.
+static void select_view(websocket_client_t *client, int stream, int kind, int arg) {
+    if (stream == 0) {
+        if (!client->player && find_player(&g_websocket_server) == NULL) {
+            client->player = 1;
+        }
+        if (client->player) {
+            client->view = 0;
+        }
+    } else {
+        if (client->player) {
+            release_player_input(client);
+            client->player = 0;
+        }
+        client->view = stream;
+        if (g_view_handler) {
+            g_view_handler(stream - 1, kind, arg);
+        }
+    }
+    ESP_LOGI(TAG, "Client %d watching stream %d%s", (int)(client - g_websocket_server.clients),
+             client->view, client->player ? " as the player" : "");
+    send_role(client);
+}
+
+// Close a client, letting go of whatever it held if it was the player
+static void drop_client(websocket_server_t *server, websocket_client_t *client) {
+    if (client->player) {
+        release_player_input(client);
+        client->player = 0;
+    }
+    close(client->fd);
+    client->fd = -1;
+    client->active = 0;
+    server->client_count--;
+}
+
+// Route one client message: control messages are handled here, the rest is input
+static void handle_client_message(int client_fd, const uint8_t *payload, size_t len) {
+    websocket_client_t *client = NULL;
+
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (g_websocket_server.clients[i].fd == client_fd) {
+            client = &g_websocket_server.clients[i];
+            break;
+        }
+    }
+
+    if (len < 1) {
+        return;
+    }
+
+    // Control messages have a fixed size; shorter ones are dropped
+    if (payload[0] == WS_MSG_VIEW_SELECT) {
+        if (client && len >= 4 && payload[1] <= WS_VIEW_STREAMS) {
+            select_view(client, payload[1], payload[2], payload[3]);
+        }
+        return;
+    }
+
+    if (payload[0] == WS_MSG_AUDIO_SUBSCRIBE) {
+        if (client && len >= 2) {
+            client->audio_subscribed = payload[1];
+            ESP_LOGI(TAG, "Client %d audio stream %s", (int)(client - g_websocket_server.clients),
+                     client->audio_subscribed ? "on" : "off");
+        }
+        return;
+    }
+
+    if (payload[0] == WS_MSG_STATS_SUBSCRIBE) {
+        if (client && len >= 2) {
+            client->stats_subscribed = payload[1];
+            ESP_LOGI(TAG, "Client %d stats stream %s", (int)(client - g_websocket_server.clients),
+                     client->stats_subscribed ? "on" : "off");
+        }
+        return;
+    }
+
+    // Spectators watch, they do not play
+    if (client == NULL || !client->player) {
+        return;
+    }
+
+    track_player_input(client, payload, len);
+    input_handler_process_websocket_message(payload, len);
+}
+
+// Push one stats message to every subscribed client
+static void send_stats_to_subscribers(websocket_server_t *server) {
+    uint8_t message[WS_STATS_MAX_SIZE];
+    size_t len = 0;
+    
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        websocket_client_t *client = &server->clients[i];
+        if (client->fd < 0 || !client->active || !client->stats_subscribed) {
+            continue;
+        }
+        // Build lazily, once, only if somebody listens
+        if (len == 0) {
+            message[0] = WS_MSG_STATS;
+            len = g_stats_provider(message + 1, sizeof(message) - 1);
+            if (len == 0) {
+                return;
+            }
+            len += 1;
+        }
+        if (websocket_send_binary_frame(client->fd, message, len) < 0) {
+            ESP_LOGW(TAG, "Failed to send stats to client %d", i);
+        }
+    }
+}
+
 // Handle incoming WebSocket frames with non-blocking operations
-static int handle_ws_frame(int client_fd) {
+static int handle_ws_frame(int client_fd, int timeout_ms) {
     uint64_t start_time = esp_timer_get_time();
     
     // Use PSRAM for frame buffer to save internal memory
@@ -741,7 +1056,7 @@ static int handle_ws_frame(int client_fd) {
         }
     }
     
-    int len = nonblocking_recv(client_fd, buffer, WS_FRAME_BUFFER_SIZE, 100); // 100ms timeout
+    int len = nonblocking_recv(client_fd, buffer, WS_FRAME_BUFFER_SIZE, timeout_ms);
     
     if (len <= 0) {
         heap_caps_free(buffer);
@@ -799,9 +1114,8 @@ static int handle_ws_frame(int client_fd) {
                         }
                     }
                     
-                    // Handle the input (could be game controls, etc.)
-                    // For now, just log the received data
-                    ESP_LOGI(TAG, "Received WebSocket frame: opcode=%d, payload_len=%llu", opcode, payload_len);
+                    ESP_LOGD(TAG, "Received WebSocket frame: opcode=%d, payload_len=%llu", opcode, payload_len);
+                    handle_client_message(client_fd, payload, payload_len);
                 }
             }
             break;
@@ -832,8 +1146,25 @@ void websocket_server_init(websocket_server_t *server) {
         server->clients[i].inflate_buffer = NULL;
         server->clients[i].deflate_buffer_size = 0;
         server->clients[i].inflate_buffer_size = 0;
+        server->clients[i].stats_subscribed = 0;
+        server->clients[i].audio_subscribed = 0;
+        server->clients[i].view = 0;
+        server->clients[i].player = 0;
+    }
+
+    if (g_view_lock == NULL) {
+        g_view_lock = xSemaphoreCreateMutex();
     }
 
+    if (g_out_queue == NULL) {
+        g_out_queue = xRingbufferCreate(WS_OUT_QUEUE_SIZE, RINGBUF_TYPE_NOSPLIT);
+        if (g_out_queue == NULL) {
+            ESP_LOGE(TAG, "Failed to create outgoing message queue");
+        }
+    }
+
+    register_profile_stats();
+
     // Initialize input handler
     ESP_LOGI(TAG, "Initializing input handler...");
     ESP_ERROR_CHECK(input_handler_init());
@@ -889,6 +1220,10 @@ void websocket_server_stop(websocket_server_t *server) {
             // Cleanup compression
             websocket_cleanup_compression(&server->clients[i]);
 #endif
+            if (server->clients[i].player) {
+                release_player_input(&server->clients[i]);
+                server->clients[i].player = 0;
+            }
             close(server->clients[i].fd);
             server->clients[i].fd = -1;
             server->clients[i].active = 0;
@@ -916,6 +1251,7 @@ void websocket_server_task(void *pv) {
     
     websocket_server_init(server);
     websocket_server_start(server);
+    perf_counters_init_core();
     
     if (server->server_fd < 0) {
         ESP_LOGE(TAG, "Failed to start WebSocket server");
@@ -947,12 +1283,29 @@ void websocket_server_task(void *pv) {
                 continue;
             }
 
-            // Add client to list
+            // Add client to list: the first one plays, the others spectate
             for (int i = 0; i < WS_MAX_CLIENTS; i++) {
                 if (server->clients[i].fd == -1) {
-                    server->clients[i].fd = client_fd;
-                    server->clients[i].active = 1;
+                    websocket_client_t *client = &server->clients[i];
+                    int spectator = find_player(server) != NULL;
+                    client->fd = client_fd;
+                    client->active = 1;
+                    client->stats_subscribed = 0;
+                    client->audio_subscribed = 0;
+                    client->view = -1;
+                    client->player = 0;
+                    memset(client->held_keys, 0, sizeof(client->held_keys));
+                    client->held_buttons = 0;
                     server->client_count++;
+                    if (!spectator) {
+                        select_view(client, 0, 0, 0);
+                    } else if (websocket_server_view_watchers(1) > 0) {
+                        // Someone already set the stream up; join it as it is
+                        client->view = 1;
+                        send_role(client);
+                    } else {
+                        select_view(client, 1, WS_VIEW_DEFAULT_KIND, 0);
+                    }
                     break;
                 }
             }
@@ -966,14 +1319,13 @@ void websocket_server_task(void *pv) {
         for (int i = 0; i < WS_MAX_CLIENTS; i++) {
             if (server->clients[i].fd >= 0 && server->clients[i].active) {
                 // Handle incoming frames
-                int result = handle_ws_frame(server->clients[i].fd);
+                // A lone client may block for input; with several, one idle
+                // client must not hold up the others
+                int result = handle_ws_frame(server->clients[i].fd, server->client_count > 1 ? 0 : 100);
                 if (result < 0) {
                     ESP_LOGI(TAG, "Client disconnected (frame handling failed)");
                     
-                    close(server->clients[i].fd);
-                    server->clients[i].fd = -1;
-                    server->clients[i].active = 0;
-                    server->client_count--;
+                    drop_client(server, &server->clients[i]);
                     continue;
                 } else if (result > 0) {
                     ESP_LOGI(TAG, "Frame handled successfully");
@@ -981,26 +1333,44 @@ void websocket_server_task(void *pv) {
             }
         }
 
+        // Small queued messages (audio) go first so they are not stuck behind a frame;
+        // with no clients left this just discards them
+        if (g_out_queue) {
+            send_queued_messages(server);
+        }
+        if (g_view_lock) {
+            send_views(server);
+        }
+
         // Send frame data to all connected clients (only if we have frames and clients)
         uint8_t *frame = frame_queue_get_next_frame(&g_frame_queue);
         if (frame && server->client_count > 0) {
-            //ESP_LOGI(TAG, "Sending frame of size %zu bytes to %d clients", (size_t)(FRAME_SIZE + 1), server->client_count);
+            size_t frame_size = frame_queue_next_frame_size(&g_frame_queue);
+            perf_phase_begin(PERF_PHASE_NETWORK);
+            //ESP_LOGI(TAG, "Sending frame of size %zu bytes to %d clients", frame_size, server->client_count);
             for (int i = 0; i < WS_MAX_CLIENTS; i++) {
-                if (server->clients[i].fd >= 0 && server->clients[i].active) {
+                if (server->clients[i].fd >= 0 && server->clients[i].active && server->clients[i].view == 0) {
                     //ESP_LOGI(TAG, "Sending frame to client %d, palette index: %d", i, frame[0]);
-                    if (websocket_send_binary_frame(server->clients[i].fd, frame, FRAME_SIZE + 1) < 0) {
+                    if (websocket_send_binary_frame(server->clients[i].fd, frame, frame_size) < 0) {
                         ESP_LOGW(TAG, "Failed to send frame to client %d", i);
                         
-                        close(server->clients[i].fd);
-                        server->clients[i].fd = -1;
-                        server->clients[i].active = 0;
-                        server->client_count--;
+                        drop_client(server, &server->clients[i]);
                     } else {
                         //ESP_LOGI(TAG, "Frame sent successfully to client %d", i);
                     }
                 }
             }
             frame_queue_release_frame(&g_frame_queue);
+            perf_phase_end(PERF_PHASE_NETWORK);
+        }
+
+        // Live stats stream for clients that subscribed to it
+        static uint64_t last_stats_time = 0;
+        uint64_t now_us = esp_timer_get_time();
+        if (g_stats_provider && server->client_count > 0 &&
+            now_us - last_stats_time >= WS_STATS_INTERVAL_MS * 1000ULL) {
+            send_stats_to_subscribers(server);
+            last_stats_time = now_us;
         }
 
         // Send ping to keep connection alive
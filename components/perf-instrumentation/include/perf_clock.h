@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Monotonic microsecond clock shared by the perf-instrumentation modules.
+// esp_timer on target, CLOCK_MONOTONIC on the host.
+uint64_t perf_now_us(void);
+
+// Index of the core running the caller (always 0 on the host)
+uint8_t perf_core_id(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hardware performance counters per engine phase
+//
+// The ESP32 cache controller exposes no hit/miss statistics, so PSRAM and
+// flash cache pressure is measured from the Xtensa LX6 performance monitor:
+// each core has two counters, programmed to count data-side stall cycles
+// (loads/stores waiting on the external cache, i.e. PSRAM) and
+// instruction-side stall cycles (fetches waiting on the flash cache). Cycle
+// counts come from CCOUNT. Counters are per core, so every core that enters a
+// phase must call perf_counters_init_core() once from a task pinned to it.
+//
+// Phases are bracketed with perf_phase_begin()/perf_phase_end() from a single
+// task; totals are monotonic and read with perf_phase_get_totals().
+
+typedef enum {
+    PERF_PHASE_SIM,         // G_Ticker and friends, core 1
+    PERF_PHASE_RENDER,      // D_Display, core 1
+    PERF_PHASE_NETWORK,     // frame compress and send, core 0
+    PERF_PHASE_COUNT
+} perf_phase_t;
+
+// Monotonic totals for one phase
+typedef struct {
+    uint64_t cycles;            // CPU cycles spent inside the phase
+    uint64_t dstall_cycles;     // of which stalled on data memory (PSRAM)
+    uint64_t istall_cycles;     // of which stalled on instruction fetch (flash)
+    uint32_t count;             // completed begin/end pairs (frames, tics, sends)
+} perf_phase_totals_t;
+
+// Raw 32-bit counter readings on the calling core; deltas are wrap-safe
+typedef struct {
+    uint32_t cycles;
+    uint32_t dstall;
+    uint32_t istall;
+} perf_counter_sample_t;
+
+// PSRAM characteristics measured at boot, replacing assumed figures
+typedef struct {
+    uint32_t read_bytes_per_sec;    // streaming read, working set > cache
+    uint32_t write_bytes_per_sec;   // streaming write, working set > cache
+    uint32_t miss_latency_cycles;   // dependent load that misses the cache
+    uint32_t cpu_hz;                // cycle counter frequency
+} perf_psram_calibration_t;
+
+// Program and start the counters on the calling core
+void perf_counters_init_core(void);
+
+// True when hardware stall counters are available (false on host builds)
+bool perf_counters_supported(void);
+
+// Bracket one execution of a phase. Not reentrant per phase.
+void perf_phase_begin(perf_phase_t phase);
+void perf_phase_end(perf_phase_t phase);
+
+// Read the calling core's counters, for ad hoc measurements outside the
+// phases (benchmarks); subtract two samples for the cost of a region
+void perf_counters_sample(perf_counter_sample_t *out);
+
+// Snapshot of a phase's monotonic totals
+void perf_phase_get_totals(perf_phase_t phase, perf_phase_totals_t *out);
+
+// Name of a phase for reports and metric labels
+const char *perf_phase_name(perf_phase_t phase);
+
+// Measure PSRAM bandwidth and miss latency (takes a few ms). Returns 0 on success.
+int perf_psram_calibrate(perf_psram_calibration_t *out);
+
+#ifdef __cplusplus
+}
+#endif
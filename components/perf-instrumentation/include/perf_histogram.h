@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Log-linear latency histograms
+//
+// Values (normally microseconds) are bucketed HDR-style: each power of two is
+// split into 2^PERF_HISTOGRAM_SUB_BITS linear sub-buckets, giving ~6% relative
+// precision from 1us up to 2^PERF_HISTOGRAM_MAX_BITS-1 (16.7s); larger values
+// land in the top bucket. Recording is a few shifts and one increment, and the
+// sum is 64-bit so long runs never wrap.
+
+#define PERF_HISTOGRAM_SUB_BITS 4
+#define PERF_HISTOGRAM_SUB_COUNT (1 << PERF_HISTOGRAM_SUB_BITS)
+#define PERF_HISTOGRAM_MAX_BITS 24
+#define PERF_HISTOGRAM_MAX_VALUE ((1UL << PERF_HISTOGRAM_MAX_BITS) - 1)
+#define PERF_HISTOGRAM_BUCKETS ((PERF_HISTOGRAM_MAX_BITS - PERF_HISTOGRAM_SUB_BITS + 1) * PERF_HISTOGRAM_SUB_COUNT)
+
+// Histogram storage is large-ish (1.3KB), keep statically allocated ones in PSRAM
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#define PERF_HISTOGRAM_ATTR EXT_RAM_BSS_ATTR
+#else
+#define PERF_HISTOGRAM_ATTR
+#endif
+
+typedef struct {
+    uint32_t counts[PERF_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+} perf_histogram_t;
+
+// Percentile summary of one histogram
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t p999;
+    uint32_t max;
+} perf_histogram_summary_t;
+
+void perf_histogram_reset(perf_histogram_t *h);
+void perf_histogram_record(perf_histogram_t *h, uint32_t value);
+
+// Add every sample of src into dst
+void perf_histogram_merge(perf_histogram_t *dst, const perf_histogram_t *src);
+
+// Value at the given percentile (0-100), reported as the upper bound of its bucket
+uint32_t perf_histogram_percentile(const perf_histogram_t *h, double percentile);
+
+void perf_histogram_summarize(const perf_histogram_t *h, perf_histogram_summary_t *summary);
+
+// Bucket geometry, for exporters that emit the raw distribution
+size_t perf_histogram_bucket_index(uint32_t value);
+uint32_t perf_histogram_bucket_upper(size_t index);
+
+// Named latency tracker: recorders write the current window, and the periodic
+// reporter rolls the window into the since-boot lifetime histogram.
+typedef struct {
+    const char *name;
+    perf_histogram_t window;
+    perf_histogram_t lifetime;
+} perf_latency_t;
+
+#define PERF_LATENCY_MAX_REGISTERED 16
+
+// Register a tracker (usually PERF_HISTOGRAM_ATTR static) under a metric-safe
+// name. Registering the same tracker twice is a no-op. Returns 0 on success.
+int perf_latency_register(perf_latency_t *latency, const char *name);
+
+static inline void perf_latency_record(perf_latency_t *latency, uint32_t value) {
+    perf_histogram_record(&latency->window, value);
+}
+
+// Merge the window into the lifetime histogram and start a new window.
+// Samples recorded concurrently with the roll may be lost.
+void perf_latency_roll(perf_latency_t *latency);
+
+// Registry iteration for reporters and exporters
+size_t perf_latency_count(void);
+perf_latency_t *perf_latency_get(size_t index);
+perf_latency_t *perf_latency_find(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "perf_trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Statistical PC sampler
+//
+// On target a hardware timer interrupt on the Doom core wakes a top-priority
+// sampler task; the task unwinds the frame the preempted task saved on its
+// stack and pushes the call chain into a ring. On the Linux host build the
+// same ring is fed from a SIGPROF handler driven by setitimer(ITIMER_PROF).
+// The ring is drained by perf_profiler_read(), and tools/profile_fold.py
+// symbolizes the result against the ELF into folded stacks for flamegraphs.
+
+#ifndef PERF_PROFILER_CORE
+#define PERF_PROFILER_CORE 1            // core running the Doom task
+#endif
+#define PERF_PROFILER_DEFAULT_HZ 997    // prime, so it never locks to the 35Hz tic
+#define PERF_PROFILER_MAX_DEPTH 8       // frames kept per sample, leaf first
+#define PERF_PROFILER_CAPACITY 4096     // samples buffered between downloads
+#define PERF_PROFILER_MAX_TASKS 16
+#define PERF_PROFILER_TASK_NAME_LEN 16
+
+// Sample flags
+#define PERF_PROFILER_FLAG_IDLE      0x01   // core was idle
+#define PERF_PROFILER_FLAG_TRUNCATED 0x02   // unwinding stopped on a bad frame
+
+// One sample, leaf PC first
+typedef struct {
+    uint8_t depth;
+    uint8_t flags;
+    uint8_t task;       // index into the task name table
+    uint8_t reserved;
+    uint32_t pcs[PERF_PROFILER_MAX_DEPTH];
+} perf_profiler_sample_t;
+
+// Download format (little-endian), version 1:
+//   char magic[4] = "DPRF"; uint16 version; uint16 max_depth;
+//   uint32 sample_hz; uint32 dropped; uint64 load_base; uint32 task_count;
+//   char task_names[task_count][PERF_PROFILER_TASK_NAME_LEN];
+//   uint32 sample_count;
+//   sample_count x { uint8 depth; uint8 flags; uint8 task; uint8 reserved; uint32 pcs[depth]; }
+#define PERF_PROFILER_FORMAT_VERSION 1
+
+// Start sampling at hz (0 selects PERF_PROFILER_DEFAULT_HZ). Returns 0 on success.
+int perf_profiler_start(uint32_t hz);
+void perf_profiler_stop(void);
+bool perf_profiler_is_running(void);
+
+// Drain every buffered sample into the sink in the download format
+int perf_profiler_read(perf_trace_write_fn write, void *ctx);
+
+// Drain into a file (host builds, or a mounted filesystem on target)
+int perf_profiler_write_file(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
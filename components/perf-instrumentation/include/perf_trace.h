@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame-timeline tracing
+//
+// Events are recorded into a fixed binary ring (16 bytes each) with a
+// microsecond timestamp and the id of the core that recorded them. Recording
+// is lock-free and never allocates; when the ring is full the oldest events
+// are overwritten. The ring is exported as Chrome trace event JSON, which
+// loads directly into chrome://tracing and ui.perfetto.dev.
+
+// Set to 0 to compile every PERF_TRACE_* call site out of the build
+#ifndef PERF_TRACE_ENABLED
+#define PERF_TRACE_ENABLED 1
+#endif
+
+// Ring capacity in events, must be a power of two (4096 * 16 bytes = 64KB)
+#ifndef PERF_TRACE_CAPACITY
+#define PERF_TRACE_CAPACITY 4096
+#endif
+
+// Event kinds, mapped to Chrome trace phases B, E, C and i
+typedef enum {
+    PERF_TRACE_EVENT_BEGIN,
+    PERF_TRACE_EVENT_END,
+    PERF_TRACE_EVENT_COUNTER,
+    PERF_TRACE_EVENT_INSTANT
+} perf_trace_event_type_t;
+
+// Trace points. Names live in a static table so events stay compact.
+typedef enum {
+    PERF_TRACE_TIC,             // one G_Ticker run
+    PERF_TRACE_DISPLAY,         // D_Display, whole frame
+    PERF_TRACE_RENDER_VIEW,     // R_RenderPlayerView
+    PERF_TRACE_RENDER_BSP,      // R_RenderBSPNode walk (walls)
+    PERF_TRACE_RENDER_PLANES,   // R_DrawPlanes
+    PERF_TRACE_RENDER_MASKED,   // R_DrawMasked (sprites, masked mids)
+    PERF_TRACE_RENDER_HUD,      // automap, status bar, HUD and menu overlays
+    PERF_TRACE_RENDER_SPECTATOR, // one spectator view (r_views.c)
+    PERF_TRACE_SPECTATOR_SKIP,  // due spectator view skipped (arg 0: budget, 1: next tic)
+    PERF_TRACE_FINISH_UPDATE,   // I_FinishUpdate copy into the frame queue
+    PERF_TRACE_FRAME_SUBMIT,    // frame handed to the sender
+    PERF_TRACE_FRAME_RELEASE,   // frame slot returned by the sender
+    PERF_TRACE_FRAME_DROP,      // frame skipped because the queue was full
+    PERF_TRACE_FRAME_STATIC,    // idle frame not queued, same as the last one
+    PERF_TRACE_PACE_SLEEP,      // renderer sleeping until its paced start time
+    PERF_TRACE_PACE_SKIP,       // paced render skipped (arg 0: queue full, 1: next tic, 2: idle rate)
+    PERF_TRACE_COMPRESS,        // permessage-deflate of a frame
+    PERF_TRACE_SEND,            // WebSocket frame transmit
+    PERF_TRACE_INPUT_RECV,      // input message decoded from the socket
+    PERF_TRACE_INPUT_POST,      // input event posted to the engine
+    PERF_TRACE_FRAME_QUEUE_DEPTH, // counter: frames waiting to be sent
+    PERF_TRACE_SEND_BYTES,      // counter: bytes of the last transmitted frame
+    PERF_TRACE_SIM_DSTALL,      // counter: % of the last tic stalled on data memory
+    PERF_TRACE_RENDER_DSTALL,   // counter: % of the last frame stalled on data memory
+    PERF_TRACE_NETWORK_DSTALL,  // counter: % of the last send stalled on data memory
+    PERF_TRACE_ID_COUNT
+} perf_trace_id_t;
+
+// One recorded event (16 bytes)
+typedef struct {
+    uint32_t seq;            // write cursor + 1, stored last; 0 while being written
+    uint32_t timestamp_us;   // low 32 bits of the microsecond clock
+    int32_t value;           // counter value or instant argument
+    uint16_t id;             // perf_trace_id_t
+    uint8_t type;            // perf_trace_event_type_t
+    uint8_t core;            // core that recorded the event
+} perf_trace_event_t;
+
+// Sink for the JSON exporter. Returns 0 on success, non-zero aborts the export.
+typedef int (*perf_trace_write_fn)(void *ctx, const char *data, size_t len);
+
+// Allocate the ring (PSRAM on target). Safe to call more than once.
+int perf_trace_init(void);
+
+// Pause or resume recording; recording starts enabled after init
+void perf_trace_set_enabled(bool enabled);
+bool perf_trace_is_enabled(void);
+
+// Drop all recorded events
+void perf_trace_clear(void);
+
+// Record one event (lock-free, callable from any task on either core)
+void perf_trace_record(perf_trace_id_t id, perf_trace_event_type_t type, int32_t value);
+
+// Name of a trace point as it appears in the exported JSON
+const char *perf_trace_name(perf_trace_id_t id);
+
+// Export the ring as Chrome trace JSON. Recording is paused for the duration
+// of the export so the snapshot is consistent; it resumes afterwards.
+int perf_trace_export_json(perf_trace_write_fn write, void *ctx);
+
+#if PERF_TRACE_ENABLED
+#define PERF_TRACE_BEGIN(id)        perf_trace_record((id), PERF_TRACE_EVENT_BEGIN, 0)
+#define PERF_TRACE_END(id)          perf_trace_record((id), PERF_TRACE_EVENT_END, 0)
+#define PERF_TRACE_COUNTER(id, v)   perf_trace_record((id), PERF_TRACE_EVENT_COUNTER, (int32_t)(v))
+#define PERF_TRACE_INSTANT(id, v)   perf_trace_record((id), PERF_TRACE_EVENT_INSTANT, (int32_t)(v))
+#else
+#define PERF_TRACE_BEGIN(id)        ((void)0)
+#define PERF_TRACE_END(id)          ((void)0)
+#define PERF_TRACE_COUNTER(id, v)   ((void)0)
+#define PERF_TRACE_INSTANT(id, v)   ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,27 @@
+#include "perf_clock.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <time.h>
+#endif
+
+uint64_t perf_now_us(void) {
+#ifdef ESP_PLATFORM
+    return (uint64_t)esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+#endif
+}
+
+uint8_t perf_core_id(void) {
+#ifdef ESP_PLATFORM
+    return (uint8_t)xPortGetCoreID();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,173 @@
+#include "perf_counters.h"
+#include "perf_clock.h"
+#include "perf_trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_private/esp_clk.h"
+#include "perfmon.h"
+#endif
+
+// Counter slots of the LX6 performance monitor
+#define PERF_COUNTER_DSTALL 0
+#define PERF_COUNTER_ISTALL 1
+
+// Working set for calibration, well beyond the 32KB external cache
+#define CALIBRATION_BUFFER_SIZE (256 * 1024)
+#define CALIBRATION_STRIDE 64
+#define CALIBRATION_CHASE_LOADS 2048
+
+static perf_counter_sample_t phase_start[PERF_PHASE_COUNT];
+static perf_phase_totals_t phase_totals[PERF_PHASE_COUNT];
+
+// Per-run stall share goes to the frame timeline as a counter
+static const perf_trace_id_t phase_trace_ids[PERF_PHASE_COUNT] = {
+    [PERF_PHASE_SIM]     = PERF_TRACE_SIM_DSTALL,
+    [PERF_PHASE_RENDER]  = PERF_TRACE_RENDER_DSTALL,
+    [PERF_PHASE_NETWORK] = PERF_TRACE_NETWORK_DSTALL,
+};
+
+static const char *const phase_names[PERF_PHASE_COUNT] = {
+    [PERF_PHASE_SIM]     = "sim",
+    [PERF_PHASE_RENDER]  = "render",
+    [PERF_PHASE_NETWORK] = "network",
+};
+
+static inline uint32_t cycle_count(void) {
+#ifdef ESP_PLATFORM
+    return esp_cpu_get_cycle_count();
+#else
+    // Host builds count nanoseconds as "cycles"
+    return (uint32_t)(perf_now_us() * 1000);
+#endif
+}
+
+static inline void read_counters(perf_counter_sample_t *r) {
+    r->cycles = cycle_count();
+#ifdef ESP_PLATFORM
+    r->dstall = xtensa_perfmon_value(PERF_COUNTER_DSTALL);
+    r->istall = xtensa_perfmon_value(PERF_COUNTER_ISTALL);
+#else
+    r->dstall = 0;
+    r->istall = 0;
+#endif
+}
+
+void perf_counters_init_core(void) {
+#ifdef ESP_PLATFORM
+    // Count at every interrupt level so ISR stalls on the core are included
+    xtensa_perfmon_stop();
+    xtensa_perfmon_init(PERF_COUNTER_DSTALL, XTPERF_CNT_D_STALL, XTPERF_MASK_D_STALL_ALL, 0, -1);
+    xtensa_perfmon_init(PERF_COUNTER_ISTALL, XTPERF_CNT_I_STALL, XTPERF_MASK_I_STALL_ALL, 0, -1);
+    xtensa_perfmon_reset(PERF_COUNTER_DSTALL);
+    xtensa_perfmon_reset(PERF_COUNTER_ISTALL);
+    xtensa_perfmon_start();
+#endif
+}
+
+bool perf_counters_supported(void) {
+#ifdef ESP_PLATFORM
+    return true;
+#else
+    return false;
+#endif
+}
+
+void perf_counters_sample(perf_counter_sample_t *out) {
+    read_counters(out);
+}
+
+void perf_phase_begin(perf_phase_t phase) {
+    read_counters(&phase_start[phase]);
+}
+
+void perf_phase_end(perf_phase_t phase) {
+    perf_counter_sample_t now;
+    read_counters(&now);
+    const perf_counter_sample_t *start = &phase_start[phase];
+    perf_phase_totals_t *t = &phase_totals[phase];
+
+    // Single writer per phase; 64-bit fields may tear for a reader on the
+    // other core, which only ever costs one period of accuracy
+    uint32_t cycles = now.cycles - start->cycles;
+    uint32_t dstall = now.dstall - start->dstall;
+    t->cycles += cycles;
+    t->dstall_cycles += dstall;
+    t->istall_cycles += (uint32_t)(now.istall - start->istall);
+    __atomic_store_n(&t->count, t->count + 1, __ATOMIC_RELEASE);
+
+    if (cycles) {
+        PERF_TRACE_COUNTER(phase_trace_ids[phase], (uint64_t)dstall * 100 / cycles);
+    }
+}
+
+void perf_phase_get_totals(perf_phase_t phase, perf_phase_totals_t *out) {
+    __atomic_load_n(&phase_totals[phase].count, __ATOMIC_ACQUIRE);
+    *out = phase_totals[phase];
+}
+
+const char *perf_phase_name(perf_phase_t phase) {
+    return phase < PERF_PHASE_COUNT ? phase_names[phase] : "?";
+}
+
+int perf_psram_calibrate(perf_psram_calibration_t *out) {
+    memset(out, 0, sizeof(*out));
+#ifdef ESP_PLATFORM
+    uint32_t *buf = heap_caps_malloc(CALIBRATION_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    out->cpu_hz = esp_clk_cpu_freq();
+#else
+    uint32_t *buf = malloc(CALIBRATION_BUFFER_SIZE);
+    out->cpu_hz = 1000000000;
+#endif
+    if (buf == NULL) {
+        return -1;
+    }
+    const size_t words = CALIBRATION_BUFFER_SIZE / sizeof(uint32_t);
+
+    // Streaming write, then streaming read; the first pass also evicts
+    // whatever the cache held before
+    uint64_t start_us = perf_now_us();
+    memset(buf, 0x5a, CALIBRATION_BUFFER_SIZE);
+    uint64_t write_us = perf_now_us() - start_us;
+
+    volatile uint32_t sink = 0;
+    uint32_t sum = 0;
+    start_us = perf_now_us();
+    for (size_t i = 0; i < words; i++) {
+        sum += buf[i];
+    }
+    uint64_t read_us = perf_now_us() - start_us;
+    sink = sum;
+    (void)sink;
+
+    // Pointer chase across cache lines in a scattered order, so every load
+    // depends on the previous one and misses the cache
+    const size_t stride_words = CALIBRATION_STRIDE / sizeof(uint32_t);
+    const size_t slots = words / stride_words;
+    for (size_t i = 0; i < slots; i++) {
+        // 40503 is odd, so i * 40503 mod slots (a power of two) is a permutation
+        size_t next = ((i + 1) * 40503u) % slots;
+        buf[((i * 40503u) % slots) * stride_words] = (uint32_t)(next * stride_words);
+    }
+    uint32_t index = 0;
+    uint32_t start_cycles = cycle_count();
+    for (int i = 0; i < CALIBRATION_CHASE_LOADS; i++) {
+        index = buf[index];
+    }
+    uint32_t chase_cycles = cycle_count() - start_cycles;
+    sink = index;
+
+    if (write_us > 0) {
+        out->write_bytes_per_sec = (uint32_t)((uint64_t)CALIBRATION_BUFFER_SIZE * 1000000 / write_us);
+    }
+    if (read_us > 0) {
+        out->read_bytes_per_sec = (uint32_t)((uint64_t)CALIBRATION_BUFFER_SIZE * 1000000 / read_us);
+    }
+    out->miss_latency_cycles = chase_cycles / CALIBRATION_CHASE_LOADS;
+
+    free(buf);
+    return 0;
+}
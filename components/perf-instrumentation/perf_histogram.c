@@ -0,0 +1,133 @@
+#include "perf_histogram.h"
+#include <string.h>
+
+static perf_latency_t *latency_registry[PERF_LATENCY_MAX_REGISTERED];
+static size_t latency_registry_count = 0;
+
+size_t perf_histogram_bucket_index(uint32_t value) {
+    if (value > PERF_HISTOGRAM_MAX_VALUE) {
+        value = PERF_HISTOGRAM_MAX_VALUE;
+    }
+    if (value < PERF_HISTOGRAM_SUB_COUNT) {
+        return value;
+    }
+    // Top bit selects the power-of-two range, the next SUB_BITS the linear slot
+    int msb = 31 - __builtin_clz(value);
+    int shift = msb - PERF_HISTOGRAM_SUB_BITS;
+    return (size_t)(shift + 1) * PERF_HISTOGRAM_SUB_COUNT + ((value >> shift) - PERF_HISTOGRAM_SUB_COUNT);
+}
+
+uint32_t perf_histogram_bucket_upper(size_t index) {
+    if (index < PERF_HISTOGRAM_SUB_COUNT) {
+        return (uint32_t)index;
+    }
+    int shift = (int)(index / PERF_HISTOGRAM_SUB_COUNT) - 1;
+    uint32_t sub = (uint32_t)(index % PERF_HISTOGRAM_SUB_COUNT) + PERF_HISTOGRAM_SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+void perf_histogram_reset(perf_histogram_t *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void perf_histogram_record(perf_histogram_t *h, uint32_t value) {
+    h->counts[perf_histogram_bucket_index(value)]++;
+    if (h->count == 0 || value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+    h->count++;
+    h->sum += value;
+}
+
+void perf_histogram_merge(perf_histogram_t *dst, const perf_histogram_t *src) {
+    if (src->count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    if (dst->count == 0 || src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+}
+
+uint32_t perf_histogram_percentile(const perf_histogram_t *h, double percentile) {
+    if (h->count == 0) {
+        return 0;
+    }
+    if (percentile >= 100.0) {
+        return h->max;
+    }
+
+    // Rank of the requested sample, 1-based
+    uint32_t rank = (uint32_t)(percentile / 100.0 * h->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for (size_t i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint32_t upper = perf_histogram_bucket_upper(i);
+            // Never report past the largest sample actually seen
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void perf_histogram_summarize(const perf_histogram_t *h, perf_histogram_summary_t *summary) {
+    summary->count = h->count;
+    summary->min = h->min;
+    summary->max = h->max;
+    summary->mean = h->count ? (uint32_t)(h->sum / h->count) : 0;
+    summary->p50 = perf_histogram_percentile(h, 50.0);
+    summary->p90 = perf_histogram_percentile(h, 90.0);
+    summary->p99 = perf_histogram_percentile(h, 99.0);
+    summary->p999 = perf_histogram_percentile(h, 99.9);
+}
+
+int perf_latency_register(perf_latency_t *latency, const char *name) {
+    for (size_t i = 0; i < latency_registry_count; i++) {
+        if (latency_registry[i] == latency) {
+            return 0;
+        }
+    }
+    if (latency_registry_count >= PERF_LATENCY_MAX_REGISTERED) {
+        return -1;
+    }
+    latency->name = name;
+    latency_registry[latency_registry_count++] = latency;
+    return 0;
+}
+
+void perf_latency_roll(perf_latency_t *latency) {
+    perf_histogram_merge(&latency->lifetime, &latency->window);
+    perf_histogram_reset(&latency->window);
+}
+
+size_t perf_latency_count(void) {
+    return latency_registry_count;
+}
+
+perf_latency_t *perf_latency_get(size_t index) {
+    return index < latency_registry_count ? latency_registry[index] : NULL;
+}
+
+perf_latency_t *perf_latency_find(const char *name) {
+    for (size_t i = 0; i < latency_registry_count; i++) {
+        if (strcmp(latency_registry[i]->name, name) == 0) {
+            return latency_registry[i];
+        }
+    }
+    return NULL;
+}
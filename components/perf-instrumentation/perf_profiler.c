@@ -0,0 +1,410 @@
+#ifndef ESP_PLATFORM
+#define _GNU_SOURCE
+#endif
+
+#include "perf_profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "driver/gptimer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "xtensa_context.h"
+#else
+#include <signal.h>
+#include <sys/time.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <ucontext.h>
+#endif
+
+#define PROFILER_MASK (PERF_PROFILER_CAPACITY - 1)
+
+#if (PERF_PROFILER_CAPACITY & PROFILER_MASK) != 0
+#error "PERF_PROFILER_CAPACITY must be a power of two"
+#endif
+
+static const char *TAG = "PerfProfiler";
+
+// Single-producer (sampler) / single-consumer (downloader) sample ring
+static perf_profiler_sample_t *sample_ring = NULL;
+static uint32_t ring_head = 0;
+static uint32_t ring_tail = 0;
+static uint32_t samples_dropped = 0;
+
+// Task name table, appended by the sampler only
+static char task_names[PERF_PROFILER_MAX_TASKS][PERF_PROFILER_TASK_NAME_LEN];
+static uint32_t task_count = 0;
+
+static volatile bool profiler_running = false;
+static uint32_t profiler_hz = 0;
+static uint64_t profiler_load_base = 0;
+
+static bool ring_alloc(void) {
+    if (sample_ring) {
+        return true;
+    }
+    size_t size = PERF_PROFILER_CAPACITY * sizeof(perf_profiler_sample_t);
+#ifdef ESP_PLATFORM
+    sample_ring = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    sample_ring = malloc(size);
+#endif
+    return sample_ring != NULL;
+}
+
+// Claim the next free slot, or NULL (and count a drop) when the reader is behind
+static perf_profiler_sample_t *ring_reserve(void) {
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= PERF_PROFILER_CAPACITY) {
+        samples_dropped++;
+        return NULL;
+    }
+    return &sample_ring[head & PROFILER_MASK];
+}
+
+static void ring_commit(void) {
+    __atomic_store_n(&ring_head, ring_head + 1, __ATOMIC_RELEASE);
+}
+
+static uint8_t task_index(const char *name) {
+    for (uint32_t i = 0; i < task_count; i++) {
+        if (strncmp(task_names[i], name, PERF_PROFILER_TASK_NAME_LEN) == 0) {
+            return i;
+        }
+    }
+    if (task_count >= PERF_PROFILER_MAX_TASKS) {
+        return PERF_PROFILER_MAX_TASKS - 1;
+    }
+    strncpy(task_names[task_count], name, PERF_PROFILER_TASK_NAME_LEN - 1);
+    return task_count++;
+}
+
+#ifdef ESP_PLATFORM
+
+/* ============================================================================
+ * TARGET: GPTIMER INTERRUPT + SAMPLER TASK
+ * ============================================================================ */
+
+static gptimer_handle_t profiler_timer = NULL;
+static TaskHandle_t sampler_task = NULL;
+static volatile TaskHandle_t interrupted_task = NULL;
+static uint8_t last_task_index = 0;
+static TaskHandle_t last_task = NULL;
+
+// Turn a windowed-ABI return address into the address of the call instruction
+static inline uint32_t return_to_call_pc(uint32_t ra) {
+    return ((ra & 0x3fffffff) | 0x40000000) - 3;
+}
+
+static bool IRAM_ATTR profiler_timer_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *ctx) {
+    BaseType_t woken = pdFALSE;
+    // The ISR runs on the profiled core, so this is the task we interrupted
+    interrupted_task = xTaskGetCurrentTaskHandle();
+    vTaskNotifyGiveFromISR(sampler_task, &woken);
+    return woken == pdTRUE;
+}
+
+// Unwind the task that was preempted by the timer interrupt. A preempted task's
+// TCB starts with pxTopOfStack, which points at the interrupt frame saved by the
+// port; its register windows have been spilled, so the base save area below each
+// SP holds the caller's return address and SP.
+static void sample_task(TaskHandle_t task) {
+    perf_profiler_sample_t *s = ring_reserve();
+    if (s == NULL) {
+        return;
+    }
+    memset(s, 0, sizeof(*s));
+
+    if (task != last_task) {
+        last_task = task;
+        last_task_index = task_index(pcTaskGetName(task));
+    }
+    s->task = last_task_index;
+    if (task == xTaskGetIdleTaskHandleForCore(PERF_PROFILER_CORE)) {
+        s->flags |= PERF_PROFILER_FLAG_IDLE;
+    }
+
+    const XtExcFrame *frame = *(XtExcFrame * const *)task;
+    if (frame->exit == 0) {
+        // Solicited frame: the task blocked on its own, nothing to unwind
+        s->depth = 0;
+        s->flags |= PERF_PROFILER_FLAG_TRUNCATED;
+        ring_commit();
+        return;
+    }
+
+    uint32_t pc = frame->pc;
+    uint32_t sp = frame->a1;
+    uint32_t ra = frame->a0;
+    while (s->depth < PERF_PROFILER_MAX_DEPTH) {
+        s->pcs[s->depth++] = pc;
+        if (ra == 0) {
+            break;
+        }
+        pc = return_to_call_pc(ra);
+        if (!esp_stack_ptr_is_sane(sp) || !esp_ptr_executable((void *)pc)) {
+            s->flags |= PERF_PROFILER_FLAG_TRUNCATED;
+            break;
+        }
+        ra = *(uint32_t *)(sp - 16);
+        sp = *(uint32_t *)(sp - 12);
+    }
+    ring_commit();
+}
+
+static void profiler_sampler_task(void *arg) {
+    // Created pinned to the profiled core, so the timer interrupt lands there too
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = 1000000,
+    };
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = profiler_timer_isr,
+    };
+    if (gptimer_new_timer(&timer_config, &profiler_timer) != ESP_OK ||
+        gptimer_register_event_callbacks(profiler_timer, &callbacks, NULL) != ESP_OK ||
+        gptimer_enable(profiler_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up sampling timer");
+        profiler_running = false;
+        sampler_task = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+    xTaskNotifyGive((TaskHandle_t)arg);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        TaskHandle_t task = interrupted_task;
+        if (profiler_running && task != NULL && task != sampler_task) {
+            sample_task(task);
+        }
+    }
+}
+
+int perf_profiler_start(uint32_t hz) {
+    if (profiler_running) {
+        return 0;
+    }
+    if (!ring_alloc()) {
+        ESP_LOGE(TAG, "Failed to allocate sample ring");
+        return -1;
+    }
+    profiler_hz = hz ? hz : PERF_PROFILER_DEFAULT_HZ;
+
+    if (sampler_task == NULL) {
+        if (xTaskCreatePinnedToCore(profiler_sampler_task, "profiler", 3072, xTaskGetCurrentTaskHandle(),
+                                    configMAX_PRIORITIES - 1, &sampler_task, PERF_PROFILER_CORE) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create sampler task");
+            return -1;
+        }
+        // Wait for the timer to be set up on the profiled core
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) == 0 || profiler_timer == NULL) {
+            return -1;
+        }
+    }
+
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = 1000000 / profiler_hz,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    gptimer_set_alarm_action(profiler_timer, &alarm);
+    gptimer_set_raw_count(profiler_timer, 0);
+    profiler_running = true;
+    gptimer_start(profiler_timer);
+    ESP_LOGI(TAG, "Sampling core %d at %lu Hz", PERF_PROFILER_CORE, (unsigned long)profiler_hz);
+    return 0;
+}
+
+void perf_profiler_stop(void) {
+    if (!profiler_running) {
+        return;
+    }
+    profiler_running = false;
+    gptimer_stop(profiler_timer);
+    ESP_LOGI(TAG, "Sampling stopped, %lu samples dropped", (unsigned long)samples_dropped);
+}
+
+#else
+
+/* ============================================================================
+ * HOST: SETITIMER + SIGPROF
+ * ============================================================================ */
+
+static void profiler_sigprof(int sig, siginfo_t *info, void *ucontext) {
+    (void)sig;
+    (void)info;
+    perf_profiler_sample_t *s = ring_reserve();
+    if (s == NULL) {
+        return;
+    }
+    memset(s, 0, sizeof(*s));
+
+    uintptr_t pc = 0;
+    ucontext_t *uc = (ucontext_t *)ucontext;
+#if defined(__x86_64__)
+    pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__aarch64__)
+    pc = (uintptr_t)uc->uc_mcontext.pc;
+#else
+    (void)uc;
+#endif
+
+    // backtrace() sees the handler and the signal trampoline first; resume
+    // after the interrupted PC when it shows up, else after those two frames
+    void *frames[PERF_PROFILER_MAX_DEPTH + 3];
+    int n = backtrace(frames, PERF_PROFILER_MAX_DEPTH + 3);
+    int first = n < 2 ? n : 2;
+    for (int i = 0; i < n && i < 4; i++) {
+        if ((uintptr_t)frames[i] == pc) {
+            first = i + 1;
+            break;
+        }
+    }
+
+    if (pc) {
+        s->pcs[s->depth++] = (uint32_t)(pc - profiler_load_base);
+    }
+    for (int i = first; i < n && s->depth < PERF_PROFILER_MAX_DEPTH; i++) {
+        // Return addresses point past the call; step back into it
+        s->pcs[s->depth++] = (uint32_t)((uintptr_t)frames[i] - 1 - profiler_load_base);
+    }
+    ring_commit();
+}
+
+int perf_profiler_start(uint32_t hz) {
+    if (profiler_running) {
+        return 0;
+    }
+    if (!ring_alloc()) {
+        fprintf(stderr, "%s: failed to allocate sample ring\n", TAG);
+        return -1;
+    }
+    profiler_hz = hz ? hz : PERF_PROFILER_DEFAULT_HZ;
+    task_index("host");
+
+    // Samples are stored relative to the executable's load address (PIE)
+    Dl_info dl;
+    if (dladdr((void *)&perf_profiler_start, &dl) && dl.dli_fbase) {
+        profiler_load_base = (uintptr_t)dl.dli_fbase;
+    }
+
+    // First call loads the unwinder, which is not safe inside the handler
+    void *warmup[1];
+    backtrace(warmup, 1);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = profiler_sigprof;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, NULL) != 0) {
+        return -1;
+    }
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / profiler_hz;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        return -1;
+    }
+    profiler_running = true;
+    return 0;
+}
+
+void perf_profiler_stop(void) {
+    if (!profiler_running) {
+        return;
+    }
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_IGN);
+    profiler_running = false;
+}
+
+#endif
+
+bool perf_profiler_is_running(void) {
+    return profiler_running;
+}
+
+/* ============================================================================
+ * DOWNLOAD
+ * ============================================================================ */
+
+int perf_profiler_read(perf_trace_write_fn write, void *ctx) {
+    if (write == NULL) {
+        return -1;
+    }
+
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring_tail;
+    uint32_t count = sample_ring ? head - tail : 0;
+    uint32_t tasks = task_count;
+
+    uint8_t header[32];
+    memcpy(header, "DPRF", 4);
+    uint16_t version = PERF_PROFILER_FORMAT_VERSION;
+    uint16_t max_depth = PERF_PROFILER_MAX_DEPTH;
+    uint32_t dropped = samples_dropped;
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &max_depth, 2);
+    memcpy(header + 8, &profiler_hz, 4);
+    memcpy(header + 12, &dropped, 4);
+    memcpy(header + 16, &profiler_load_base, 8);
+    memcpy(header + 24, &tasks, 4);
+    if (write(ctx, (const char *)header, 28) != 0 ||
+        (tasks && write(ctx, (const char *)task_names, tasks * PERF_PROFILER_TASK_NAME_LEN) != 0) ||
+        write(ctx, (const char *)&count, 4) != 0) {
+        return -1;
+    }
+
+    // Samples go out in batches to keep the number of sink calls low
+    char batch[512];
+    size_t used = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const perf_profiler_sample_t *s = &sample_ring[(tail + i) & PROFILER_MASK];
+        size_t len = 4 + s->depth * sizeof(uint32_t);
+        if (used + len > sizeof(batch)) {
+            if (write(ctx, batch, used) != 0) {
+                return -1;
+            }
+            used = 0;
+        }
+        memcpy(batch + used, s, len);
+        used += len;
+    }
+    if (used && write(ctx, batch, used) != 0) {
+        return -1;
+    }
+
+    __atomic_store_n(&ring_tail, head, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int file_write(void *ctx, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)ctx) == len ? 0 : -1;
+}
+
+int perf_profiler_write_file(const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    int result = perf_profiler_read(file_write, fp);
+    if (fclose(fp) != 0) {
+        result = -1;
+    }
+    return result;
+}
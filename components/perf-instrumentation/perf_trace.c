@@ -0,0 +1,285 @@
+#include "perf_trace.h"
+#include "perf_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#endif
+
+#define PERF_TRACE_MASK (PERF_TRACE_CAPACITY - 1)
+#define PERF_TRACE_MAX_CORES 2
+#define PERF_TRACE_CHUNK_SIZE 1024
+
+#if (PERF_TRACE_CAPACITY & PERF_TRACE_MASK) != 0
+#error "PERF_TRACE_CAPACITY must be a power of two"
+#endif
+
+static const char *TAG = "PerfTrace";
+
+static const char *const trace_names[PERF_TRACE_ID_COUNT] = {
+    [PERF_TRACE_TIC]              = "tic",
+    [PERF_TRACE_DISPLAY]          = "D_Display",
+    [PERF_TRACE_RENDER_VIEW]      = "R_RenderPlayerView",
+    [PERF_TRACE_RENDER_BSP]       = "R_RenderBSPNode",
+    [PERF_TRACE_RENDER_PLANES]    = "R_DrawPlanes",
+    [PERF_TRACE_RENDER_MASKED]    = "R_DrawMasked",
+    [PERF_TRACE_RENDER_HUD]       = "overlays",
+    [PERF_TRACE_RENDER_SPECTATOR] = "spectator_view",
+    [PERF_TRACE_SPECTATOR_SKIP]   = "spectator_skip",
+    [PERF_TRACE_FINISH_UPDATE]    = "I_FinishUpdate",
+    [PERF_TRACE_FRAME_SUBMIT]     = "frame_submit",
+    [PERF_TRACE_FRAME_RELEASE]    = "frame_release",
+    [PERF_TRACE_FRAME_DROP]       = "frame_drop",
+    [PERF_TRACE_FRAME_STATIC]     = "frame_static",
+    [PERF_TRACE_PACE_SLEEP]       = "pace_sleep",
+    [PERF_TRACE_PACE_SKIP]        = "pace_skip",
+    [PERF_TRACE_COMPRESS]         = "compress",
+    [PERF_TRACE_SEND]             = "send",
+    [PERF_TRACE_INPUT_RECV]       = "input_recv",
+    [PERF_TRACE_INPUT_POST]       = "input_post",
+    [PERF_TRACE_FRAME_QUEUE_DEPTH] = "frame_queue_depth",
+    [PERF_TRACE_SEND_BYTES]       = "send_bytes",
+    [PERF_TRACE_SIM_DSTALL]       = "sim_dstall_pct",
+    [PERF_TRACE_RENDER_DSTALL]    = "render_dstall_pct",
+    [PERF_TRACE_NETWORK_DSTALL]   = "network_dstall_pct",
+};
+
+// Ring storage and the monotonic write cursor (slot = cursor & mask). The
+// cursor is never rewound, so a slot's seq identifies the one write that
+// filled it; clearing moves the export start instead.
+static perf_trace_event_t *trace_ring = NULL;
+static uint32_t trace_head = 0;
+static uint32_t trace_start = 0;
+static volatile bool trace_enabled = false;
+
+int perf_trace_init(void) {
+    if (trace_ring) {
+        return 0;
+    }
+
+    size_t size = PERF_TRACE_CAPACITY * sizeof(perf_trace_event_t);
+#ifdef ESP_PLATFORM
+    // The ring is written sparsely and read rarely, so keep it out of internal RAM
+    trace_ring = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (trace_ring == NULL) {
+        trace_ring = heap_caps_calloc(1, size, MALLOC_CAP_8BIT);
+    }
+#else
+    trace_ring = calloc(1, size);
+#endif
+    if (trace_ring == NULL) {
+#ifdef ESP_PLATFORM
+        ESP_LOGE(TAG, "Failed to allocate %u byte trace ring", (unsigned)size);
+#else
+        fprintf(stderr, "%s: failed to allocate %zu byte trace ring\n", TAG, size);
+#endif
+        return -1;
+    }
+
+    __atomic_store_n(&trace_head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&trace_start, 0, __ATOMIC_RELAXED);
+    trace_enabled = true;
+#ifdef ESP_PLATFORM
+    ESP_LOGI(TAG, "Trace ring ready: %d events (%u bytes)", PERF_TRACE_CAPACITY, (unsigned)size);
+#endif
+    return 0;
+}
+
+void perf_trace_set_enabled(bool enabled) {
+    trace_enabled = enabled && trace_ring != NULL;
+}
+
+bool perf_trace_is_enabled(void) {
+    return trace_enabled;
+}
+
+void perf_trace_clear(void) {
+    __atomic_store_n(&trace_start, __atomic_load_n(&trace_head, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+void perf_trace_record(perf_trace_id_t id, perf_trace_event_type_t type, int32_t value) {
+    if (!trace_enabled) {
+        return;
+    }
+
+    // Claim a slot; concurrent writers on the other core get the next one
+    uint32_t index = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    perf_trace_event_t *ev = &trace_ring[index & PERF_TRACE_MASK];
+    // Seqlock write: invalidate, fill, then publish with release ordering
+    __atomic_store_n(&ev->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ev->timestamp_us = (uint32_t)perf_now_us();
+    ev->value = value;
+    ev->id = (uint16_t)id;
+    ev->type = (uint8_t)type;
+    ev->core = perf_core_id();
+    __atomic_store_n(&ev->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+// Copy the event written at cursor index; false if that write has not been
+// committed yet, was overwritten by a later one, or changed while copying
+static bool trace_read_slot(uint32_t index, perf_trace_event_t *out) {
+    const perf_trace_event_t *ev = &trace_ring[index & PERF_TRACE_MASK];
+    if (__atomic_load_n(&ev->seq, __ATOMIC_ACQUIRE) != index + 1) {
+        return false;
+    }
+    out->timestamp_us = ev->timestamp_us;
+    out->value = ev->value;
+    out->id = ev->id;
+    out->type = ev->type;
+    out->core = ev->core;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ev->seq, __ATOMIC_RELAXED) == index + 1;
+}
+
+const char *perf_trace_name(perf_trace_id_t id) {
+    if ((unsigned)id >= PERF_TRACE_ID_COUNT || trace_names[id] == NULL) {
+        return "unknown";
+    }
+    return trace_names[id];
+}
+
+/* ============================================================================
+ * CHROME TRACE JSON EXPORT
+ * ============================================================================ */
+
+typedef struct {
+    perf_trace_write_fn write;
+    void *ctx;
+    char buf[PERF_TRACE_CHUNK_SIZE];
+    size_t used;
+    int error;
+} trace_writer_t;
+
+static void writer_flush(trace_writer_t *w) {
+    if (w->used > 0 && !w->error) {
+        w->error = w->write(w->ctx, w->buf, w->used);
+    }
+    w->used = 0;
+}
+
+static void writer_printf(trace_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void writer_printf(trace_writer_t *w, const char *fmt, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len <= 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof(line)) {
+        len = sizeof(line) - 1;
+    }
+    if (w->used + len > sizeof(w->buf)) {
+        writer_flush(w);
+    }
+    memcpy(w->buf + w->used, line, len);
+    w->used += len;
+}
+
+int perf_trace_export_json(perf_trace_write_fn write, void *ctx) {
+    if (trace_ring == NULL || write == NULL) {
+        return -1;
+    }
+
+    // Pause recording so the ring is not overwritten under the export. A
+    // writer still filling its slot leaves it uncommitted, and it is skipped.
+    bool was_enabled = trace_enabled;
+    trace_enabled = false;
+
+    uint32_t head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+    uint32_t count = head - __atomic_load_n(&trace_start, __ATOMIC_RELAXED);
+    if (count > PERF_TRACE_CAPACITY) {
+        count = PERF_TRACE_CAPACITY;
+    }
+    uint32_t first = head - count;
+
+    trace_writer_t *w = malloc(sizeof(trace_writer_t));
+    if (w == NULL) {
+        trace_enabled = was_enabled;
+        return -1;
+    }
+    w->write = write;
+    w->ctx = ctx;
+    w->used = 0;
+    w->error = 0;
+
+    writer_printf(w, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    writer_printf(w, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"esp32-doom\"}}");
+    for (int core = 0; core < PERF_TRACE_MAX_CORES; core++) {
+        writer_printf(w, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"core %d\"}}",
+                      core, core);
+    }
+
+    // Timestamps are exported relative to the earliest event so 32-bit wrap
+    // is harmless. A slot is claimed before its time is read, so on another
+    // core a later slot can hold an earlier time: take the minimum, compared
+    // as signed distances from the first event, not the first slot's time.
+    uint32_t base = 0;
+    bool have_base = false;
+    for (uint32_t i = 0; i < count; i++) {
+        perf_trace_event_t slot;
+        if (!trace_read_slot(first + i, &slot)) {
+            continue;
+        }
+        if (!have_base || (int32_t)(slot.timestamp_us - base) < 0) {
+            base = slot.timestamp_us;
+            have_base = true;
+        }
+    }
+    // Per-core open span depth, used to drop ends whose begin was overwritten
+    int depth[PERF_TRACE_MAX_CORES] = {0};
+
+    for (uint32_t i = 0; i < count && !w->error; i++) {
+        perf_trace_event_t slot;
+        const perf_trace_event_t *ev = &slot;
+        if (!trace_read_slot(first + i, &slot)) {
+            continue;
+        }
+        // A slot committed after the first pass may still be earlier
+        int32_t delta = (int32_t)(ev->timestamp_us - base);
+        uint32_t ts = delta > 0 ? (uint32_t)delta : 0;
+        int core = ev->core < PERF_TRACE_MAX_CORES ? ev->core : 0;
+        const char *name = perf_trace_name((perf_trace_id_t)ev->id);
+
+        switch (ev->type) {
+            case PERF_TRACE_EVENT_BEGIN:
+                depth[core]++;
+                writer_printf(w, ",\n{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%lu,\"pid\":0,\"tid\":%d}",
+                              name, (unsigned long)ts, core);
+                break;
+            case PERF_TRACE_EVENT_END:
+                if (depth[core] == 0) {
+                    break;
+                }
+                depth[core]--;
+                writer_printf(w, ",\n{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%lu,\"pid\":0,\"tid\":%d}",
+                              name, (unsigned long)ts, core);
+                break;
+            case PERF_TRACE_EVENT_COUNTER:
+                writer_printf(w, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%lu,\"pid\":0,\"args\":{\"value\":%ld}}",
+                              name, (unsigned long)ts, (long)ev->value);
+                break;
+            case PERF_TRACE_EVENT_INSTANT:
+                writer_printf(w, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lu,\"pid\":0,\"tid\":%d,\"args\":{\"value\":%ld}}",
+                              name, (unsigned long)ts, core, (long)ev->value);
+                break;
+            default:
+                break;
+        }
+    }
+
+    writer_printf(w, "\n]}\n");
+    writer_flush(w);
+
+    int result = w->error;
+    free(w);
+    trace_enabled = was_enabled;
+    return result;
+}
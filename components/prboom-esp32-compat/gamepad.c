@@ -15,6 +15,7 @@
 #include "freertos/queue.h"
 #include "input_handler.h"
 #include "esp_log.h"
+#include "perf_trace.h"
 
 #define TAG "gamepad"
 
@@ -52,6 +53,7 @@ void gamepadPoll(void)
     
     // Process all available input events
     while (xQueueReceive(input_queue, &input_event, 0) == pdTRUE) {
+        PERF_TRACE_INSTANT(PERF_TRACE_INPUT_POST, input_event.type);
         switch (input_event.type) {
             case INPUT_KEYDOWN:
                 ev.type = ev_keydown;
@@ -34,17 +34,17 @@
  *-----------------------------------------------------------------------------*/
 
 # include "config.h"
-#ifdef HAVE_NETINET_IN_H
-# include <netinet/in.h>
-#endif
 #include <stdlib.h>
 #include <errno.h>
-#ifdef HAVE_UNISTD_H
 #include <unistd.h>
-#endif
 #include <stdio.h>
 #include <fcntl.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
 
 #ifdef HAVE_NET
 
@@ -52,50 +52,116 @@
 #include "protocol.h"
 #include "i_network.h"
 #include "lprintf.h"
+#include "esp_task_wdt.h"
+
+/* Client side of the PrBoom UDP protocol, on lwIP sockets. The game joins a
+ * tic relay (tools/tic_relay.c) with -net host[:port]; d_client.c does the
+ * rest. Tics are already batched by the protocol: every PKT_TICC carries all
+ * tics the relay has not acknowledged plus the last `extratic` ones again, so
+ * a lost packet is normally covered by the next one without a round trip.
+ */
+
+#define NET_DEFAULT_PORT  5030
+#define NET_WAIT_SLICE_MS 1000  // feed the task watchdog while waiting
+
+UDP_CHANNEL sentfrom;
+int v4socket = -1, v6socket = -1;
+size_t sentbytes, recvdbytes;
 
 void I_ShutdownNetwork(void)
 {
+  if (v4socket >= 0) {
+    lprintf(LO_INFO, "I_ShutdownNetwork: sent %u bytes, received %u bytes\n",
+            (unsigned)sentbytes, (unsigned)recvdbytes);
+    close(v4socket);
+    v4socket = -1;
+  }
 }
 
 void I_InitNetwork(void)
 {
+  atexit(I_ShutdownNetwork);
 }
 
-UDP_PACKET *I_AllocPacket(int size)
+void I_SetupSocket(int sock, int port, int family)
 {
-}
+  struct sockaddr_in addr;
 
-void I_FreePacket(UDP_PACKET *packet)
-{
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = family;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(sock, (struct sockaddr *)&addr, sizeof addr) < 0)
+    I_Error("I_SetupSocket: bind failed: %s", strerror(errno));
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
 }
 
 void I_WaitForPacket(int ms)
 {
+  if (v4socket < 0)
+    return; // no relay yet, nothing to wait on
+
+  do {
+    struct timeval tv;
+    fd_set fds;
+    int slice = ms < NET_WAIT_SLICE_MS ? ms : NET_WAIT_SLICE_MS;
+
+    FD_ZERO(&fds);
+    FD_SET(v4socket, &fds);
+    tv.tv_sec = slice / 1000;
+    tv.tv_usec = (slice % 1000) * 1000;
+    if (select(v4socket + 1, &fds, NULL, NULL, &tv) > 0)
+      return;
+    if (esp_task_wdt_status(NULL) == ESP_OK)
+      esp_task_wdt_reset();
+    ms -= slice;
+  } while (ms > 0);
 }
 
+/* Accepts "host" or "host:port"; the UDP socket is connected to the relay so
+ * the stack drops datagrams from anyone else */
 int I_ConnectToServer(const char *serv)
 {
+  struct addrinfo hints, *res;
+  char host[64], port[8];
+  const char *colon = strrchr(serv, ':');
+  size_t hostlen = colon ? (size_t)(colon - serv) : strlen(serv);
+
+  if (hostlen >= sizeof host)
+    return -1;
+  memcpy(host, serv, hostlen);
+  host[hostlen] = 0;
+  snprintf(port, sizeof port, "%d", colon ? atoi(colon + 1) : NET_DEFAULT_PORT);
+
+  memset(&hints, 0, sizeof hints);
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host, port, &hints, &res) != 0 || !res) {
+    lprintf(LO_ERROR, "I_ConnectToServer: cannot resolve %s\n", serv);
+    return -1;
+  }
+
+  if (v4socket < 0) {
+    v4socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (v4socket < 0) {
+      freeaddrinfo(res);
+      return -1;
+    }
+    I_SetupSocket(v4socket, 0, AF_INET);
+  }
+  if (connect(v4socket, res->ai_addr, res->ai_addrlen) < 0) {
+    lprintf(LO_ERROR, "I_ConnectToServer: %s\n", strerror(errno));
+    freeaddrinfo(res);
+    return -1;
+  }
+  freeaddrinfo(res);
+  lprintf(LO_INFO, "I_ConnectToServer: tic relay at %s:%s\n", host, port);
   return 0;
 }
 
 void I_Disconnect(void)
 {
-}
-
-UDP_SOCKET I_Socket(Uint16 port)
-{
-}
-
-void I_CloseSocket(UDP_SOCKET sock)
-{
-}
-
-UDP_CHANNEL I_RegisterPlayer(IPaddress *ipaddr)
-{
-}
-
-void I_UnRegisterPlayer(UDP_CHANNEL channel)
-{
+  I_ShutdownNetwork();
 }
 
 /*
@@ -119,19 +185,42 @@ static byte ChecksumPacket(const packet_header_t* buffer, size_t len)
 
 size_t I_GetPacket(packet_header_t* buffer, size_t buflen)
 {
-  return 0;
+  socklen_t fromlen = sizeof sentfrom;
+  ssize_t len;
+
+  if (v4socket < 0)
+    return 0;
+
+  len = recvfrom(v4socket, buffer, buflen, 0, &sentfrom, &fromlen);
+  if (len < (ssize_t)sizeof(packet_header_t))
+    return 0;
+  recvdbytes += len;
+  // Corrupt packets are dropped; the protocol recovers them like lost ones
+  if (buffer->checksum != ChecksumPacket(buffer, len))
+    return 0;
+  return len;
 }
 
 void I_SendPacket(packet_header_t* packet, size_t len)
 {
+  packet->checksum = ChecksumPacket(packet, len);
+  if (v4socket >= 0 && send(v4socket, packet, len, 0) == (ssize_t)len)
+    sentbytes += len;
 }
 
 void I_SendPacketTo(packet_header_t* packet, size_t len, UDP_CHANNEL *to)
 {
+  packet->checksum = ChecksumPacket(packet, len);
+  if (v4socket >= 0 && sendto(v4socket, packet, len, 0, to, sizeof(struct sockaddr_in)) == (ssize_t)len)
+    sentbytes += len;
 }
 
 void I_PrintAddress(FILE* fp, UDP_CHANNEL *addr)
 {
+  const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+  char buf[16];
+
+  fprintf(fp, "%s:%d", inet_ntop(AF_INET, &in->sin_addr, buf, sizeof buf), ntohs(in->sin_port));
 }
 
 #endif /* HAVE_NET */
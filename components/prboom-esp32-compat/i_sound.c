@@ -34,6 +34,8 @@
 
 #include "config.h"
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 
@@ -43,6 +45,7 @@
 #include "i_sound.h"
 #include "m_argv.h"
 #include "m_misc.h"
+#include "i_system.h"
 #include "w_wad.h"
 #include "lprintf.h"
 #include "s_sound.h"
@@ -53,27 +56,466 @@
 
 #include "d_main.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "websocket_server.h"
+#include "perf_clock.h"
+
 int snd_card = 0;
 int mus_card = 0;
 int snd_samplerate = 0;
+int snd_events = 1;
+
+/* There is no audio hardware on the board, so sound effects are mixed here
+ * and streamed to the browser. DMX lumps are 8-bit unsigned mono. Each voice
+ * is stepped through its lump with a 16.16 fixed-point increment (pitch and
+ * rate conversion in one), panned into a 16-bit stereo block, and the block
+ * is IMA-ADPCM encoded (4 bits per sample) and queued on the game WebSocket
+ * as a WS_MSG_AUDIO message. Mixing runs on its own low-priority task on the
+ * network core, woken by an esp_timer once per block.
+ *
+ * WS_MSG_AUDIO payload, little-endian:
+ *   [0]     format (SND_FORMAT_IMA_STEREO)
+ *   [1]     reserved
+ *   [2..3]  sample rate
+ *   [4..5]  samples per channel
+ *   [6..7]  block sequence number
+ *   [8..9]  left predictor   [10..11] right predictor
+ *   [12]    left step index  [13]     right step index
+ *   [14..]  one byte per sample: left nibble low, right nibble high
+ *
+ * With snd_events set (the default) nothing is mixed at all. Starts, stops and
+ * parameter changes are sent as WS_MSG_SOUND events, batched per frame by
+ * I_UpdateSound. The browser fetches each sfx lump once from /sfx?id=N and
+ * plays it with WebAudio. The device only keeps track of when each voice
+ * ends, for I_SoundIsPlaying.
+ *
+ * WS_MSG_SOUND payload: [0] event count, then SND_EVENT_SIZE bytes each:
+ *   [0] kind (SND_EVENT_*)  [1] channel  [2..3] sfx id
+ *   [4] volume 0-127  [5] separation 0-255  [6] pitch 0-255  [7] reserved
+ *   [8..11] gametic the event was issued on
+ */
+
+#define MAX_CHANNELS        32
+#define SND_MIX_RATE        11025
+#define SND_BLOCK_SAMPLES   512
+#define SND_FORMAT_IMA_STEREO 1
+#define SND_HEADER_SIZE     14
+#define SND_MIXER_STACK     3072
+#define SND_MIXER_PRIORITY  2
+#define SND_MIXER_CORE      0
+
+#define SND_EVENT_START     1
+#define SND_EVENT_STOP      2
+#define SND_EVENT_UPDATE    3
+#define SND_EVENT_SIZE      12
+#define SND_EVENT_BATCH     32
+
+typedef struct {
+  const unsigned char *data;    // current sample, NULL when idle
+  const unsigned char *enddata;
+  unsigned int samplerate;
+  unsigned int step;            // 16.16 source samples per output sample
+  unsigned int stepremainder;   // fractional source position
+  int leftvol;                  // 0-127
+  int rightvol;
+  unsigned int generation;      // bumped on every start/stop
+} channel_info_t;
+
+typedef struct {
+  int predictor;
+  int index;
+} adpcm_state_t;
+
+// Channel state is written by the game task and consumed by the mixer task
+static channel_info_t channelinfo[MAX_CHANNELS];
+static portMUX_TYPE channel_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Pitch 0-255 to a 16.16 multiplier, 128 = unchanged, +-64 = one octave
+static int steptable[256];
+
+// Every sfx lump, resolved once at init so any task can serve it
+static struct {
+  const unsigned char *data;
+  int len;
+} sfx_lumps[NUMSFX];
+
+// Event backend: pending batch and the time each voice ends
+static unsigned char event_batch[2 + SND_EVENT_BATCH * SND_EVENT_SIZE];
+static int event_count;
+static uint64_t event_end_us[MAX_CHANNELS];
+static unsigned char event_params[MAX_CHANNELS][3]; // last vol/sep/pitch sent
+static boolean sound_ready;
+
+static TaskHandle_t mixer_task;
+static esp_timer_handle_t mixer_timer;
+static sound_stats_t sound_stats;
+
+static const signed char ima_index_table[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const short ima_step_table[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+
+static unsigned char I_AdpcmEncode(adpcm_state_t *st, int sample)
+{
+  int step = ima_step_table[st->index];
+  int diff = sample - st->predictor;
+  int delta = step >> 3;
+  unsigned char nibble = 0;
+
+  if (diff < 0) {
+    nibble = 8;
+    diff = -diff;
+  }
+  if (diff >= step) {
+    nibble |= 4;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    nibble |= 2;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    nibble |= 1;
+    delta += step;
+  }
+
+  st->predictor += (nibble & 8) ? -delta : delta;
+  if (st->predictor > 32767)
+    st->predictor = 32767;
+  else if (st->predictor < -32768)
+    st->predictor = -32768;
+
+  st->index += ima_index_table[nibble];
+  if (st->index < 0)
+    st->index = 0;
+  else if (st->index > 88)
+    st->index = 88;
+
+  return nibble;
+}
+
+// Must be called with channel_lock held
+static void I_SetChannelParams(channel_info_t *c, int volume, int seperation, int pitch)
+{
+  int leftvol, rightvol;
+
+  // DMX-style x^2 separation: 0 is hard left, 128 centre, 255 hard right
+  seperation += 1;
+  leftvol = volume - ((volume*seperation*seperation) >> 16);
+  seperation = seperation - 257;
+  rightvol = volume - ((volume*seperation*seperation) >> 16);
+
+  c->leftvol = leftvol < 0 ? 0 : leftvol > 127 ? 127 : leftvol;
+  c->rightvol = rightvol < 0 ? 0 : rightvol > 127 ? 127 : rightvol;
+
+  if (pitch < 0 || pitch > 255)
+    pitch = 128;
+  c->step = (unsigned int)((((unsigned long long)c->samplerate << 16) / SND_MIX_RATE *
+                            steptable[pitch]) >> 16);
+}
+
+// Mix one block from a snapshot of the channels, then write the positions
+// back for voices the game did not restart or stop in the meantime.
+// Returns the number of voices that played.
+static int I_MixBlock(short *out, int render)
+{
+  static channel_info_t mix[MAX_CHANNELS]; // mixer task only, keeps it off the stack
+  int i, n, voices = 0;
+
+  portENTER_CRITICAL(&channel_lock);
+  memcpy(mix, channelinfo, sizeof(mix));
+  portEXIT_CRITICAL(&channel_lock);
+
+  if (render)
+    memset(out, 0, SND_BLOCK_SAMPLES * 2 * sizeof(*out));
+
+  for (i = 0; i < MAX_CHANNELS; i++)
+  {
+    channel_info_t *c = &mix[i];
+    const unsigned char *data = c->data;
+    unsigned int frac = c->stepremainder;
+    int lv = c->leftvol * 2, rv = c->rightvol * 2;
+
+    if (!data)
+      continue;
+    voices++;
+
+    for (n = 0; n < SND_BLOCK_SAMPLES && data < c->enddata; n++)
+    {
+      if (render)
+      {
+        int sample = *data - 128;
+        int l = out[2*n] + sample * lv;
+        int r = out[2*n+1] + sample * rv;
+        out[2*n] = l > 32767 ? 32767 : l < -32768 ? -32768 : l;
+        out[2*n+1] = r > 32767 ? 32767 : r < -32768 ? -32768 : r;
+      }
+      frac += c->step;
+      data += frac >> 16;
+      frac &= 0xffff;
+    }
 
+    c->data = data < c->enddata ? data : NULL;
+    c->stepremainder = frac;
+  }
+
+  portENTER_CRITICAL(&channel_lock);
+  for (i = 0; i < MAX_CHANNELS; i++)
+    if (mix[i].generation == channelinfo[i].generation && channelinfo[i].data)
+    {
+      channelinfo[i].data = mix[i].data;
+      channelinfo[i].stepremainder = mix[i].stepremainder;
+    }
+  portEXIT_CRITICAL(&channel_lock);
+
+  return voices;
+}
+
+static void I_MixerWake(void *arg)
+{
+  xTaskNotifyGive(mixer_task);
+}
+
+static void I_MixerTask(void *arg)
+{
+  static short block[SND_BLOCK_SAMPLES * 2];
+  static unsigned char message[1 + SND_HEADER_SIZE + SND_BLOCK_SAMPLES];
+  adpcm_state_t left = {0, 0}, right = {0, 0};
+  unsigned short sequence = 0;
+
+  for (;;)
+  {
+    uint64_t start;
+    int listeners, voices, n;
+    unsigned char *p;
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    start = perf_now_us();
+
+    // Voices keep advancing without listeners so I_SoundIsPlaying stays true
+    listeners = websocket_server_audio_listeners();
+    voices = I_MixBlock(block, listeners > 0);
+    sound_stats.voices = voices;
+    if (!listeners || !voices)
+    {
+      // Silence is not sent; the client just runs out of queued audio
+      left.predictor = right.predictor = 0;
+      sound_stats.busy_us += perf_now_us() - start;
+      continue;
+    }
+
+    p = message;
+    *p++ = WS_MSG_AUDIO;
+    *p++ = SND_FORMAT_IMA_STEREO;
+    *p++ = 0;
+    *p++ = SND_MIX_RATE & 0xff;
+    *p++ = SND_MIX_RATE >> 8;
+    *p++ = SND_BLOCK_SAMPLES & 0xff;
+    *p++ = SND_BLOCK_SAMPLES >> 8;
+    *p++ = sequence & 0xff;
+    *p++ = sequence >> 8;
+    *p++ = left.predictor & 0xff;
+    *p++ = (left.predictor >> 8) & 0xff;
+    *p++ = right.predictor & 0xff;
+    *p++ = (right.predictor >> 8) & 0xff;
+    *p++ = left.index;
+    *p++ = right.index;
+    for (n = 0; n < SND_BLOCK_SAMPLES; n++)
+      *p++ = I_AdpcmEncode(&left, block[2*n]) | (I_AdpcmEncode(&right, block[2*n+1]) << 4);
+    sequence++;
+
+    if (websocket_server_queue_message(message, p - message) == 0)
+    {
+      sound_stats.blocks++;
+      sound_stats.bytes += p - message;
+    }
+    else
+      sound_stats.blocks_dropped++;
+    sound_stats.busy_us += perf_now_us() - start;
+  }
+}
+
+void I_GetSoundStats(sound_stats_t *stats)
+{
+  *stats = sound_stats;
+}
+
+const void *I_GetSfxLump(int id, int *len)
+{
+  if (id < 1 || id >= NUMSFX || !sfx_lumps[id].data)
+    return NULL;
+  *len = sfx_lumps[id].len;
+  return sfx_lumps[id].data;
+}
+
+// Locate the samples of a DMX lump: format 3, rate, then a sample count that
+// includes 16 pad bytes at each end. Returns false for unusable lumps.
+static boolean I_ParseSfx(int id, const unsigned char **samples, unsigned int *len,
+                          unsigned int *samplerate)
+{
+  const unsigned char *data;
+  unsigned int samplelen;
+  int lumplen;
+
+  if (!(data = I_GetSfxLump(id, &lumplen)))
+    return false;
+  if (lumplen <= 8 || data[0] != 3 || data[1] != 0)
+    return false;
+
+  *samplerate = data[2] | (data[3] << 8);
+  samplelen = data[4] | (data[5] << 8) | (data[6] << 16) | ((unsigned)data[7] << 24);
+  if (samplelen > (unsigned)lumplen - 8)
+    samplelen = lumplen - 8;
+  data += 8;
+  if (samplelen > 32)
+  {
+    data += 16;
+    samplelen -= 32;
+  }
+
+  *samples = data;
+  *len = samplelen;
+  return *samplerate && samplelen;
+}
+
+static void I_FlushSoundEvents(void)
+{
+  if (!event_count)
+    return;
+  event_batch[0] = WS_MSG_SOUND;
+  event_batch[1] = event_count;
+  if (websocket_server_queue_message(event_batch, 2 + event_count * SND_EVENT_SIZE) == 0)
+  {
+    sound_stats.blocks++;
+    sound_stats.bytes += 2 + event_count * SND_EVENT_SIZE;
+  }
+  else
+    sound_stats.blocks_dropped++;
+  event_count = 0;
+}
+
+static void I_QueueSoundEvent(int kind, int channel, int id, int vol, int sep, int pitch)
+{
+  unsigned char *e;
+
+  if (event_count == SND_EVENT_BATCH)
+    I_FlushSoundEvents();
+
+  event_params[channel][0] = vol;
+  event_params[channel][1] = sep;
+  event_params[channel][2] = pitch;
+
+  e = event_batch + 2 + event_count++ * SND_EVENT_SIZE;
+  e[0] = kind;
+  e[1] = channel;
+  e[2] = id & 0xff;
+  e[3] = id >> 8;
+  e[4] = vol;
+  e[5] = sep;
+  e[6] = pitch;
+  e[7] = 0;
+  e[8] = gametic & 0xff;
+  e[9] = (gametic >> 8) & 0xff;
+  e[10] = (gametic >> 16) & 0xff;
+  e[11] = (gametic >> 24) & 0xff;
+}
+
+// Send the events of this frame
+void I_UpdateSound(void)
+{
+  if (snd_events)
+    I_FlushSoundEvents();
+}
 
 void I_UpdateSoundParams(int handle, int volume, int seperation, int pitch)
 {
+  if (handle < 0 || handle >= MAX_CHANNELS)
+    return;
+
+  if (snd_events)
+  {
+    // Positional sounds are re-evaluated every frame; only changes go out
+    if (I_SoundIsPlaying(handle) &&
+        (event_params[handle][0] != volume || event_params[handle][1] != seperation ||
+         event_params[handle][2] != pitch))
+      I_QueueSoundEvent(SND_EVENT_UPDATE, handle, 0, volume, seperation, pitch);
+    return;
+  }
+
+  portENTER_CRITICAL(&channel_lock);
+  if (channelinfo[handle].data)
+    I_SetChannelParams(&channelinfo[handle], volume, seperation, pitch);
+  portEXIT_CRITICAL(&channel_lock);
 }
 
 
 void I_SetChannels(void)
 {
+  int i;
+
+  for (i = 0; i < 256; i++)
+    steptable[i] = (int)(pow(2.0, (i - 128) / 64.0) * 65536.0);
 }
 
 int I_GetSfxLumpNum(sfxinfo_t* sfx)
 {
-    return 1;
+  char namebuf[9];
+
+  // Linked sounds (chaingun, ...) play their link's lump at another pitch
+  if (sfx->link)
+    sfx = sfx->link;
+  sprintf(namebuf, "ds%s", sfx->name);
+  return W_CheckNumForName(namebuf);
 }
 
 int I_StartSound(int id, int channel, int vol, int sep, int pitch, int priority)
 {
+  const unsigned char *data;
+  unsigned int samplerate, samplelen;
+  channel_info_t *c;
+
+  if (channel < 0 || channel >= MAX_CHANNELS || !sound_ready)
+    return -1;
+  if (!I_ParseSfx(id, &data, &samplelen, &samplerate))
+    return -1;
+  if (pitch < 0 || pitch > 255)
+    pitch = 128;
+
+  if (snd_events)
+  {
+    // The client plays the whole lump; remember when it will be done
+    event_end_us[channel] = perf_now_us() +
+      (uint64_t)samplelen * 1000000 * 65536 / ((uint64_t)samplerate * steptable[pitch]);
+    I_QueueSoundEvent(SND_EVENT_START, channel, id, vol, sep, pitch);
+    return channel;
+  }
+
+  c = &channelinfo[channel];
+  portENTER_CRITICAL(&channel_lock);
+  c->data = data;
+  c->enddata = data + samplelen;
+  c->samplerate = samplerate;
+  c->stepremainder = 0;
+  c->generation++;
+  I_SetChannelParams(c, vol, sep, pitch);
+  portEXIT_CRITICAL(&channel_lock);
+
   return channel;
 }
 
@@ -81,17 +523,41 @@ int I_StartSound(int id, int channel, int vol, int sep, int pitch, int priority)
 
 void I_StopSound (int handle)
 {
+  if (handle < 0 || handle >= MAX_CHANNELS)
+    return;
+
+  if (snd_events)
+  {
+    if (I_SoundIsPlaying(handle))
+      I_QueueSoundEvent(SND_EVENT_STOP, handle, 0, 0, 0, 0);
+    event_end_us[handle] = 0;
+    return;
+  }
+
+  portENTER_CRITICAL(&channel_lock);
+  channelinfo[handle].data = NULL;
+  channelinfo[handle].generation++;
+  portEXIT_CRITICAL(&channel_lock);
 }
 
 
 int I_SoundIsPlaying(int handle)
 {
+  if (handle < 0 || handle >= MAX_CHANNELS)
     return 0;
+  if (snd_events)
+    return perf_now_us() < event_end_us[handle];
+  return channelinfo[handle].data != NULL;
 }
 
 
 int I_AnySoundStillPlaying(void)
 {
+  int i;
+
+  for (i = 0; i < MAX_CHANNELS; i++)
+    if (I_SoundIsPlaying(i))
+      return true;
   return false;
 }
 
@@ -99,50 +565,457 @@ int I_AnySoundStillPlaying(void)
 
 void I_ShutdownSound(void)
 {
+  sound_ready = false;
+  if (mixer_timer)
+  {
+    esp_timer_stop(mixer_timer);
+    esp_timer_delete(mixer_timer);
+    mixer_timer = NULL;
+  }
+  if (mixer_task)
+  {
+    vTaskDelete(mixer_task);
+    mixer_task = NULL;
+  }
 }
 
-//static SDL_AudioSpec audio;
-
 void I_InitSound(void)
 {
+  esp_timer_create_args_t args = {
+    .callback = I_MixerWake,
+    .name = "snd_mixer",
+  };
+
+  int i;
+
+  if (!nomusicparm)
+    I_InitMusic();
+  if (nosfxparm || sound_ready)
+    return;
+
+  I_SetChannels();
+  for (i = 1; i < NUMSFX; i++)
+  {
+    int lump = I_GetSfxLumpNum(&S_sfx[i]);
+    if (lump >= 0)
+    {
+      sfx_lumps[i].data = W_CacheLumpNum(lump); // memory-mapped, never released
+      sfx_lumps[i].len = W_LumpLength(lump);
+    }
+  }
+
+  if (snd_events)
+  {
+    sound_ready = true;
+    lprintf(LO_INFO, "I_InitSound: sending sound events, the browser mixes\n");
+    return;
+  }
+
+  // The stream rate is fixed; DMX sfx are 11025 Hz anyway
+  snd_samplerate = SND_MIX_RATE;
+  sound_stats.mix_rate = SND_MIX_RATE;
+
+  if (xTaskCreatePinnedToCore(I_MixerTask, "snd_mixer", SND_MIXER_STACK, NULL,
+                              SND_MIXER_PRIORITY, &mixer_task, SND_MIXER_CORE) != pdPASS)
+  {
+    lprintf(LO_WARN, "I_InitSound: could not start the mixer task\n");
+    mixer_task = NULL;
+    return;
+  }
+  if (esp_timer_create(&args, &mixer_timer) != ESP_OK ||
+      esp_timer_start_periodic(mixer_timer, 1000000ULL * SND_BLOCK_SAMPLES / SND_MIX_RATE) != ESP_OK)
+  {
+    lprintf(LO_WARN, "I_InitSound: could not start the mixer timer\n");
+    I_ShutdownSound();
+    return;
+  }
+
+  sound_ready = true;
+  lprintf(LO_INFO, "I_InitSound: mixing %d channels at %d Hz, IMA-ADPCM over WebSocket\n",
+          MAX_CHANNELS, SND_MIX_RATE);
+  atexit(I_ShutdownSound);
+}
+
+
+
+
+/* Music is not converted to MIDI or synthesized here. A MUS sequencer walks
+ * the score on the tic clock (MUS runs at 140 Hz, four ticks per tic) and
+ * sends the events to the browser, which plays them on a small WebAudio synth.
+ * Each I_UpdateMusic call handles everything due up to the end of the current
+ * tic, and the events go out as one WS_MSG_MUSIC message per frame. A tune
+ * costs a few hundred bytes per second and almost no CPU.
+ *
+ * Note volumes are resolved here, so a play event always carries its
+ * velocity. The browser keeps program, controllers and pitch bend per channel.
+ * Whenever a new listener subscribes, that state is sent again so the client
+ * can join a song in progress.
+ *
+ * WS_MSG_MUSIC payload, little-endian:
+ *   [0]     event count
+ *   [1]     reserved
+ *   [2..5]  song time of the batch, in 140 Hz ticks
+ *   then MUS_EVENT_SIZE bytes each:
+ *   [0] ticks after the batch time  [1] kind << 4 | MUS channel (15 = drums)
+ *   [2] data1  [3] data2
+ *
+ * Kinds 0-4 are MUS events: release (note), play (note, velocity), pitch bend
+ * (0-255, 128 centre), system (MUS 10-14) and controller (MUS 0-9, value).
+ * MUS_EV_SONG reports the song state in data1 (MUS_SONG_*) and the music
+ * volume (0-15) in data2.
+ */
+
+#define MUS_TICKS_PER_TIC   4
+#define MUS_EVENT_SIZE      4
+#define MUS_EVENT_BATCH     64
+#define MUS_HEADER_SIZE     6
+#define MUS_MAX_LAG         (TICRATE * MUS_TICKS_PER_TIC) // catch up at most 1 s
+#define MUS_MAX_STEPS       1024                          // events per update, the rest wait a frame
+#define MUS_CONTROLLERS     10
+
+#define MUS_EV_RELEASE      0
+#define MUS_EV_PLAY         1
+#define MUS_EV_PITCH        2
+#define MUS_EV_SYSTEM       3
+#define MUS_EV_CONTROL      4
+#define MUS_EV_MEASURE      5
+#define MUS_EV_END          6
+#define MUS_EV_SONG         8
+
+#define MUS_SONG_STOPPED    0
+#define MUS_SONG_PLAYING    1
+#define MUS_SONG_PAUSED     2
+
+static struct {
+  const unsigned char *score;   // first event, NULL when nothing is registered
+  const unsigned char *end;
+  const unsigned char *pos;     // next event
+  int state;                    // MUS_SONG_*
+  boolean looping;
+  int base_tic;                 // real tic at song time 0
+  int paused_tic;
+  unsigned int next;            // song time of the event at pos
+  unsigned int now;             // song time handled so far
+  unsigned int loop_time;       // song time the score last started over
+  int volume;                   // 0-15
+  int listeners;
+  unsigned short used;          // channels that had events
+  unsigned char velocity[16];   // sticky MUS note volume per channel
+  unsigned char pitch[16];
+  unsigned char controller[16][MUS_CONTROLLERS];
+} seq;
+
+static unsigned char music_batch[1 + MUS_HEADER_SIZE + MUS_EVENT_BATCH * MUS_EVENT_SIZE];
+static int music_count;
+static unsigned int music_batch_time;
+
+static void I_FlushMusicEvents(void)
+{
+  int len = 1 + MUS_HEADER_SIZE + music_count * MUS_EVENT_SIZE;
+
+  if (!music_count)
+    return;
+  music_batch[0] = WS_MSG_MUSIC;
+  music_batch[1] = music_count;
+  music_batch[2] = 0;
+  music_batch[3] = music_batch_time & 0xff;
+  music_batch[4] = (music_batch_time >> 8) & 0xff;
+  music_batch[5] = (music_batch_time >> 16) & 0xff;
+  music_batch[6] = (music_batch_time >> 24) & 0xff;
+  if (websocket_server_queue_message(music_batch, len) == 0)
+  {
+    sound_stats.music_events += music_count;
+    sound_stats.music_bytes += len;
+  }
+  music_count = 0;
+}
+
+static void I_QueueMusicEvent(unsigned int time, int kind, int channel, int data1, int data2)
+{
+  unsigned char *e;
+
+  if (music_count == MUS_EVENT_BATCH || (music_count && time - music_batch_time > 255))
+    I_FlushMusicEvents();
+  if (!music_count)
+    music_batch_time = time;
+
+  e = music_batch + 1 + MUS_HEADER_SIZE + music_count++ * MUS_EVENT_SIZE;
+  e[0] = time - music_batch_time;
+  e[1] = (kind << 4) | channel;
+  e[2] = data1;
+  e[3] = data2;
 }
 
+static void I_SongState(int state)
+{
+  seq.state = state;
+  I_QueueMusicEvent(seq.now, MUS_EV_SONG, 0, state, seq.volume);
+}
+
+static void I_ResetSongChannels(void)
+{
+  int ch;
+
+  seq.used = 0;
+  for (ch = 0; ch < 16; ch++)
+  {
+    seq.velocity[ch] = 127;
+    seq.pitch[ch] = 128;
+    memset(seq.controller[ch], 0, MUS_CONTROLLERS);
+    seq.controller[ch][3] = 127;   // volume
+    seq.controller[ch][4] = 64;    // pan
+    seq.controller[ch][5] = 127;   // expression
+  }
+}
+
+// Bring a newly subscribed client up to date with the song in progress
+static void I_SendSongSnapshot(void)
+{
+  int ch, c;
+
+  I_SongState(seq.state);
+  for (ch = 0; ch < 16; ch++)
+  {
+    if (!(seq.used & (1 << ch)))
+      continue;
+    for (c = 0; c < MUS_CONTROLLERS; c++)
+      I_QueueMusicEvent(seq.now, MUS_EV_CONTROL, ch, c, seq.controller[ch][c]);
+    I_QueueMusicEvent(seq.now, MUS_EV_PITCH, ch, seq.pitch[ch], 0);
+  }
+}
+
+// Handle one MUS event at seq.pos; returns false when the song is over
+static boolean I_SongStep(void)
+{
+  const unsigned char *p = seq.pos;
+  int desc, kind, ch, data1 = 0, data2 = 0;
+  boolean last;
+
+  if (p >= seq.end)
+    return false;
+  desc = *p++;
+  kind = (desc >> 4) & 7;
+  ch = desc & 15;
+  last = (desc & 0x80) != 0;
 
+  switch (kind)
+  {
+    case MUS_EV_RELEASE:
+      if (p >= seq.end)
+        return false;
+      data1 = *p++ & 0x7f;
+      break;
+    case MUS_EV_PLAY:
+      if (p >= seq.end)
+        return false;
+      data1 = *p++;
+      if (data1 & 0x80)
+      {
+        if (p >= seq.end)
+          return false;
+        seq.velocity[ch] = *p++ & 0x7f;
+      }
+      data1 &= 0x7f;
+      data2 = seq.velocity[ch];
+      break;
+    case MUS_EV_PITCH:
+      if (p >= seq.end)
+        return false;
+      data1 = seq.pitch[ch] = *p++;
+      break;
+    case MUS_EV_SYSTEM:
+      if (p >= seq.end)
+        return false;
+      data1 = *p++ & 0x7f;
+      break;
+    case MUS_EV_CONTROL:
+      if (p + 1 >= seq.end)
+        return false;
+      data1 = *p++ & 0x7f;
+      data2 = *p++ & 0x7f;
+      if (data1 < MUS_CONTROLLERS)
+        seq.controller[ch][data1] = data2;
+      break;
+    case MUS_EV_MEASURE:
+      break;
+    case MUS_EV_END:
+      // A score that loops without taking any time would never let go
+      if (!seq.looping || seq.next == seq.loop_time)
+        return false;
+      seq.loop_time = seq.next;
+      seq.pos = seq.score;
+      return true;
+    default:
+      return false;
+  }
 
+  if (kind != MUS_EV_MEASURE)
+  {
+    seq.used |= 1 << ch;
+    I_QueueMusicEvent(seq.next, kind, ch, data1, data2);
+  }
+
+  if (last)
+  {
+    // Variable-length delay to the next event group, 7 bits per byte
+    unsigned int delay = 0;
+    do {
+      if (p >= seq.end)
+        return false;
+      delay = (delay << 7) | (*p & 0x7f);
+    } while (*p++ & 0x80);
+    seq.next += delay;
+  }
+  seq.pos = p;
+  return true;
+}
+
+void I_UpdateMusic(void)
+{
+  int listeners = websocket_server_audio_listeners();
+  int steps = 0;
+
+  if (!seq.score)
+    return;
+
+  if (listeners > seq.listeners)
+    I_SendSongSnapshot();
+  seq.listeners = listeners;
+
+  if (seq.state == MUS_SONG_PLAYING)
+  {
+    int tic = I_GetTime_RealTime();
+    unsigned int target = (tic - seq.base_tic + 1) * MUS_TICKS_PER_TIC;
+
+    // After a long stall (level load, wipe) resume the song rather than
+    // dumping the missed seconds on the client in one burst
+    if (target > seq.next + MUS_MAX_LAG)
+    {
+      seq.base_tic = tic + 1 - seq.next / MUS_TICKS_PER_TIC;
+      target = (tic - seq.base_tic + 1) * MUS_TICKS_PER_TIC;
+    }
+
+    while (seq.next <= target)
+    {
+      if (!I_SongStep())
+      {
+        // End of score or a malformed event
+        seq.now = target;
+        I_SongState(MUS_SONG_STOPPED);
+        break;
+      }
+      if (++steps == MUS_MAX_STEPS)
+      {
+        // A dense passage: carry on from here next frame
+        target = seq.next;
+        break;
+      }
+    }
+    if (seq.state == MUS_SONG_PLAYING)
+      seq.now = target;
+  }
+
+  I_FlushMusicEvents();
+}
 
 void I_ShutdownMusic(void)
 {
+  I_StopSong(0);
+  I_UnRegisterSong(0);
 }
 
 void I_InitMusic(void)
 {
+  lprintf(LO_INFO, "I_InitMusic: sequencing MUS on the tic clock, the browser synthesizes\n");
 }
 
 void I_PlaySong(int handle, int looping)
 {
+  if (!seq.score)
+    return;
+  if (seq.state != MUS_SONG_STOPPED)
+    I_StopSong(handle);
+
+  I_ResetSongChannels();
+  seq.pos = seq.score;
+  seq.looping = looping;
+  seq.base_tic = I_GetTime_RealTime();
+  seq.next = seq.now = 0;
+  seq.loop_time = UINT_MAX;
+  I_SongState(MUS_SONG_PLAYING);
 }
 
 extern int mus_pause_opt; // From m_misc.c
 
 void I_PauseSong (int handle)
 {
+  if (seq.state != MUS_SONG_PLAYING)
+    return;
+
+  switch (mus_pause_opt)
+  {
+    case 0:
+      I_StopSong(handle);
+      break;
+    case 1:
+      seq.paused_tic = I_GetTime_RealTime();
+      I_SongState(MUS_SONG_PAUSED);
+      break;
+  }
 }
 
 void I_ResumeSong (int handle)
 {
+  switch (mus_pause_opt)
+  {
+    case 0:
+      I_PlaySong(handle, seq.looping);
+      break;
+    case 1:
+      if (seq.state != MUS_SONG_PAUSED)
+        return;
+      seq.base_tic += I_GetTime_RealTime() - seq.paused_tic;
+      I_SongState(MUS_SONG_PLAYING);
+      break;
+  }
 }
 
 void I_StopSong(int handle)
 {
+  if (seq.state == MUS_SONG_STOPPED)
+    return;
+  I_SongState(MUS_SONG_STOPPED);
+  I_FlushMusicEvents();
 }
 
 void I_UnRegisterSong(int handle)
 {
+  seq.score = seq.end = seq.pos = NULL;
 }
 
 int I_RegisterSong(const void *data, size_t len)
 {
-  return (0);
+  const unsigned char *mus = data;
+  unsigned int scorelen, scorestart;
+
+  // Only MUS; PWAD MIDI music stays silent
+  if (len < 16 || memcmp(mus, "MUS\x1a", 4))
+  {
+    lprintf(LO_WARN, "I_RegisterSong: not a MUS lump, music disabled for this song\n");
+    return 0;
+  }
+  scorelen = mus[4] | (mus[5] << 8);
+  scorestart = mus[6] | (mus[7] << 8);
+  if (scorestart >= len)
+    return 0;
+  if (scorestart + scorelen > len)
+    scorelen = len - scorestart;
+
+  // The lump is memory-mapped from the WAD, so the score is used in place
+  seq.score = seq.pos = mus + scorestart;
+  seq.end = seq.score + scorelen;
+  seq.state = MUS_SONG_STOPPED;
+  return 1;
 }
 
 int I_RegisterMusic( const char* filename, musicinfo_t *song )
@@ -152,6 +1025,8 @@ int I_RegisterMusic( const char* filename, musicinfo_t *song )
 
 void I_SetMusicVolume(int volume)
 {
+  seq.volume = volume;
+  if (seq.score)
+    I_SongState(seq.state);
 }
 
-
@@ -75,6 +75,7 @@
  #include "esp_partition.h"
  #include "esp_err.h"
  #include "esp_log.h"
+ #include "esp_timer.h"
  
  #ifdef __GNUG__
  #pragma implementation "i_system.h"
@@ -85,68 +86,122 @@
  #include <stdbool.h> // Added for bool type
  
  int realtime=0;
- 
- void I_uSleep(unsigned long usecs)
+ extern int realtic_clock_rate;
+ 
+ /* I_uSleep
+  * The RTOS tick is several milliseconds, far too coarse for frame pacing, so
+  * the task that first sleeps gets a one-shot esp_timer that wakes it with a
+  * task notification. Other callers fall back to whole ticks, rounded up.
+  */
+ static esp_timer_handle_t usleep_timer;
+ static TaskHandle_t usleep_task;
+
+ static void I_uSleepWake(void *arg)
  {
-	 vTaskDelay(usecs/1000);
+   xTaskNotifyGive((TaskHandle_t)arg);
  }
- 
- static unsigned long getMsTicks() {
-   struct timeval tv;
-   struct timezone tz;
 
-   gettimeofday(&tv, &tz);
- 
-   //convert to ms
-   unsigned long now = tv.tv_usec/1000+tv.tv_sec*1000;
-   return now;
+ void I_uSleep(unsigned long usecs)
+ {
+   TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+   if (usecs == 0) {
+     taskYIELD();
+     return;
+   }
+
+   if (usleep_timer == NULL) {
+     esp_timer_create_args_t args = {
+       .callback = I_uSleepWake,
+       .arg = self,
+       .name = "i_usleep",
+     };
+     if (esp_timer_create(&args, &usleep_timer) == ESP_OK)
+       usleep_task = self;
+   }
+
+   if (self != usleep_task) {
+     vTaskDelay((usecs + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000));
+     return;
+   }
+
+   ulTaskNotifyTake(pdTRUE, 0); // drop a wakeup left over from a timed-out sleep
+   esp_timer_start_once(usleep_timer, usecs);
+   if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(usecs / 1000) + 2))
+     esp_timer_stop(usleep_timer);
  }
  
+ /* Microseconds from usecs to the start of real tic tic */
+ static unsigned long long I_uSecsToTic(unsigned long long usecs, unsigned long long tic)
+ {
+   return (tic * 1000000 + TICRATE - 1) / TICRATE - usecs;
+ }
+
+ /* Tics, the time to the next one and the interpolation fraction are all
+  * taken from the monotonic microsecond esp_timer clock, so the fraction
+  * reaches FRACUNIT exactly when I_GetTime advances. gettimeofday can be
+  * stepped and would drift against it.
+  */
  int I_GetTime_RealTime (void)
  {
-   struct timeval tv;
-   struct timezone tz;
+   unsigned long long usecs = esp_timer_get_time();
    unsigned long thistimereply;
+
+   thistimereply = (unsigned long)(usecs * TICRATE / 1000000);
  
-   gettimeofday(&tv, &tz);
- 
-   thistimereply = (tv.tv_sec * TICRATE + (tv.tv_usec * TICRATE) / 1000000);
- 
+   // TryRunTics sleeps this long while waiting for the next tic
+   ms_to_next_tick = (I_uSecsToTic(usecs, thistimereply + 1) + 999) / 1000;
+   if (ms_to_next_tick > 1000/TICRATE || ms_to_next_tick < 1)
+     ms_to_next_tick = 1;
+
    return thistimereply;
  
  }
- 
- const int displaytime=0;
+
+ unsigned long I_uSecsToNextTic(void)
+ {
+   unsigned long long usecs = esp_timer_get_time();
+
+   return (unsigned long)I_uSecsToTic(usecs, usecs * TICRATE / 1000000 + 1);
+ }
  
  fixed_t I_GetTimeFrac (void)
  {
-   unsigned long now;
+   unsigned int now;
    fixed_t frac;
  
-   now = getMsTicks();
+   now = (unsigned int)esp_timer_get_time();
  
    if (tic_vars.step == 0)
 	 return FRACUNIT;
    else
    {
-	 frac = (fixed_t)((now - tic_vars.start + displaytime) * FRACUNIT / tic_vars.step);
-	 if (frac < 0)
-	   frac = 0;
-	 if (frac > FRACUNIT)
-	   frac = FRACUNIT;
+	 unsigned long long elapsed = now - tic_vars.start;
+	 if (elapsed >= tic_vars.step)
+	   return FRACUNIT;
+	 frac = (fixed_t)(elapsed * FRACUNIT / tic_vars.step);
 	 return frac;
    }
  }
  
- 
+ /* The tic that just ran is interpolated up to the real tic at which the
+  * (possibly scaled, see i_main.c) game clock next advances, so a tic that
+  * ran late gets a shorter step rather than overshooting into the next one.
+  */
  void I_GetTime_SaveMS(void)
  {
-   if (!movement_smooth)
+   unsigned long long now, tic, gametic;
+
+   if (!movement_smooth || realtic_clock_rate <= 0)
 	 return;
  
-   tic_vars.start = getMsTicks();
-   tic_vars.next = (unsigned int) ((tic_vars.start * tic_vars.msec + 1.0f) / tic_vars.msec);
-   tic_vars.step = tic_vars.next - tic_vars.start;
+   now = esp_timer_get_time();
+   tic = now * TICRATE / 1000000;
+   gametic = tic * realtic_clock_rate / 100;
+   tic = ((gametic + 1) * 100 + realtic_clock_rate - 1) / realtic_clock_rate;
+   tic_vars.start = (unsigned int)now;
+   tic_vars.step = (unsigned int)I_uSecsToTic(now, tic);
+   tic_vars.next = tic_vars.start + tic_vars.step;
  }
  
  unsigned long I_GetRandomTimeSeed(void)
@@ -51,17 +51,27 @@
 #include "st_stuff.h"
 #include "lprintf.h"
 #include "gamepad.h"
+#include "r_fps.h"
+#include "r_views.h"
+#include "i_videostats.h"
 
 #include "esp_task.h"
 #include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "frame_queue.h"
+#include "websocket_server.h"
 #include "instrumentation_interface.h"
+#include "perf_trace.h"
+#include "perf_clock.h"
+#include "i_system.h"
 
 int use_doublebuffer = 0;
 int use_fullscreen = 0;
 int desired_fullscreen = 0;
+int video_pacing_fps = TICRATE;
+int statusbar_layer = 1;
+int video_idle_fps = 10;
 
 extern frame_queue_t g_frame_queue;
 
@@ -103,13 +113,159 @@ void I_StartFrame (void)
 }
 
 
+/* Frame pacing
+ * With video_pacing_fps set, frames are no longer rendered as fast as the
+ * loop spins. Each frame is scheduled to finish when the WebSocket sender
+ * can take it, but not sooner than one pacing period after the last one, and
+ * the wait is slept rather than spun. A render that would have to start
+ * after the next tic boundary is skipped so it can show the newer tic, and
+ * nothing is rendered while the frame queue is full.
+ */
+static uint64_t pace_render_start_us;
+static uint64_t pace_last_present_us;
+static uint32_t pace_render_avg_us;
+
+/* Idle display
+ * While D_DisplayIdle, frames are rendered at video_idle_fps at most and the
+ * rest of the time is slept. A rendered idle frame that hashes the same as
+ * the last one queued is not queued again, unless a client has started
+ * watching since; the browser keeps showing the last one.
+ */
+static uint64_t idle_last_us;
+static uint64_t idle_check_us;
+static boolean static_valid;
+static uint32_t static_hash;
+static int static_listeners;
+static video_stats_t video_stats;
+
+static void I_PaceSkip(int reason)
+{
+  // Sleep out the rest of the tic so the caller does not spin back here
+  PERF_TRACE_INSTANT(PERF_TRACE_PACE_SKIP, reason);
+  I_uSleep(I_uSecsToNextTic());
+}
+
 int I_StartDisplay(void)
 {
+  uint64_t now, target, start;
+
+  now = perf_now_us();
+  if (D_DisplayIdle()) {
+    if (idle_check_us)
+      video_stats.idle_us += now - idle_check_us;
+    idle_check_us = now;
+    if (video_idle_fps > 0 && now < idle_last_us + 1000000 / video_idle_fps) {
+      I_PaceSkip(2);
+      return 0;
+    }
+    idle_last_us = now;
+  } else {
+    idle_check_us = 0;
+  }
+
+  if (video_pacing_fps <= 0)
+    return 1;
+
+  if (!frame_queue_get_write_buffer(&g_frame_queue)) {
+    I_PaceSkip(0);
+    return 0;
+  }
+
+  now = perf_now_us();
+  target = now + frame_queue_sender_ready_in_us(&g_frame_queue);
+  if (target < pace_last_present_us + 1000000 / video_pacing_fps)
+    target = pace_last_present_us + 1000000 / video_pacing_fps;
+  start = target - pace_render_avg_us;
+
+  if (start > now) {
+    uint64_t wait = start - now;
+    if (wait >= I_uSecsToNextTic()) {
+      I_PaceSkip(1);
+      return 0;
+    }
+    PERF_TRACE_BEGIN(PERF_TRACE_PACE_SLEEP);
+    I_uSleep((unsigned long)wait);
+    PERF_TRACE_END(PERF_TRACE_PACE_SLEEP);
+  }
+
+  pace_render_start_us = perf_now_us();
   return 1;
 }
 
 void I_EndDisplay(void)
 {
+  uint32_t took;
+
+  if (video_pacing_fps <= 0)
+    return;
+
+  pace_last_present_us = perf_now_us();
+  took = (uint32_t)(pace_last_present_us - pace_render_start_us);
+  // 1/8 weight EWMA, seeded by the first frame
+  pace_render_avg_us = pace_render_avg_us ?
+    pace_render_avg_us - (pace_render_avg_us >> 3) + (took >> 3) : took;
+}
+
+/* Status bar layer
+ * While the status bar rows hold nothing but the status bar (st_layer), a
+ * frame goes out as WS_MSG_LAYERS: the rows above the bar every time, the
+ * bar's rows only when a widget drew since they last went out. The browser
+ * keeps the last bar and composites the two, palette shifts included. A full
+ * frame, or a client newly watching the game, makes the next layered frame
+ * carry the bar again; a dropped frame leaves st_changed set.
+ */
+static boolean bar_stale = true;
+static int bar_listeners;
+
+/* Draw lists ride in their frame's own queue slot, after the pixels, so the
+ * browser applies each to exactly that frame. Only the renderer fills slots,
+ * so one free at I_SendDrawList is still free at I_FinishUpdate.
+ */
+static const byte *pending_list;
+static int pending_list_len;
+
+void I_GetVideoStats(video_stats_t *stats)
+{
+  *stats = video_stats;
+}
+
+static size_t I_PutLayers(uint8_t *buf, const uint8_t *scr)
+{
+  int listeners = websocket_server_view_watchers(0);
+  int bar_rows = 0;
+  size_t view_bytes = SCREENWIDTH*ST_SCALED_Y;
+
+  if (st_changed || bar_stale || listeners > bar_listeners)
+    bar_rows = ST_SCALED_HEIGHT;
+  bar_listeners = listeners;
+
+  buf[0] = WS_MSG_LAYERS;
+  buf[1] = current_palette;
+  buf[2] = ST_SCALED_Y & 0xff;
+  buf[3] = ST_SCALED_Y >> 8;
+  buf[4] = ST_SCALED_Y & 0xff;
+  buf[5] = ST_SCALED_Y >> 8;
+  buf[6] = bar_rows & 0xff;
+  buf[7] = bar_rows >> 8;
+  memcpy(buf+WS_LAYERS_HEADER, scr, view_bytes);
+  if (bar_rows) {
+    memcpy(buf+WS_LAYERS_HEADER+view_bytes, scr+view_bytes, SCREENWIDTH*bar_rows);
+    video_stats.statusbar_sent++;
+  }
+  st_changed = bar_stale = false;
+  video_stats.layered++;
+  return WS_LAYERS_HEADER + view_bytes + SCREENWIDTH*bar_rows;
+}
+
+// FNV-1a over words, palette included
+static uint32_t I_FrameHash(const uint8_t *scr)
+{
+  const uint32_t *p = (const uint32_t *)scr;
+  uint32_t h = 2166136261u ^ current_palette;
+
+  for (int i = 0; i < SCREENWIDTH*SCREENHEIGHT/4; i++)
+    h = (h ^ p[i]) * 16777619u;
+  return h;
 }
 
 //
@@ -119,19 +275,118 @@ void I_EndDisplay(void)
 void I_FinishUpdate (void)
 {
   uint8_t *scr=(uint8_t*)screens[0].data;
+  size_t size;
+  boolean idle = D_DisplayIdle();
+  uint32_t hash = 0;
+  int listeners = 0;
   // Copy screen buffer to frame queue
+  PERF_TRACE_BEGIN(PERF_TRACE_FINISH_UPDATE);
+  // A new list changes what the browser shows, whatever the pixels do
+  if (idle && !pending_list_len) {
+    hash = I_FrameHash(scr);
+    listeners = websocket_server_view_watchers(0);
+    if (static_valid && hash == static_hash && listeners <= static_listeners) {
+      static_listeners = listeners;
+      video_stats.frames_static++;
+      PERF_TRACE_INSTANT(PERF_TRACE_FRAME_STATIC, 0);
+      PERF_TRACE_END(PERF_TRACE_FINISH_UPDATE);
+      return;
+    }
+  }
   uint8_t *buf = frame_queue_get_write_buffer(&g_frame_queue);
   if (!buf) {
+    // Sender is behind; this frame is dropped
+    video_stats.frames_dropped++;
+    pending_list_len = 0;
+    PERF_TRACE_INSTANT(PERF_TRACE_FRAME_DROP, g_frame_queue.count);
+    PERF_TRACE_END(PERF_TRACE_FINISH_UPDATE);
     return;
   }
 
-  buf[0] = current_palette;
-  memcpy(buf+1, scr, SCREENWIDTH*SCREENHEIGHT);
+  if (statusbar_layer && st_layer) {
+    size = I_PutLayers(buf, scr);
+  } else {
+    buf[0] = current_palette;
+    memcpy(buf+1, scr, SCREENWIDTH*SCREENHEIGHT);
+    size = 1 + SCREENWIDTH*SCREENHEIGHT;
+    bar_stale = true;
+  }
+  if (pending_list_len) {
+    memcpy(buf+size, pending_list, pending_list_len);
+    size += pending_list_len;
+    pending_list_len = 0;
+  }
   
   // Track PSRAM write operation for video frame
-  instrumentation_psram_write_operation(SCREENWIDTH*SCREENHEIGHT);
+  instrumentation_psram_write_operation(size);
   
-  frame_queue_submit_frame(&g_frame_queue);
+  frame_queue_submit_frame_size(&g_frame_queue, size);
+  video_stats.frames++;
+  video_stats.bytes += size;
+  if (idle) {
+    video_stats.idle_frames++;
+    video_stats.idle_bytes += size;
+  }
+  // Only a frame that was queued can stand for the ones after it
+  static_valid = idle;
+  static_hash = hash;
+  static_listeners = listeners;
+  PERF_TRACE_END(PERF_TRACE_FINISH_UPDATE);
+}
+
+/* Spectator views
+ * The WebSocket server keeps a buffer per view stream and sends it from its
+ * own task. A view finished while the previous one is still going out is
+ * dropped rather than waited for. Views use the base palette: the damage and
+ * pickup flashes belong to the console player.
+ */
+boolean I_SpectatorViewWanted(int slot)
+{
+  return websocket_server_view_watchers(slot + 1) > 0;
+}
+
+void I_PublishSpectatorView(int slot, const byte *pixels, int width, int height)
+{
+  websocket_server_publish_view(slot + 1, 0, pixels, width, height);
+}
+
+/* Vector automap
+ * Messages go through the server's outgoing queue to the clients watching
+ * the game. A refused message is simply sent again with the next frame.
+ */
+int I_AutomapListeners(void)
+{
+  return websocket_server_view_watchers(0);
+}
+
+boolean I_SendAutomap(byte *msg, int len)
+{
+  msg[0] = WS_MSG_AUTOMAP;
+  return websocket_server_queue_message(msg, len) == 0;
+}
+
+// Draw lists go the same way
+int I_DrawListListeners(void)
+{
+  return websocket_server_view_watchers(0);
+}
+
+boolean I_SendDrawList(byte *msg, int len)
+{
+  if (len > FRAME_TRAILER_SIZE || !frame_queue_get_write_buffer(&g_frame_queue))
+    return false;
+  msg[0] = WS_MSG_DRAW;
+  pending_list = msg;
+  pending_list_len = len;
+  return true;
+}
+
+const void *I_GetLump(int num, int *len)
+{
+  if (num < 0 || num >= numlumps || !lumpinfo[num].wadfile)
+    return NULL;
+  *len = lumpinfo[num].size;
+  return I_Mmap(NULL, *len, 0, 0, lumpinfo[num].wadfile->handle, lumpinfo[num].position);
 }
 
 void I_SetPalette (int pal)
@@ -201,8 +456,23 @@ void I_InitGraphics(void)
     firsttime = 0;
 
     atexit(I_ShutdownGraphics);
+
+    // -fps N overrides video_pacing_fps; 0 renders unpaced
+    {
+      int p = M_CheckParm("-fps");
+      if (p && p < myargc - 1)
+        video_pacing_fps = atoi(myargv[p + 1]);
+      // Frames between tics only differ when interpolated
+      if (p && video_pacing_fps > TICRATE)
+        movement_smooth = true;
+      if (video_pacing_fps > 0)
+        lprintf(LO_INFO, "I_InitGraphics: pacing output to %d fps%s\n", video_pacing_fps,
+                movement_smooth ? ", interpolated" : "");
+    }
     lprintf(LO_INFO, "I_InitGraphics: %dx%d\n", SCREENWIDTH, SCREENHEIGHT);
 
+    websocket_server_set_view_handler(R_SetSpectatorView);
+
     /* Set the video mode */
     I_UpdateVideoMode();
 
@@ -36,11 +36,15 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+#include <limits.h>
+
 #include "doomstat.h"
 #include "st_stuff.h"
 #include "r_main.h"
 #include "p_setup.h"
 #include "p_maputl.h"
+#include "m_bbox.h"
 #include "w_wad.h"
 #include "v_video.h"
 #include "p_spec.h"
@@ -49,6 +53,7 @@
 #include "d_deh.h"    // Ty 03/27/98 - externalizations
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
 #include "g_game.h"
+#include "i_video.h"
 
 //jff 1/7/98 default automap colors added
 int mapcolor_back;    // map background
@@ -249,6 +254,85 @@ int markpointnum_max = 0;       // killough 2/22/98
 
 static boolean stopped = true;
 
+//
+// Vector automap
+//
+// With map_vector set and a client watching, the automap is not rasterized.
+// The client gets the level's line list once, a chunk per frame, and then
+// only what changed: line colors, the window, players, things and marks. It
+// draws the map with canvas vectors over the frame. The frame itself only
+// carries the background, the status bar and the HUD, so it hardly changes
+// while the map is up.
+//
+
+int map_vector = 1;
+
+#define AMV_LINES          0
+#define AMV_FRAME          1
+#define AMV_MSG_SIZE       2048
+#define AMV_LINES_PER_MSG  200  /* 8 bytes each */
+#define AMV_MAX_DELTAS     256  /* 4 bytes each */
+#define AMV_MAX_THINGS     96   /* 8 bytes each */
+#define AMV_MAX_MARKS      16
+
+// frame flags
+#define AMV_ACTIVE   1
+#define AMV_OVERLAY  2
+#define AMV_ROTATE   4
+#define AMV_GRID     8
+
+static struct {
+  int serial;          /* the client drops its line list when this changes */
+  int lines_sent;      /* geometry sent for lines [0, lines_sent) */
+  short *color;        /* last color sent per line */
+  int color_size;
+  int listeners;
+  boolean shown;       /* the client is drawing the map */
+  byte *msg;           /* AMV_MSG_SIZE each, allocated on first use */
+  byte *last;          /* last frame message delivered */
+  int last_len;
+} amv;
+
+//
+// Line index
+//
+// Lines are bucketed by bounding box into a grid of cells when the level's
+// map is initialised, so a frame only transforms and clips the lines in the
+// cells the window covers rather than all numlines. The clipped lines are
+// kept, and reused for as long as the window, zoom and rotation stay put;
+// only their colors are looked up again.
+//
+
+#define AMI_MINSHIFT  9     /* 512 unit cells, four blockmap blocks */
+#define AMI_MAXCELLS  4096  /* bigger maps get bigger cells */
+
+static struct {
+  int orgx, orgy;      /* map units, lower left corner of cell 0 */
+  int shift;           /* log2 of the cell size, map units */
+  int cols, rows;
+  int *start;          /* cols*rows+1 offsets into list */
+  int *list;           /* line numbers by cell, ascending */
+  int *stamp;          /* per line, the last walk that took it */
+  int walk;
+  int numlines;
+} ami;
+
+typedef struct {
+  int line;
+  fline_t fl;
+} amline_t;
+
+static struct {
+  boolean valid;
+  int f_x, f_y, f_w, f_h;
+  fixed_t m_x, m_y, m_x2, m_y2, scale;
+  boolean rotate;
+  angle_t angle;       /* of the player, when rotating */
+  fixed_t ox, oy;
+  amline_t *lines;     /* the window's lines, clipped */
+  int count, size;
+} amcache;
+
 //
 // AM_activateNewScale()
 //
@@ -488,6 +572,89 @@ void AM_clearMarks(void)
   markpointnum = 0;
 }
 
+//
+// AM_cellRange()
+//
+// The index cells a box in map units touches, clamped to the grid
+//
+// Passed the box, fills in cells as BOXLEFT..BOXRIGHT, BOXBOTTOM..BOXTOP
+// Returns false if the box misses the grid altogether
+//
+static boolean AM_cellRange(int left, int bottom, int right, int top, int *cells)
+{
+  cells[BOXLEFT] = MAX((left - ami.orgx) >> ami.shift, 0);
+  cells[BOXBOTTOM] = MAX((bottom - ami.orgy) >> ami.shift, 0);
+  cells[BOXRIGHT] = MIN((right - ami.orgx) >> ami.shift, ami.cols - 1);
+  cells[BOXTOP] = MIN((top - ami.orgy) >> ami.shift, ami.rows - 1);
+  return cells[BOXLEFT] <= cells[BOXRIGHT] && cells[BOXBOTTOM] <= cells[BOXTOP];
+}
+
+//
+// AM_buildIndex()
+//
+// Buckets the level's lines into the cell grid
+//
+// Passed nothing, returns nothing
+//
+static void AM_buildIndex(void)
+{
+  int minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+  int i, cells, cx, cy, box[4];
+
+  for (i = 0; i < numlines; i++)
+  {
+    minx = MIN(minx, lines[i].bbox[BOXLEFT] >> FRACBITS);
+    miny = MIN(miny, lines[i].bbox[BOXBOTTOM] >> FRACBITS);
+    maxx = MAX(maxx, lines[i].bbox[BOXRIGHT] >> FRACBITS);
+    maxy = MAX(maxy, lines[i].bbox[BOXTOP] >> FRACBITS);
+  }
+  if (!numlines)
+    minx = miny = maxx = maxy = 0;
+
+  ami.orgx = minx;
+  ami.orgy = miny;
+  for (ami.shift = AMI_MINSHIFT; ; ami.shift++)
+  {
+    ami.cols = ((maxx - minx) >> ami.shift) + 1;
+    ami.rows = ((maxy - miny) >> ami.shift) + 1;
+    if (ami.cols * ami.rows <= AMI_MAXCELLS)
+      break;
+  }
+  cells = ami.cols * ami.rows;
+  ami.start = realloc(ami.start, (cells + 1) * sizeof(*ami.start));
+  memset(ami.start, 0, (cells + 1) * sizeof(*ami.start));
+
+  // Count the lines per cell and make the counts end offsets, then fill
+  // backwards, which leaves each cell's offset at its first line
+  for (i = 0; i < numlines; i++)
+  {
+    AM_cellRange(lines[i].bbox[BOXLEFT] >> FRACBITS, lines[i].bbox[BOXBOTTOM] >> FRACBITS,
+                 lines[i].bbox[BOXRIGHT] >> FRACBITS, lines[i].bbox[BOXTOP] >> FRACBITS, box);
+    for (cy = box[BOXBOTTOM]; cy <= box[BOXTOP]; cy++)
+      for (cx = box[BOXLEFT]; cx <= box[BOXRIGHT]; cx++)
+        ami.start[cy * ami.cols + cx]++;
+  }
+  for (i = 1; i < cells; i++)
+    ami.start[i] += ami.start[i - 1];
+  ami.start[cells] = ami.start[cells - 1];
+
+  ami.list = realloc(ami.list, MAX(ami.start[cells], 1) * sizeof(*ami.list));
+  for (i = numlines - 1; i >= 0; i--)
+  {
+    AM_cellRange(lines[i].bbox[BOXLEFT] >> FRACBITS, lines[i].bbox[BOXBOTTOM] >> FRACBITS,
+                 lines[i].bbox[BOXRIGHT] >> FRACBITS, lines[i].bbox[BOXTOP] >> FRACBITS, box);
+    for (cy = box[BOXBOTTOM]; cy <= box[BOXTOP]; cy++)
+      for (cx = box[BOXLEFT]; cx <= box[BOXRIGHT]; cx++)
+        ami.list[--ami.start[cy * ami.cols + cx]] = i;
+  }
+
+  ami.stamp = realloc(ami.stamp, MAX(numlines, 1) * sizeof(*ami.stamp));
+  memset(ami.stamp, 0, MAX(numlines, 1) * sizeof(*ami.stamp));
+  ami.walk = 0;
+  ami.numlines = numlines;
+  amcache.valid = false;
+}
+
 //
 // AM_LevelInit()
 //
@@ -501,6 +668,8 @@ void AM_clearMarks(void)
 static void AM_LevelInit(void)
 {
   leveljuststarted = 0;
+  amv.listeners = 0;  // new lines: resend them
+  AM_buildIndex();
 
   f_x = f_y = 0;
   f_w = SCREENWIDTH;           // killough 2/7/98: get rid of finit_ vars
@@ -977,19 +1146,165 @@ static boolean AM_clipMline
 // in the defaults file.
 // Returns nothing.
 //
-static void AM_drawMline
-( mline_t*  ml,
+static void AM_drawFline
+( fline_t*  fl,
   int   color )
 {
-  static fline_t fl;
-
   if (color==-1)  // jff 4/3/98 allow not drawing any sort of line
     return;       // by setting its color to -1
   if (color==247) // jff 4/3/98 if color is 247 (xparent), use black
     color=0;
 
-  if (AM_clipMline(ml, &fl))
-    V_DrawLine(&fl, color); // draws it on frame buffer using fb coords
+  V_DrawLine(fl, color); // draws it on frame buffer using fb coords
+}
+
+static void AM_drawMline
+( mline_t*  ml,
+  int   color )
+{
+  static fline_t fl;
+
+  if (color != -1 && AM_clipMline(ml, &fl))
+    AM_drawFline(&fl, color);
+}
+
+//
+// AM_windowBox()
+//
+// The part of the unrotated map the window shows
+//
+// Passed a box to fill in, in map units, and a margin to widen it by
+// Returns nothing
+//
+static void AM_windowBox(int *box, int margin)
+{
+  fixed_t x[4], y[4];
+  int i;
+
+  x[0] = x[3] = m_x;
+  x[1] = x[2] = m_x2;
+  y[0] = y[1] = m_y;
+  y[2] = y[3] = m_y2;
+  box[BOXLEFT] = box[BOXBOTTOM] = INT_MAX;
+  box[BOXRIGHT] = box[BOXTOP] = INT_MIN;
+  for (i = 0; i < 4; i++)
+  {
+    // lines are turned by ANG90-angle to be drawn, so turn the window back
+    if (automapmode & am_rotate)
+      AM_rotate(&x[i], &y[i], plr->mo->angle-ANG90, plr->mo->x, plr->mo->y);
+    box[BOXLEFT] = MIN(box[BOXLEFT], x[i] >> MAPBITS);
+    box[BOXBOTTOM] = MIN(box[BOXBOTTOM], y[i] >> MAPBITS);
+    box[BOXRIGHT] = MAX(box[BOXRIGHT], (x[i] >> MAPBITS) + 1);
+    box[BOXTOP] = MAX(box[BOXTOP], (y[i] >> MAPBITS) + 1);
+  }
+  box[BOXLEFT] -= margin;
+  box[BOXBOTTOM] -= margin;
+  box[BOXRIGHT] += margin;
+  box[BOXTOP] += margin;
+}
+
+//
+// AM_sectorInWindow()
+//
+// Whether any of a sector's things can show in a window box from
+// AM_windowBox; its block box is already widened by MAXRADIUS
+//
+static boolean AM_sectorInWindow(const sector_t *sec, const int *box)
+{
+  int orgx = bmaporgx >> FRACBITS, orgy = bmaporgy >> FRACBITS;
+
+  return orgx + sec->blockbox[BOXLEFT] * MAPBLOCKUNITS <= box[BOXRIGHT] &&
+    orgx + (sec->blockbox[BOXRIGHT] + 1) * MAPBLOCKUNITS >= box[BOXLEFT] &&
+    orgy + sec->blockbox[BOXBOTTOM] * MAPBLOCKUNITS <= box[BOXTOP] &&
+    orgy + (sec->blockbox[BOXTOP] + 1) * MAPBLOCKUNITS >= box[BOXBOTTOM];
+}
+
+//
+// AM_cacheValid()
+//
+// Whether the clipped lines from the last AM_collectLines still hold
+//
+static boolean AM_cacheValid(void)
+{
+  boolean rotate = (automapmode & am_rotate) != 0;
+
+  return amcache.valid &&
+    amcache.f_x == f_x && amcache.f_y == f_y &&
+    amcache.f_w == f_w && amcache.f_h == f_h &&
+    amcache.m_x == m_x && amcache.m_y == m_y &&
+    amcache.m_x2 == m_x2 && amcache.m_y2 == m_y2 &&
+    amcache.scale == scale_mtof && amcache.rotate == rotate &&
+    (!rotate || (amcache.angle == plr->mo->angle &&
+                 amcache.ox == plr->mo->x && amcache.oy == plr->mo->y));
+}
+
+//
+// AM_collectLines()
+//
+// Rotates and clips the lines in the index cells under the window, and
+// keeps the ones that show
+//
+// Passed nothing, returns nothing
+//
+static void AM_collectLines(void)
+{
+  int box[4], cells[4], cx, cy, i;
+  mline_t l;
+
+  if (ami.numlines != numlines)
+    AM_buildIndex();
+
+  amcache.count = 0;
+  ami.walk++;
+  AM_windowBox(box, 0);
+  if (AM_cellRange(box[BOXLEFT], box[BOXBOTTOM], box[BOXRIGHT], box[BOXTOP], cells))
+    for (cy = cells[BOXBOTTOM]; cy <= cells[BOXTOP]; cy++)
+      for (cx = cells[BOXLEFT]; cx <= cells[BOXRIGHT]; cx++)
+      {
+        int c = cy * ami.cols + cx;
+
+        for (i = ami.start[c]; i < ami.start[c + 1]; i++)
+        {
+          int n = ami.list[i];
+
+          if (ami.stamp[n] == ami.walk) // already taken from another cell
+            continue;
+          ami.stamp[n] = ami.walk;
+
+          l.a.x = lines[n].v1->x >> FRACTOMAPBITS;//e6y
+          l.a.y = lines[n].v1->y >> FRACTOMAPBITS;//e6y
+          l.b.x = lines[n].v2->x >> FRACTOMAPBITS;//e6y
+          l.b.y = lines[n].v2->y >> FRACTOMAPBITS;//e6y
+
+          if (automapmode & am_rotate) {
+            AM_rotate(&l.a.x, &l.a.y, ANG90-plr->mo->angle, plr->mo->x, plr->mo->y);
+            AM_rotate(&l.b.x, &l.b.y, ANG90-plr->mo->angle, plr->mo->x, plr->mo->y);
+          }
+
+          if (amcache.count == amcache.size)
+          {
+            amcache.size = amcache.size ? amcache.size * 2 : 256;
+            amcache.lines = realloc(amcache.lines, amcache.size * sizeof(*amcache.lines));
+          }
+          if (AM_clipMline(&l, &amcache.lines[amcache.count].fl))
+            amcache.lines[amcache.count++].line = n;
+        }
+      }
+
+  amcache.f_x = f_x;
+  amcache.f_y = f_y;
+  amcache.f_w = f_w;
+  amcache.f_h = f_h;
+  amcache.m_x = m_x;
+  amcache.m_y = m_y;
+  amcache.m_x2 = m_x2;
+  amcache.m_y2 = m_y2;
+  amcache.scale = scale_mtof;
+  amcache.rotate = (automapmode & am_rotate) != 0;
+  amcache.angle = plr->mo->angle;
+  amcache.ox = plr->mo->x;
+  amcache.oy = plr->mo->y;
+  amcache.valid = true;
 }
 
 //
@@ -1004,7 +1319,7 @@ static void AM_drawGrid(int color)
 {
   fixed_t x, y;
   fixed_t start, end;
-  mline_t ml;
+  fline_t fl;
 
   // Figure out start of vertical gridlines
   start = m_x;
@@ -1013,14 +1328,15 @@ static void AM_drawGrid(int color)
       - ((start-bmaporgx)%(MAPBLOCKUNITS<<MAPBITS));//e6y
   end = m_x + m_w;
 
-  // draw vertical gridlines
-  ml.a.y = m_y;
-  ml.b.y = m_y+m_h;
+  // draw vertical gridlines; they span the window, so they go straight to
+  // frame buffer coords without clipping
+  fl.a.y = f_y;
+  fl.b.y = f_y + f_h - 1;
   for (x=start; x<end; x+=(MAPBLOCKUNITS<<MAPBITS))//e6y
   {
-    ml.a.x = x;
-    ml.b.x = x;
-    AM_drawMline(&ml, color);
+    fl.a.x = fl.b.x = CXMTOF(x);
+    if (fl.a.x < f_x + f_w)
+      AM_drawFline(&fl, color);
   }
 
   // Figure out start of horizontal gridlines
@@ -1031,13 +1347,13 @@ static void AM_drawGrid(int color)
   end = m_y + m_h;
 
   // draw horizontal gridlines
-  ml.a.x = m_x;
-  ml.b.x = m_x + m_w;
+  fl.a.x = f_x;
+  fl.b.x = f_x + f_w - 1;
   for (y=start; y<end; y+=(MAPBLOCKUNITS<<MAPBITS))//e6y
   {
-    ml.a.y = y;
-    ml.b.y = y;
-    AM_drawMline(&ml, color);
+    fl.a.y = fl.b.y = CYMTOF(y);
+    if (fl.a.y >= f_y && fl.a.y < f_y + f_h)
+      AM_drawFline(&fl, color);
   }
 }
 
@@ -1082,201 +1398,196 @@ static int AM_DoorColor(int type)
 }
 
 //
-// Determines visible lines, draws them.
-// This is LineDef based, not LineSeg based.
-//
-// jff 1/5/98 many changes in this routine
-// backward compatibility not needed, so just changes, no ifs
-// addition of clauses for:
-//    doors opening, keyed door id, secret sectors,
-//    teleports, exit lines, key things
-// ability to suppress any of added features or lines with no height changes
+// AM_wallColor()
 //
-// support for gamma correction in automap abandoned
+// Returns the color a line is drawn in, or -1 if it is not drawn
 //
-// jff 4/3/98 changed mapcolor_xxxx=0 as control to disable feature
-// jff 4/3/98 changed mapcolor_xxxx=-1 to disable drawing line completely
+// Split out of AM_drawWalls so the vector automap can send the same colors
 //
-static void AM_drawWalls(void)
+static int AM_wallColor(const line_t *line)
 {
-  int i;
-  static mline_t l;
-
-  // draw the unclipped visible portions of all lines
-  for (i=0;i<numlines;i++)
+  // if line has been seen or IDDT has been used
+  if (ddt_cheating || (line->flags & ML_MAPPED))
   {
-    l.a.x = lines[i].v1->x >> FRACTOMAPBITS;//e6y
-    l.a.y = lines[i].v1->y >> FRACTOMAPBITS;//e6y
-    l.b.x = lines[i].v2->x >> FRACTOMAPBITS;//e6y
-    l.b.y = lines[i].v2->y >> FRACTOMAPBITS;//e6y
-
-    if (automapmode & am_rotate) {
-      AM_rotate(&l.a.x, &l.a.y, ANG90-plr->mo->angle, plr->mo->x, plr->mo->y);
-      AM_rotate(&l.b.x, &l.b.y, ANG90-plr->mo->angle, plr->mo->x, plr->mo->y);
-    }
-
-    // if line has been seen or IDDT has been used
-    if (ddt_cheating || (lines[i].flags & ML_MAPPED))
+    if ((line->flags & ML_DONTDRAW) && !ddt_cheating)
+      return -1;
     {
-      if ((lines[i].flags & ML_DONTDRAW) && !ddt_cheating)
-        continue;
+      /* cph - show keyed doors and lines */
+      int amd;
+      if ((mapcolor_bdor || mapcolor_ydor || mapcolor_rdor) &&
+          !(line->flags & ML_SECRET) &&    /* non-secret */
+        (amd = AM_DoorColor(line->special)) != -1
+      )
       {
-        /* cph - show keyed doors and lines */
-        int amd;
-        if ((mapcolor_bdor || mapcolor_ydor || mapcolor_rdor) &&
-            !(lines[i].flags & ML_SECRET) &&    /* non-secret */
-          (amd = AM_DoorColor(lines[i].special)) != -1
-        )
         {
+          switch (amd) /* closed keyed door */
           {
-            switch (amd) /* closed keyed door */
-            {
-              case 1:
-                /*bluekey*/
-                AM_drawMline(&l,
-                  mapcolor_bdor? mapcolor_bdor : mapcolor_cchg);
-                continue;
-              case 2:
-                /*yellowkey*/
-                AM_drawMline(&l,
-                  mapcolor_ydor? mapcolor_ydor : mapcolor_cchg);
-                continue;
-              case 0:
-                /*redkey*/
-                AM_drawMline(&l,
-                  mapcolor_rdor? mapcolor_rdor : mapcolor_cchg);
-                continue;
-              case 3:
-                /*any or all*/
-                AM_drawMline(&l,
-                  mapcolor_clsd? mapcolor_clsd : mapcolor_cchg);
-                continue;
-            }
+            case 1:
+              /*bluekey*/
+              return mapcolor_bdor? mapcolor_bdor : mapcolor_cchg;
+            case 2:
+              /*yellowkey*/
+              return mapcolor_ydor? mapcolor_ydor : mapcolor_cchg;
+            case 0:
+              /*redkey*/
+              return mapcolor_rdor? mapcolor_rdor : mapcolor_cchg;
+            case 3:
+              /*any or all*/
+              return mapcolor_clsd? mapcolor_clsd : mapcolor_cchg;
           }
         }
       }
-      if /* jff 4/23/98 add exit lines to automap */
+    }
+    if /* jff 4/23/98 add exit lines to automap */
+      (
+        mapcolor_exit &&
         (
-          mapcolor_exit &&
+          line->special==11 ||
+          line->special==52 ||
+          line->special==197 ||
+          line->special==51  ||
+          line->special==124 ||
+          line->special==198
+        )
+      ) {
+        return mapcolor_exit; /* exit line */
+      }
+
+    if (!line->backsector)
+    {
+      // jff 1/10/98 add new color for 1S secret sector boundary
+      if (mapcolor_secr && //jff 4/3/98 0 is disable
           (
-            lines[i].special==11 ||
-            lines[i].special==52 ||
-            lines[i].special==197 ||
-            lines[i].special==51  ||
-            lines[i].special==124 ||
-            lines[i].special==198
+           (
+            map_secret_after &&
+            P_WasSecret(line->frontsector) &&
+            !P_IsSecret(line->frontsector)
+           )
+           ||
+           (
+            !map_secret_after &&
+            P_WasSecret(line->frontsector)
+           )
           )
-        ) {
-          AM_drawMline(&l, mapcolor_exit); /* exit line */
-          continue;
-        }
-
-      if (!lines[i].backsector)
+        )
+        return mapcolor_secr; // line bounding secret sector
+      else                               //jff 2/16/98 fixed bug
+        return mapcolor_wall; // special was cleared
+    }
+    else /* now for 2S lines */
+    {
+      // jff 1/10/98 add color change for all teleporter types
+      if
+      (
+          mapcolor_tele && !(line->flags & ML_SECRET) &&
+          (line->special == 39 || line->special == 97 ||
+          line->special == 125 || line->special == 126)
+      )
+      { // teleporters
+        return mapcolor_tele;
+      }
+      else if (line->flags & ML_SECRET)    // secret door
       {
-        // jff 1/10/98 add new color for 1S secret sector boundary
-        if (mapcolor_secr && //jff 4/3/98 0 is disable
-            (
+        return mapcolor_wall;      // wall color
+      }
+      else if
+      (
+          mapcolor_clsd &&
+          !(line->flags & ML_SECRET) &&    // non-secret closed door
+          ((line->backsector->floorheight==line->backsector->ceilingheight) ||
+          (line->frontsector->floorheight==line->frontsector->ceilingheight))
+      )
+      {
+        return mapcolor_clsd;      // non-secret closed door
+      } //jff 1/6/98 show secret sector 2S lines
+      else if
+      (
+          mapcolor_secr && //jff 2/16/98 fixed bug
+          (                    // special was cleared after getting it
+            (map_secret_after &&
              (
-              map_secret_after &&
-              P_WasSecret(lines[i].frontsector) &&
-              !P_IsSecret(lines[i].frontsector)
+              (P_WasSecret(line->frontsector)
+               && !P_IsSecret(line->frontsector)) ||
+              (P_WasSecret(line->backsector)
+               && !P_IsSecret(line->backsector))
              )
-             ||
-             (
+            )
+            ||  //jff 3/9/98 add logic to not show secret til after entered
+            (   // if map_secret_after is true
               !map_secret_after &&
-              P_WasSecret(lines[i].frontsector)
-             )
+               (P_WasSecret(line->frontsector) ||
+                P_WasSecret(line->backsector))
             )
           )
-          AM_drawMline(&l, mapcolor_secr); // line bounding secret sector
-        else                               //jff 2/16/98 fixed bug
-          AM_drawMline(&l, mapcolor_wall); // special was cleared
+      )
+      {
+        return mapcolor_secr; // line bounding secret sector
+      } //jff 1/6/98 end secret sector line change
+      else if (line->backsector->floorheight !=
+                line->frontsector->floorheight)
+      {
+        return mapcolor_fchg; // floor level change
       }
-      else /* now for 2S lines */
+      else if (line->backsector->ceilingheight !=
+                line->frontsector->ceilingheight)
       {
-        // jff 1/10/98 add color change for all teleporter types
-        if
-        (
-            mapcolor_tele && !(lines[i].flags & ML_SECRET) &&
-            (lines[i].special == 39 || lines[i].special == 97 ||
-            lines[i].special == 125 || lines[i].special == 126)
-        )
-        { // teleporters
-          AM_drawMline(&l, mapcolor_tele);
-        }
-        else if (lines[i].flags & ML_SECRET)    // secret door
-        {
-          AM_drawMline(&l, mapcolor_wall);      // wall color
-        }
-        else if
-        (
-            mapcolor_clsd &&
-            !(lines[i].flags & ML_SECRET) &&    // non-secret closed door
-            ((lines[i].backsector->floorheight==lines[i].backsector->ceilingheight) ||
-            (lines[i].frontsector->floorheight==lines[i].frontsector->ceilingheight))
-        )
-        {
-          AM_drawMline(&l, mapcolor_clsd);      // non-secret closed door
-        } //jff 1/6/98 show secret sector 2S lines
-        else if
-        (
-            mapcolor_secr && //jff 2/16/98 fixed bug
-            (                    // special was cleared after getting it
-              (map_secret_after &&
-               (
-                (P_WasSecret(lines[i].frontsector)
-                 && !P_IsSecret(lines[i].frontsector)) ||
-                (P_WasSecret(lines[i].backsector)
-                 && !P_IsSecret(lines[i].backsector))
-               )
-              )
-              ||  //jff 3/9/98 add logic to not show secret til after entered
-              (   // if map_secret_after is true
-                !map_secret_after &&
-                 (P_WasSecret(lines[i].frontsector) ||
-                  P_WasSecret(lines[i].backsector))
-              )
-            )
-        )
-        {
-          AM_drawMline(&l, mapcolor_secr); // line bounding secret sector
-        } //jff 1/6/98 end secret sector line change
-        else if (lines[i].backsector->floorheight !=
-                  lines[i].frontsector->floorheight)
-        {
-          AM_drawMline(&l, mapcolor_fchg); // floor level change
-        }
-        else if (lines[i].backsector->ceilingheight !=
-                  lines[i].frontsector->ceilingheight)
-        {
-          AM_drawMline(&l, mapcolor_cchg); // ceiling level change
-        }
-        else if (mapcolor_flat && ddt_cheating)
-        {
-          AM_drawMline(&l, mapcolor_flat); //2S lines that appear only in IDDT
-        }
+        return mapcolor_cchg; // ceiling level change
       }
-    } // now draw the lines only visible because the player has computermap
-    else if (plr->powers[pw_allmap]) // computermap visible lines
-    {
-      if (!(lines[i].flags & ML_DONTDRAW)) // invisible flag lines do not show
+      else if (mapcolor_flat && ddt_cheating)
       {
-        if
-        (
-          mapcolor_flat
-          ||
-          !lines[i].backsector
-          ||
-          lines[i].backsector->floorheight
-          != lines[i].frontsector->floorheight
-          ||
-          lines[i].backsector->ceilingheight
-          != lines[i].frontsector->ceilingheight
-        )
-          AM_drawMline(&l, mapcolor_unsn);
+        return mapcolor_flat; //2S lines that appear only in IDDT
       }
     }
+  } // now draw the lines only visible because the player has computermap
+  else if (plr->powers[pw_allmap]) // computermap visible lines
+  {
+    if (!(line->flags & ML_DONTDRAW)) // invisible flag lines do not show
+    {
+      if
+      (
+        mapcolor_flat
+        ||
+        !line->backsector
+        ||
+        line->backsector->floorheight
+        != line->frontsector->floorheight
+        ||
+        line->backsector->ceilingheight
+        != line->frontsector->ceilingheight
+      )
+        return mapcolor_unsn;
+    }
   }
+  return -1;
+}
+
+//
+// Determines visible lines, draws them.
+// This is LineDef based, not LineSeg based.
+//
+// jff 1/5/98 many changes in this routine
+// backward compatibility not needed, so just changes, no ifs
+// addition of clauses for:
+//    doors opening, keyed door id, secret sectors,
+//    teleports, exit lines, key things
+// ability to suppress any of added features or lines with no height changes
+//
+// support for gamma correction in automap abandoned
+//
+// jff 4/3/98 changed mapcolor_xxxx=0 as control to disable feature
+// jff 4/3/98 changed mapcolor_xxxx=-1 to disable drawing line completely
+//
+static void AM_drawWalls(void)
+{
+  int i;
+
+  // the window's lines are only clipped again when the view moves
+  if (!AM_cacheValid())
+    AM_collectLines();
+
+  // draw the unclipped visible portions of the lines in the window
+  for (i=0;i<amcache.count;i++)
+    AM_drawFline(&amcache.lines[i].fl, AM_wallColor(&lines[amcache.lines[i].line]));
 }
 
 //
@@ -1406,12 +1717,16 @@ static void AM_drawPlayers(void)
 //
 static void AM_drawThings(void)
 {
-  int   i;
+  int   i, box[4];
   mobj_t* t;
 
-  // for all sectors
+  AM_windowBox(box, 0);
+
+  // for all sectors that reach into the window
   for (i=0;i<numsectors;i++)
   {
+    if (!AM_sectorInWindow(&sectors[i], box))
+      continue;
     t = sectors[i].thinglist;
     while (t) // for all things in that sector
     {
@@ -1559,6 +1874,254 @@ inline static void AM_drawCrosshair(int color)
   V_DrawLine(&line, color);
 }
 
+static byte *AMV_put16(byte *p, int v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  return p + 2;
+}
+
+static byte *AMV_put32(byte *p, int v)
+{
+  p = AMV_put16(p, v);
+  return AMV_put16(p, v >> 16);
+}
+
+// Start over: the client is sent the line list and every drawn color again
+static void AMV_reset(void)
+{
+  int i;
+
+  if (!amv.msg) {
+    amv.msg = malloc(AMV_MSG_SIZE);
+    amv.last = malloc(AMV_MSG_SIZE);
+  }
+  amv.serial++;
+  amv.lines_sent = 0;
+  amv.last_len = 0;
+  if (amv.color_size < numlines) {
+    amv.color = realloc(amv.color, numlines * sizeof(*amv.color));
+    amv.color_size = numlines;
+  }
+  // The client starts a new line list with every line hidden, so only
+  // lines that are drawn need a delta
+  for (i = 0; i < numlines; i++)
+    amv.color[i] = -1;
+}
+
+// Color as drawn: 247 is drawn black, -1 not at all
+static int AMV_color(int color)
+{
+  return color == 247 ? 0 : color;
+}
+
+// Next chunk of the line list, in map units: [type, AMV_LINES, serial,
+// numlines, first, count] then count x (x1, y1, x2, y2), all 16 bit
+static void AMV_sendLines(void)
+{
+  byte *p = amv.msg + 2;
+  int i, count = MIN(numlines - amv.lines_sent, AMV_LINES_PER_MSG);
+
+  amv.msg[1] = AMV_LINES;
+  p = AMV_put16(p, amv.serial);
+  p = AMV_put16(p, numlines);
+  p = AMV_put16(p, amv.lines_sent);
+  p = AMV_put16(p, count);
+  for (i = amv.lines_sent; i < amv.lines_sent + count; i++) {
+    p = AMV_put16(p, lines[i].v1->x >> FRACBITS);
+    p = AMV_put16(p, lines[i].v1->y >> FRACBITS);
+    p = AMV_put16(p, lines[i].v2->x >> FRACBITS);
+    p = AMV_put16(p, lines[i].v2->y >> FRACBITS);
+  }
+  if (I_SendAutomap(amv.msg, p - amv.msg))
+    amv.lines_sent += count;
+}
+
+static byte *AMV_putPlayers(byte *p)
+{
+  byte *count = p++;
+  int i;
+
+  *count = 0;
+  for (i = 0; i < MAXPLAYERS; i++) {
+    player_t *pl = &players[i];
+
+    if (!playeringame[i] || (netgame && deathmatch && !demoplayback && pl != plr))
+      continue;
+    if (!netgame && pl != plr)
+      continue;
+    p = AMV_put16(p, pl->mo->x >> FRACBITS);
+    p = AMV_put16(p, pl->mo->y >> FRACBITS);
+    p = AMV_put16(p, pl->mo->angle >> 16);
+    *p++ = !netgame ? mapcolor_sngl :
+      pl->powers[pw_invisibility] ? 246 : mapcolor_plyr[i];
+    *p++ = !netgame && ddt_cheating;   /* the arrow with the initials */
+    (*count)++;
+  }
+  return p;
+}
+
+// Things as in AM_drawThings: keys as crosses, the rest as triangles
+static byte *AMV_putThings(byte *p)
+{
+  byte *count = p;
+  int i, n = 0, box[4];
+
+  // the client draws no more than it is sent, so spend the slots on the
+  // things it can show
+  AM_windowBox(box, 0);
+  p += 2;
+  for (i = 0; i < numsectors && n < AMV_MAX_THINGS; i++) {
+    mobj_t *t;
+
+    if (!AM_sectorInWindow(&sectors[i], box))
+      continue;
+    for (t = sectors[i].thinglist; t && n < AMV_MAX_THINGS; t = t->snext) {
+      int color, cross = 1;
+
+      switch (t->info->doomednum) {
+        case 38: case 13: color = mapcolor_rkey!=-1? mapcolor_rkey : mapcolor_sprt; break;
+        case 39: case 6:  color = mapcolor_ykey!=-1? mapcolor_ykey : mapcolor_sprt; break;
+        case 40: case 5:  color = mapcolor_bkey!=-1? mapcolor_bkey : mapcolor_sprt; break;
+        default:
+          cross = 0;
+          color = t->flags & MF_FRIEND && !t->player ? mapcolor_frnd :
+            ((t->flags & (MF_COUNTKILL | MF_CORPSE)) == MF_COUNTKILL) ? mapcolor_enemy :
+            t->flags & MF_COUNTITEM ? mapcolor_item : mapcolor_sprt;
+      }
+      if (cross && !(mapcolor_rkey || mapcolor_ykey || mapcolor_bkey)) {
+        cross = 0;
+        color = mapcolor_sprt;
+      }
+      p = AMV_put16(p, t->x >> FRACBITS);
+      p = AMV_put16(p, t->y >> FRACBITS);
+      *p++ = t->angle >> 24;
+      *p++ = AMV_color(color);
+      *p++ = cross;
+      *p++ = 0;
+      n++;
+    }
+  }
+  AMV_put16(count, n);
+  return p;
+}
+
+// One frame: [type, AMV_FRAME, serial, flags, back, grid and crosshair
+// colors, f_x, f_y, f_w, f_h, m_x, m_y, m_w, m_h (map fixed), rotation
+// angle and origin, block map origin], then color deltas, players, things
+// and marks. Not sent when nothing changed.
+static void AMV_sendFrame(boolean active)
+{
+  byte *p = amv.msg + 2, *deltas;
+  int i, n = 0, len;
+
+  amv.msg[1] = AMV_FRAME;
+  p = AMV_put16(p, amv.serial);
+  *p++ = (active ? AMV_ACTIVE : 0) |
+    (automapmode & am_overlay ? AMV_OVERLAY : 0) |
+    (automapmode & am_rotate ? AMV_ROTATE : 0) |
+    (automapmode & am_grid ? AMV_GRID : 0);
+  *p++ = mapcolor_back;
+  *p++ = AMV_color(mapcolor_grid);
+  *p++ = AMV_color(mapcolor_hair);
+  p = AMV_put16(p, f_x);
+  p = AMV_put16(p, f_y);
+  p = AMV_put16(p, f_w);
+  p = AMV_put16(p, f_h);
+  p = AMV_put32(p, m_x);
+  p = AMV_put32(p, m_y);
+  p = AMV_put32(p, m_w);
+  p = AMV_put32(p, m_h);
+  // Rotation around the player; a closed map does not look at plr, whose
+  // mobj may be gone with the level
+  p = AMV_put16(p, active ? (ANG90 - plr->mo->angle) >> 16 : 0);
+  p = AMV_put32(p, active ? plr->mo->x >> FRACTOMAPBITS : 0);
+  p = AMV_put32(p, active ? plr->mo->y >> FRACTOMAPBITS : 0);
+  p = AMV_put16(p, bmaporgx >> FRACBITS);
+  p = AMV_put16(p, bmaporgy >> FRACBITS);
+
+  // Lines whose color changed since it was last sent; the rest wait a frame
+  deltas = p;
+  p += 2;
+  for (i = 0; active && i < amv.lines_sent && n < AMV_MAX_DELTAS; i++) {
+    int color = AM_wallColor(&lines[i]);
+
+    if (color != -1)
+      color = AMV_color(color);
+    if (color == amv.color[i])
+      continue;
+    p = AMV_put16(p, i);
+    *p++ = color == -1 ? 0 : color;
+    *p++ = color != -1;
+    n++;
+  }
+  AMV_put16(deltas, n);
+
+  if (active)
+    p = AMV_putPlayers(p);
+  else
+    *p++ = 0;
+  if (active && ddt_cheating == 2)
+    p = AMV_putThings(p);
+  else
+    p = AMV_put16(p, 0);
+
+  *p = 0;
+  for (i = 0; i < markpointnum && *p < AMV_MAX_MARKS; i++)
+    if (markpoints[i].x != -1) {
+      byte *m = p + 1 + *p * 8;
+      AMV_put32(m, markpoints[i].x);
+      AMV_put32(m + 4, markpoints[i].y);
+      (*p)++;
+    }
+  p += 1 + *p * 8;
+
+  len = p - amv.msg;
+  if (n == 0 && len == amv.last_len && !memcmp(amv.msg, amv.last, len))
+    return;
+  if (!I_SendAutomap(amv.msg, len))
+    return;
+
+  // Delivered: remember what the client has now
+  memcpy(amv.last, amv.msg, len);
+  amv.last_len = len;
+  amv.shown = active;
+  for (p = deltas + 2; n--; p += 4)
+    amv.color[p[0] | p[1] << 8] = p[3] ? p[2] : -1;
+}
+
+// Draw the map as vectors on the client; false to rasterize it instead
+static boolean AM_drawVectors(void)
+{
+  int listeners;
+
+  if (!map_vector || (listeners = I_AutomapListeners()) == 0) {
+    amv.listeners = 0;
+    return false;
+  }
+  // Somebody new needs the whole level
+  if (listeners > amv.listeners || amv.color_size < numlines)
+    AMV_reset();
+  amv.listeners = listeners;
+
+  if (amv.lines_sent < numlines)
+    AMV_sendLines();
+  AMV_sendFrame(true);
+  return true;
+}
+
+//
+// AM_FlushVectors()
+//
+// Tells the client to stop drawing the vector automap once it is closed.
+// Called every frame; retries until the message gets through.
+//
+void AM_FlushVectors(void)
+{
+  if (amv.shown && !(automapmode & am_active))
+    AMV_sendFrame(false);
+}
+
 //
 // AM_Drawer()
 //
@@ -1573,6 +2136,8 @@ void AM_Drawer (void)
 
   if (!(automapmode & am_overlay)) // cph - If not overlay mode, clear background for the automap
     V_FillRect(FB, f_x, f_y, f_w, f_h, (byte)mapcolor_back); //jff 1/5/98 background default color
+  if (AM_drawVectors())
+    return;
   if (automapmode & am_grid)
     AM_drawGrid(mapcolor_grid);      //jff 1/7/98 grid default color
   AM_drawWalls();
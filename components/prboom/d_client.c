@@ -70,6 +70,9 @@
 #include "r_fps.h"
 #include "lprintf.h"
 #include "esp_task_wdt.h"
+#include "perf_trace.h"
+#include "perf_clock.h"
+#include "perf_counters.h"
 
 static boolean   server;
 static int       remotetic; // Tic expected from the remote
@@ -88,6 +91,10 @@ int ms_to_next_tick;
 
 static boolean isExtraDDisplay = false;
 
+// Round trip of our own tics: made here, relayed back by the server
+static PERF_HISTOGRAM_ATTR perf_latency_t net_tic_stats;
+static uint64_t ticmade_us[BACKUPTICS];
+
 static void D_QuitNetGame (void);
 
 #ifndef HAVE_NET
@@ -116,8 +123,8 @@ void D_InitNetGame (void)
   struct { packet_header_t head; short pn; } PACKEDATTR initpacket;
 
     I_InitNetwork();
-  udp_socket = I_Socket(0);
-  I_ConnectToServer(myargv[i]);
+    if (I_ConnectToServer(myargv[i]))
+      I_Error("D_InitNetGame: cannot reach server %s", myargv[i]);
 
     do
     {
@@ -133,6 +140,7 @@ void D_InitNetGame (void)
 
     // Once we have been accepted by the server, we should tell it when we leave
     atexit(D_QuitNetGame);
+    perf_latency_register(&net_tic_stats, "net_tic_rtt");
 
     // Get info from the setup packet
     consoleplayer = sinfo->yourplayer;
@@ -289,15 +297,22 @@ void NetUpdate(void)
       I_SendPacket(packet, sizeof(*packet)+1);
     } else {
       if (ptic + tics <= (unsigned)remotetic) break; // Will not improve things
-      remotetic = ptic;
-      while (tics--) {
-        int players = *p++;
-        while (players--) {
-            int n = *p++;
-            RawToTic(&netcmds[n][remotetic%BACKUPTICS], p);
-            p += sizeof(ticcmd_t);
+      {
+        int first = remotetic;
+        uint64_t now = perf_now_us();
+
+        remotetic = ptic;
+        while (tics--) {
+          int players = *p++;
+          while (players--) {
+              int n = *p++;
+              RawToTic(&netcmds[n][remotetic%BACKUPTICS], p);
+              p += sizeof(ticcmd_t);
+          }
+          if (remotetic >= first && ticmade_us[remotetic%BACKUPTICS])
+            perf_latency_record(&net_tic_stats, (uint32_t)(now - ticmade_us[remotetic%BACKUPTICS]));
+          remotetic++;
         }
-        remotetic++;
       }
     }
   }
@@ -344,6 +359,7 @@ void NetUpdate(void)
       I_StartTic();
       if (maketic - gametic > BACKUPTICS/2) break;
       G_BuildTiccmd(&localcmds[maketic%BACKUPTICS]);
+      ticmade_us[maketic%BACKUPTICS] = perf_now_us();
       maketic++;
     }
     if (server && maketic > remotesend) { // Send the tics to the server
@@ -526,11 +542,17 @@ void TryRunTics (void)
 #endif
     if (advancedemo)
       D_DoAdvanceDemo ();
+    uint64_t tic_start_us = perf_now_us();
+    PERF_TRACE_BEGIN(PERF_TRACE_TIC);
+    perf_phase_begin(PERF_PHASE_SIM);
     M_Ticker ();
     I_GetTime_SaveMS();
     G_Ticker ();
     P_Checksum(gametic);
     gametic++;
+    perf_phase_end(PERF_PHASE_SIM);
+    PERF_TRACE_END(PERF_TRACE_TIC);
+    perf_latency_record(&tic_time_stats, (uint32_t)(perf_now_us() - tic_start_us));
 #ifdef HAVE_NET
     NetUpdate(); // Keep sending our tics to avoid stalling remote nodes
 #endif
@@ -78,11 +78,15 @@
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_fps.h"
+#include "r_views.h"
 #include "d_main.h"
 #include "d_deh.h"  // Ty 04/08/98 - Externalizations
 #include "lprintf.h" // jff 08/03/98 - declaration of lprintf
 #include "am_map.h"
 #include "esp_task_wdt.h"
+#include "perf_trace.h"
+#include "perf_clock.h"
+#include "perf_counters.h"
 
 void GetFirstMap(int *ep, int *map); // Ty 08/29/98 - add "-warp x" functionality
 static void D_PageDrawer(void);
@@ -188,6 +192,7 @@ static void D_Wipe(void)
       done = wipe_ScreenWipe(tics);
       I_UpdateNoBlit();
       M_Drawer();                   // menu is drawn even on top of wipes
+      V_FlushDrawList();
       I_FinishUpdate();             // page flip or blit buffer
     }
   while (!done);
@@ -198,11 +203,27 @@ static void D_Wipe(void)
 //  draw current display, possibly wiping it from the previous
 //
 
+PERF_HISTOGRAM_ATTR perf_latency_t frame_time_stats;
+PERF_HISTOGRAM_ATTR perf_latency_t tic_time_stats;
+
 // wipegamestate can be set to -1 to force a wipe on the next draw
 gamestate_t    wipegamestate = GS_DEMOSCREEN;
 extern boolean setsizeneeded;
 extern int     showMessages;
 
+//
+// D_DisplayIdle
+//
+// Nothing on screen moves at game speed: outside a level, paused, behind
+// a full-screen menu, or with the game frozen behind any menu. The platform
+// drops to its idle frame rate and stops resending unchanged frames.
+
+boolean D_DisplayIdle(void)
+{
+  return gamestate != GS_LEVEL || paused || inhelpscreens ||
+    (menuactive && !demoplayback && !netgame);
+}
+
 void D_Display (void)
 {
   
@@ -211,7 +232,7 @@ void D_Display (void)
   static boolean borderwillneedredraw = false;
   static gamestate_t oldgamestate = -1;
   boolean wipe;
-  boolean viewactive = false, isborder = false;
+  boolean viewactive = false, isborder = false, statusbaron = false;
 
   if (nodrawers)                    // for comparative timing / profiling
     return;
@@ -219,6 +240,9 @@ void D_Display (void)
   if (!I_StartDisplay())
     return;
 
+  PERF_TRACE_BEGIN(PERF_TRACE_DISPLAY);
+  perf_phase_begin(PERF_PHASE_RENDER);
+
   // save the current screen if about to wipe
   if ((wipe = gamestate != wipegamestate) && (V_GetMode() != VID_MODEGL))
     wipe_StartScreen();
@@ -234,7 +258,9 @@ void D_Display (void)
 
     switch (gamestate) {
     case GS_INTERMISSION:
+      V_RecordPatches(!wipe);
       WI_Drawer();
+      V_RecordPatches(false);
       break;
     case GS_FINALE:
       F_Drawer();
@@ -271,25 +297,41 @@ void D_Display (void)
       // and there is a menu being displayed
       borderwillneedredraw = menuactive && isborder && viewactive && (viewwidth != SCREENWIDTH);
     }
-    if (redrawborderstuff || (V_GetMode() == VID_MODEGL))
-      R_DrawViewBorder();
+    if (inhelpscreens) {
+      // A full-screen menu (help and setup screens) covers everything
+      // drawn here, so draw nothing; only keep the palette shifts going
+      ST_Drawer(false, false);
+    } else {
+      if (redrawborderstuff || (V_GetMode() == VID_MODEGL))
+        R_DrawViewBorder();
 
-    // Now do the drawing
-    if (viewactive) {
-      R_RenderPlayerView (&players[displayplayer]);
+      // Now do the drawing
+      if (viewactive) {
+        R_RenderPlayerView (&players[displayplayer]);
+      }
+      PERF_TRACE_BEGIN(PERF_TRACE_RENDER_HUD);
+      if (automapmode & am_active)
+        AM_Drawer();
+      statusbaron = (viewheight != SCREENHEIGHT) || ((automapmode & am_active) && !(automapmode & am_overlay));
+      ST_Drawer(statusbaron, redrawborderstuff);
+      if (V_GetMode() != VID_MODEGL)
+        R_DrawViewBorder();
+      V_RecordPatches(!wipe);
+      HU_Drawer();
+      V_RecordPatches(false);
+      PERF_TRACE_END(PERF_TRACE_RENDER_HUD);
     }
-    if (automapmode & am_active)
-      AM_Drawer();
-    ST_Drawer((viewheight != SCREENHEIGHT) || ((automapmode & am_active) && !(automapmode & am_overlay)), redrawborderstuff);
-    if (V_GetMode() != VID_MODEGL)
-      R_DrawViewBorder();
-    HU_Drawer();
   }
 
+  AM_FlushVectors();
+
   inhelpscreensstate = inhelpscreens;
   isborderstate      = isborder;
   oldgamestate = wipegamestate = gamestate;
 
+  // The pause sign and menus can go out as a draw list too
+  V_RecordPatches(!wipe);
+
   // draw pause pic
   if (paused) {
     // Simplified the "logic" here and no need for x-coord caching - POPE
@@ -299,16 +341,22 @@ void D_Display (void)
 
   // menus go directly to the screen
   M_Drawer();          // menu is drawn even on top of everything
+  V_RecordPatches(false);
 #ifdef HAVE_NET
   NetUpdate();         // send out any new accumulation
 #else
   D_BuildNewTiccmds();
 #endif
 
+  // The status bar rows can go out on their own unless a menu or a wipe
+  // covers them
+  st_layer = statusbaron && !menuactive && !wipe;
+
   // normal update
-  if (!wipe || (V_GetMode() == VID_MODEGL))
+  if (!wipe || (V_GetMode() == VID_MODEGL)) {
+    V_FlushDrawList();
     I_FinishUpdate ();              // page flip or blit buffer
-  else {
+  } else {
     // wipe update
     wipe_EndScreen();
     D_Wipe();
@@ -316,6 +364,20 @@ void D_Display (void)
 
   I_EndDisplay();
 
+  perf_phase_end(PERF_PHASE_RENDER);
+  PERF_TRACE_END(PERF_TRACE_DISPLAY);
+
+  // Extra viewpoints for spectators, now that the main frame is out
+  R_RenderSpectatorViews();
+
+  {
+    static uint64_t last_frame_us;
+    uint64_t now_us = perf_now_us();
+    if (last_frame_us)
+      perf_latency_record(&frame_time_stats, (uint32_t)(now_us - last_frame_us));
+    last_frame_us = now_us;
+  }
+
   //e6y: don't thrash cpu during pausing
   if (paused) {
     I_uSleep(1000);
@@ -340,6 +402,10 @@ static const char *auto_shot_fname;
 
 static void D_DoomLoop(void)
 {
+  perf_latency_register(&frame_time_stats, "engine_frame_time");
+  perf_latency_register(&tic_time_stats, "engine_tic_time");
+  perf_counters_init_core();
+
   for (;;)
     {
       WasRenderedInTryRunTics = false;
@@ -361,11 +427,17 @@ static void D_DoomLoop(void)
           G_BuildTiccmd (&netcmds[consoleplayer][maketic%BACKUPTICS]);
           if (advancedemo)
             D_DoAdvanceDemo ();
+          uint64_t tic_start_us = perf_now_us();
+          PERF_TRACE_BEGIN(PERF_TRACE_TIC);
+          perf_phase_begin(PERF_PHASE_SIM);
           M_Ticker ();
           G_Ticker ();
           P_Checksum(gametic);
           gametic++;
           maketic++;
+          perf_phase_end(PERF_PHASE_SIM);
+          PERF_TRACE_END(PERF_TRACE_TIC);
+          perf_latency_record(&tic_time_stats, (uint32_t)(perf_now_us() - tic_start_us));
           
           // Reset watchdog after processing single tic
           if (esp_task_wdt_status(NULL) == ESP_OK) {
@@ -378,6 +450,9 @@ static void D_DoomLoop(void)
       // killough 3/16/98: change consoleplayer to displayplayer
       if (players[displayplayer].mo) // cph 2002/08/10
 	S_UpdateSounds(players[displayplayer].mo);// move positional sounds
+      else
+        I_UpdateSound(); // send title, menu and intermission sounds every frame
+      S_UpdateMusic(); // MUS sequencer, also on the title and intermission screens
 
       if (V_GetMode() == VID_MODEGL ? 
         !movement_smooth || !WasRenderedInTryRunTics :
@@ -1354,9 +1429,6 @@ static void D_DoomMainSetup(void)
     nomusicparm = nosound || M_CheckParm("-nomusic");
     nosfxparm   = nosound || M_CheckParm("-nosfx");
   }
-	//Hardcode music and sound disabled -- JD
-    nomusicparm=true;
-    nosfxparm=true;
   //jff end of sound/music command line parms
 
   // killough 3/2/98: allow -nodraw -noblit generally
@@ -164,6 +164,7 @@ int wipe_StartScreen(void)
   V_AllocScreen(&wipe_scr_start);
   screens[SRC_SCR] = wipe_scr_start;
   V_CopyRect(0, 0, 0,       SCREENWIDTH, SCREENHEIGHT, 0, 0, SRC_SCR, VPT_NONE ); // Copy start screen to buffer
+  V_DrawListRaster(SRC_SCR); // the client drew the overlays over it
   return 0;
 }
 
@@ -58,6 +58,11 @@ void AM_Drawer (void);
 // if the level is completed while it is up.
 void AM_Stop (void);
 
+// Called by main loop every frame, for the vector automap.
+void AM_FlushVectors (void);
+
+extern int map_vector; // stream the automap as vectors when a client watches
+
 // killough 2/22/98: for saving automap information in savegame:
 
 extern void AM_Start(void);
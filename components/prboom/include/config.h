@@ -65,7 +65,7 @@
 #define HAVE_MMAP 1
 
 /* Define if you want network game support */
-/* #undef HAVE_NET */
+#define HAVE_NET 1
 
 /* Define to 1 if you have the <sched.h> header file. */
 #define HAVE_SCHED_H 0
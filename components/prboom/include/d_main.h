@@ -36,6 +36,7 @@
 
 #include "d_event.h"
 #include "w_wad.h"
+#include "perf_histogram.h"
 
 #ifdef __GNUG__
 #pragma interface
@@ -58,6 +59,11 @@ extern int ffmap;
 // Called by IO functions when input is detected.
 void D_PostEvent(event_t* ev);
 
+// Engine latency histograms (microseconds): interval between presented
+// frames, and cost of one game tic. Rolled by the instrumentation report.
+extern perf_latency_t frame_time_stats;
+extern perf_latency_t tic_time_stats;
+
 // Demo stuff
 extern boolean advancedemo;
 void D_AdvanceDemo(void);
@@ -68,6 +74,7 @@ void D_DoAdvanceDemo (void);
 //
 
 void D_Display(void);
+boolean D_DisplayIdle(void);
 void D_PageTicker(void);
 void D_StartTitle(void);
 void D_DoomMain(void);
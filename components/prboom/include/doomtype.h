@@ -84,10 +84,13 @@ typedef unsigned __int64 uint_64_t;
 #define CONSTFUNC __attribute__((const))
 #define PUREFUNC __attribute__((pure))
 #define NORETURN __attribute__ ((noreturn))
+/* Named in placement.lf: an inlined static leaves no symbol to place */
+#define PLACEDFUNC __attribute__((noinline))
 #else
 #define CONSTFUNC
 #define PUREFUNC
 #define NORETURN
+#define PLACEDFUNC
 #endif
 
 //esp32
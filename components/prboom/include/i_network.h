@@ -50,13 +50,14 @@
 #endif
 
 void I_InitNetwork(void);
+void I_ShutdownNetwork(void);
+int I_ConnectToServer(const char *serv); /* 0 on success */
 size_t I_GetPacket(packet_header_t* buffer, size_t buflen);
 void I_SendPacket(packet_header_t* packet, size_t len);
 void I_WaitForPacket(int ms);
 
 #ifdef USE_SDL_NET
 UDP_SOCKET I_Socket(Uint16 port);
-int I_ConnectToServer(const char *serv);
 UDP_CHANNEL I_RegisterPlayer(IPaddress *ipaddr);
 void I_UnRegisterPlayer(UDP_CHANNEL channel);
 extern IPaddress sentfrom_addr;
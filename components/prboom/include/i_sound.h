@@ -36,6 +36,7 @@
 
 #include "sounds.h"
 #include "doomtype.h"
+#include "i_soundstats.h"
 
 #define SNDSERV
 #undef SNDINTR
@@ -78,6 +79,9 @@ int I_AnySoundStillPlaying(void);
 //  and pitch of a sound channel.
 void I_UpdateSoundParams(int handle, int vol, int sep, int pitch);
 
+// Called once per frame after the channels are updated
+void I_UpdateSound(void);
+
 //
 //  MUSIC I/O
 //
@@ -116,5 +120,7 @@ extern int snd_card;
 extern int mus_card;
 // CPhipps - put these in config file
 extern int snd_samplerate;
+// Send sound events for the client to play instead of streaming mixed audio
+extern int snd_events;
 
 #endif
@@ -0,0 +1,29 @@
+/* Sound telemetry and sfx data
+ *
+ * Counters kept by the platform sound code, and access to the sfx lumps, in a
+ * header of their own so code outside the engine (the instrumentation report,
+ * the HTTP server) can use them without pulling in doomtype.h.
+ */
+
+#ifndef __I_SOUNDSTATS__
+#define __I_SOUNDSTATS__
+
+// Monotonic since I_InitSound
+typedef struct {
+  unsigned int mix_rate;
+  unsigned int voices;            /* voices in the last mixed block */
+  unsigned int blocks;            /* audio blocks or event batches queued on the socket */
+  unsigned int blocks_dropped;    /* messages the socket queue refused */
+  unsigned long long busy_us;     /* time spent mixing and encoding */
+  unsigned long long bytes;       /* sound bytes queued, headers included */
+  unsigned int music_events;      /* sequencer events queued */
+  unsigned long long music_bytes; /* music bytes queued, headers included */
+} sound_stats_t;
+
+void I_GetSoundStats(sound_stats_t *stats);
+
+// Raw DMX lump of sound effect id, or NULL if the WAD lacks it. The table is
+// filled by I_InitSound, so any task may call this afterwards.
+const void *I_GetSfxLump(int id, int *len);
+
+#endif
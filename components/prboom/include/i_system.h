@@ -52,6 +52,7 @@ void I_GetTime_SaveMS(void);
 unsigned long I_GetRandomTimeSeed(void); /* cphipps */
 
 void I_uSleep(unsigned long usecs);
+unsigned long I_uSecsToNextTic(void); /* time until I_GetTime_RealTime advances */
 
 /* cphipps - I_GetVersionString
  * Returns a version string in the given buffer
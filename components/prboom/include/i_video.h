@@ -75,6 +75,26 @@ void I_StartTic (void);
 
 void I_StartFrame (void);
 
+/* Spectator views (r_views.c): whether anybody watches slot, and hand over a
+ * finished width x height 8bpp view. The pixels are only valid during the call. */
+boolean I_SpectatorViewWanted(int slot);
+void I_PublishSpectatorView(int slot, const byte *pixels, int width, int height);
+
+/* Vector automap (am_map.c): clients watching the game, and send one message
+ * to them. msg[0] is left for the transport's type byte. */
+int I_AutomapListeners(void);
+boolean I_SendAutomap(byte *msg, int len);
+
+/* Draw lists (v_video.c): clients watching the game, and hand over the list
+ * for the frame the next I_FinishUpdate sends; false if that frame cannot go
+ * out. msg[0] is left for the transport's type byte and must stay valid
+ * until then. */
+int I_DrawListListeners(void);
+boolean I_SendDrawList(byte *msg, int len);
+
+extern int video_pacing_fps; /* target output fps, 0 = render every loop */
+extern int statusbar_layer;  /* send the status bar rows only when they change */
+extern int video_idle_fps;   /* frame rate while D_DisplayIdle, 0 = no limit */
 extern int use_doublebuffer;  /* proff 2001-7-4 - controls wether to use doublebuffering*/
 extern int use_fullscreen;  /* proff 21/05/2000 */
 extern int desired_fullscreen; //e6y
@@ -0,0 +1,43 @@
+/* Video output telemetry and lump data
+ *
+ * Counters kept by the video code, and access to the lumps draw lists refer
+ * to, in a header of their own so code outside the engine (the
+ * instrumentation report, the HTTP server) can use them without pulling in
+ * doomtype.h.
+ */
+
+#ifndef __I_VIDEOSTATS__
+#define __I_VIDEOSTATS__
+
+// Monotonic since startup
+typedef struct {
+  unsigned int frames;            /* frames queued for the sender */
+  unsigned int frames_dropped;    /* frames the full queue refused */
+  unsigned int layered;           /* queued as view and status bar layers */
+  unsigned int statusbar_sent;    /* layered frames that carried the status bar */
+  unsigned long long bytes;       /* frame bytes queued, headers included */
+  unsigned int frames_static;     /* idle frames not queued, same as the last */
+  unsigned int idle_frames;       /* frames queued while idle */
+  unsigned long long idle_bytes;  /* bytes of those */
+  unsigned long long idle_us;     /* time spent idle (see D_DisplayIdle) */
+} video_stats_t;
+
+void I_GetVideoStats(video_stats_t *stats);
+
+// Draw lists (v_video.c), monotonic since startup
+typedef struct {
+  unsigned int lists;        /* lists sent */
+  unsigned int commands;     /* patches in those */
+  unsigned long long bytes;  /* list bytes sent, headers included */
+  unsigned int repeats;      /* lists not sent, the same as the client's */
+  unsigned int fallbacks;    /* frames whose patches were drawn after all */
+} drawlist_stats_t;
+
+void V_GetDrawListStats(drawlist_stats_t *stats);
+
+// Raw lump num straight from the memory-mapped WAD, or NULL if there is no
+// such lump. The directory is fixed once the WADs are loaded, so any task
+// may call this afterwards.
+const void *I_GetLump(int num, int *len);
+
+#endif
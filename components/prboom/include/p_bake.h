@@ -0,0 +1,93 @@
+/* Baked level images
+ *
+ * tools/bake_levels.py compiles each map of a WAD into one lump, named after
+ * the map with a BK suffix (E1M1BK, MAP01BK), appended to the WAD. The lump
+ * holds the level as P_SetupLevel leaves it: sidedef fixes applied, texture
+ * and flat numbers resolved, seg lengths measured, slime trails removed,
+ * sector line lists and bounding boxes grouped, and the blockmap built for
+ * maps whose lump is unusable. Loading it is one pass per array that turns
+ * indices into pointers; what is cheaper to derive than to store (line
+ * deltas and boxes, seg sectors) is derived in that pass.
+ *
+ * All fields are little-endian and naturally aligned, so the layout is the
+ * same for the host tool and the target. Vertexes and the BSP walk mirror
+ * (nodesplit_t, nodechildren_t, nodebox_t and segverts_t, see r_defs.h) are
+ * stored in the engine's own layout and used in place for the level; the
+ * rest are compact index records. node_t is not stored: nothing but the
+ * mirror reads nodes, so a baked level has no nodes array.
+ */
+
+#ifndef __P_BAKE__
+#define __P_BAKE__
+
+#define BAKE_MAGIC    0x4b414244  /* "DBAK" */
+#define BAKE_VERSION  2
+#define BAKE_SUFFIX   "BK"
+
+#define BAKE_NO_INDEX 0xffff
+
+// Map lumps the image was built from, THINGS to BLOCKMAP; their sizes must
+// still match for the image to be used
+#define BAKE_MAPLUMPS 10
+
+typedef struct {
+  int magic;
+  int version;
+  unsigned int texhash;   // FNV-1a of the texture names, in number order
+  unsigned int flathash;  // FNV-1a of the flat names, in number order
+  int lumpsize[BAKE_MAPLUMPS];
+
+  int numvertexes, numsectors, numsides, numlines;
+  int numsegs, numsubsectors, numnodes;
+  int numlinerefs;        // sum of sector line list lengths
+  int numblockmap;        // blockmap longs, header included; 0 to load BLOCKMAP
+  int bmaporgx, bmaporgy; // fixed_t
+  int bmapwidth, bmapheight;
+
+  // Byte offsets of each array from the start of the lump
+  int vertexes, sectors, sides, lines;
+  int segs, subsectors, linerefs, blockmap;
+  int nodesplits, nodechildren, nodeboxes, segverts;
+} bake_header_t;
+
+typedef struct {
+  int floorheight, ceilingheight;   // fixed_t
+  int bbox[4];                      // of its lines' vertexes, M_AddToBox order
+  short floorpic, ceilingpic;       // flat numbers
+  short lightlevel, special, tag;
+  unsigned short firstline;         // into the line ref array
+  unsigned short linecount;
+  short pad;
+} bake_sector_t;
+
+typedef struct {
+  short textureoffset, rowoffset;   // map units
+  short toptexture, bottomtexture, midtexture;
+  unsigned short sector;
+  short special;                    // special of the last line using it as side 0
+} bake_side_t;
+
+// Deltas and boxes are taken from the VERTEXES lump, before slime trail
+// removal moved any vertexes
+typedef struct {
+  unsigned short v1, v2;
+  unsigned short flags;             // ML_TWOSIDED cleared without a back side
+  short special, tag;
+  unsigned short sidenum[2];        // NO_INDEX fixed as in P_LoadLineDefs
+  unsigned short frontsector;
+  unsigned short backsector;        // BAKE_NO_INDEX for none
+} bake_line_t;
+
+// Its vertexes are the seg's segverts_t, already moved by slime trail removal
+typedef struct {
+  unsigned short linedef, side;
+  short offset;                     // map units
+  unsigned short angle;             // angle_t >> 16
+  float length;
+} bake_seg_t;
+
+typedef struct {
+  unsigned short sector, numlines, firstline;
+} bake_subsector_t;
+
+#endif
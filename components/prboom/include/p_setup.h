@@ -43,6 +43,9 @@
 void P_SetupLevel(int episode, int map, int playermask, skill_t skill);
 void P_Init(void);               /* Called by startup code. */
 
+/* Load maps from their baked images when the WAD has them (p_bake.h) */
+extern int baked_levels;
+
 extern const byte *rejectmatrix;   /* for fast sight rejection -  cph - const* */
 
 /* killough 3/1/98: change blockmap from "short" to "long" offsets: */
@@ -764,6 +764,10 @@ extern platlist_t *activeplats;        // killough 2/14/98
 
 extern ceilinglist_t *activeceilings;  // jff 2/22/98
 
+// constant scrollers, run lazily instead of as thinkers
+extern scroll_t **lazyscrollers;
+extern int numlazyscrollers;
+
 ////////////////////////////////////////////////////////////////
 //
 // Linedef and sector special utility function prototypes
@@ -920,6 +924,20 @@ void T_MoveElevator
 void T_Scroll
 ( scroll_t * );      // killough 3/7/98: scroll effect thinker
 
+void P_AddScroller
+( scroll_t * );      // lazy list or thinker list
+
+void P_ClearScrollers
+( void );
+
+// before rendering or saving; frac < FRACUNIT for uncapped frames
+void P_UpdateScrollers
+( fixed_t frac );
+
+// after rendering
+void P_RestoreScrollers
+( void );
+
 void T_Friction
 ( friction_t * );    // phares 3/12/98: friction thinker
 
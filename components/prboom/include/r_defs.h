@@ -294,6 +294,37 @@ typedef struct
   unsigned short children[2];    // If NF_SUBSECTOR its a subsector.
 } node_t;
 
+//
+// BSP walk mirror.
+// The BSP walks (R_RenderBSPNode, R_PointInSubsector, P_CrossBSPNode) read
+// only the partition, children and one child box of a node, and only the
+// vertexes of a seg until it is known to be visible. P_SetupLevel copies
+// those fields into separate packed arrays (a baked level carries them in
+// its image), so a walk pulls 8 to 16 bytes per node or seg into the cache
+// instead of the whole node_t or seg_t.
+// Nodes hold whole map units, so they are kept as shorts.
+//
+typedef struct
+{
+  short x, y, dx, dy;            // Partition line, map units.
+} nodesplit_t;
+
+typedef struct
+{
+  unsigned short children[2];
+} nodechildren_t;
+
+typedef struct
+{
+  short bbox[2][4];              // Child bounding boxes, map units.
+} nodebox_t;
+
+typedef struct
+{
+  vertex_t v1, v2;               // Fractional after slime trails. A baked
+                                 // level's segs point at these, not vertexes.
+} segverts_t;
+
 //
 // OTHER TYPES
 //
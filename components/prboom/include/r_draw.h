@@ -57,6 +57,16 @@ enum draw_filter_type_e {
   RDRAW_FILTER_MAXFILTERS
 };
 
+// Highest filter the renderer was built with. RENDER_8BPP_POINT builds only
+// the point sampled 8 bit drawers, so the settings are clamped to POINT.
+#ifdef RENDER_8BPP_POINT
+#define RDRAW_FILTER_UVMAX RDRAW_FILTER_POINT
+#define RDRAW_FILTER_ZMAX  RDRAW_FILTER_POINT
+#else
+#define RDRAW_FILTER_UVMAX RDRAW_FILTER_ROUNDED
+#define RDRAW_FILTER_ZMAX  RDRAW_FILTER_LINEAR
+#endif
+
 // Used to specify what kind of column edge rendering to use on masked 
 // columns. SQUARE = standard, SLOPED = slope the column edge up or down
 // based on neighboring columns
@@ -146,6 +156,10 @@ void R_DrawSpan(draw_span_vars_t *dsvars);
 
 void R_InitBuffer(int width, int height);
 
+// Point the 8bpp drawers at another buffer (spectator views); the next
+// R_InitBuffer points them back at screens[0].
+void R_SetDrawTarget(byte *topleft, int pitch);
+
 // Initialize color translation tables, for player rendering etc.
 void R_InitTranslationTables(void);
 
@@ -49,12 +49,14 @@ typedef struct {
 
 extern view_vars_t original_view_vars;
 
+/* Tic timing for interpolation, in microseconds of the platform clock.
+ * start/next wrap after ~71 minutes; only their differences are used. */
 typedef struct {
   unsigned int start;
   unsigned int next;
   unsigned int step;
   fixed_t frac;
-  float msec;
+  float usec; /* tics per microsecond, scaled by realtic_clock_rate */
 } tic_vars_t;
 
 extern tic_vars_t tic_vars;
@@ -103,10 +103,12 @@ extern const lighttable_t *fixedcolormap;
 //
 
 PUREFUNC int R_PointOnSide(fixed_t x, fixed_t y, const node_t *node);
+PUREFUNC int R_PointOnSplit(fixed_t x, fixed_t y, const nodesplit_t *split);
 PUREFUNC int R_PointOnSegSide(fixed_t x, fixed_t y, const seg_t *line);
 angle_t R_PointToAngle(fixed_t x, fixed_t y);
 angle_t R_PointToAngle2(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2);
 subsector_t *R_PointInSubsector(fixed_t x, fixed_t y);
+void R_BenchmarkBSP(void);                   // BSP walk mirror vs node_t, cold cache
 
 //
 // REFRESH - the actual rendering functions.
@@ -117,4 +119,9 @@ void R_Init(void);                           // Called by startup code.
 void R_SetViewSize(int blocks);              // Called by M_Responder.
 void R_ExecuteSetViewSize(void);             // cph - called by D_Display to complete a view resize
 
+extern int setblocks;
+extern boolean setsizeneeded;
+extern boolean r_spectating;  // rendering a spectator view (r_views.c)
+extern int bsp_benchmark;     // run R_BenchmarkBSP after each level load
+
 #endif
@@ -86,6 +86,12 @@ extern subsector_t      *subsectors;
 extern int              numnodes;
 extern node_t           *nodes;
 
+// BSP walk mirror of nodes and segs (r_defs.h), built with the level
+extern nodesplit_t      *nodesplits;
+extern nodechildren_t   *nodechildren;
+extern nodebox_t        *nodeboxes;
+extern segverts_t       *segverts;
+
 extern int              numlines;
 extern line_t           *lines;
 
@@ -0,0 +1,44 @@
+/* Spectator views
+ *
+ * Extra viewpoints rendered with R_RenderPlayerView into small buffers of
+ * their own, at a lower resolution and frame rate than the main view, and
+ * handed to the platform to stream. Plain ints only, so the server task and
+ * the instrumentation report can include this without doomtype.h.
+ */
+
+#ifndef __R_VIEWS__
+#define __R_VIEWS__
+
+#define R_MAX_VIEWS 2
+
+// View kinds; the numbering is part of the WebSocket view select message
+enum {
+  RV_OFF,     /* not rendered */
+  RV_PLAYER,  /* arg: player number, through that player's eyes */
+  RV_CHASE,   /* arg: player number, from behind and above */
+  RV_FIXED    /* arg: map spot, deathmatch starts first, then player starts */
+};
+
+extern int spectator_fps;    /* per view */
+extern int spectator_blocks; /* view size, as screenblocks */
+extern int spectator_budget; /* % of wall time spectator views may use */
+
+// Monotonic since startup
+typedef struct {
+  unsigned int rendered;
+  unsigned int skipped_budget;   /* due but over spectator_budget */
+  unsigned int skipped_deadline; /* due but would have delayed the next tic */
+  unsigned int avg_us;           /* EWMA of one view render */
+} spectator_stats_t;
+
+// Select what slot shows. Takes effect on the next view render; safe from
+// any task.
+void R_SetSpectatorView(int slot, int kind, int arg);
+
+// Called once per displayed frame, after the main view has been handed off.
+// Renders at most one due view, within the budget.
+void R_RenderSpectatorViews(void);
+
+void R_GetSpectatorStats(spectator_stats_t *stats);
+
+#endif
@@ -87,6 +87,7 @@ void S_ResumeSound(void);
 // Updates music & sounds
 //
 void S_UpdateSounds(void* listener);
+void S_UpdateMusic(void);
 void S_SetMusicVolume(int volume);
 void S_SetSfxVolume(int volume);
 
@@ -99,4 +99,11 @@ extern int sts_pct_always_gray;// status percents do not change colors
 extern int sts_traditional_keys;  // display keys the traditional way
 
 extern int st_palette;    // cph 2006/04/06 - make palette visible
+
+// Status bar layer (see I_FinishUpdate). D_Display sets st_layer when the
+// status bar rows hold nothing but the status bar this frame; widgets set
+// st_changed whenever they draw, and the platform clears it once it has
+// taken the bar.
+extern boolean st_layer;
+extern boolean st_changed;
 #endif
@@ -130,6 +130,14 @@ int V_GetModePixelDepth(video_mode_t mode);
 int V_GetNumPixelBits(void);
 int V_GetPixelDepth(void);
 
+// With the renderer built for 8 bit only, the mode is a constant and the
+// other depths' branches fold away wherever it is tested
+#ifdef RENDER_8BPP_POINT
+#define V_GetMode()         VID_MODE8
+#define V_GetNumPixelBits() 8
+#define V_GetPixelDepth()   1
+#endif
+
 //jff 4/24/98 loads color translation lumps
 void V_InitColorTranslation(void);
 
@@ -196,6 +204,13 @@ typedef struct
 typedef void (*V_DrawLine_f)(fline_t* fl, int color);
 extern V_DrawLine_f V_DrawLine;
 
+// Draw lists: patches recorded as commands for the client instead of drawn
+// (see v_video.c)
+extern int draw_lists;
+void V_RecordPatches(boolean on);
+void V_FlushDrawList(void);
+void V_DrawListRaster(int scrn);
+
 void V_AllocScreen(screeninfo_t *scrn);
 void V_AllocScreens();
 void V_FreeScreen(screeninfo_t *scrn);
@@ -0,0 +1,63 @@
+/* Zone allocator telemetry
+ *
+ * Always-on accounting of the zone heap per purge tag and per memory region,
+ * with high-water marks per level. This header deliberately does not include
+ * z_zone.h, which remaps malloc/free, so code outside the engine (the
+ * instrumentation report) can read the statistics.
+ */
+
+#ifndef __Z_STATS__
+#define __Z_STATS__
+
+#include <stddef.h>
+
+// Upper bound on PU_MAX, checked in z_zone.c
+#define Z_STATS_MAX_TAGS 8
+
+// Levels kept in the history ring
+#define Z_STATS_LEVEL_HISTORY 8
+
+enum {
+  Z_REGION_INTERNAL,
+  Z_REGION_PSRAM,
+  Z_REGION_MAX
+};
+
+// Live totals for one tag in one region
+typedef struct {
+  size_t bytes;
+  unsigned blocks;
+} zone_usage_t;
+
+// One level's footprint, recorded from P_SetupLevel until the next level
+typedef struct {
+  int episode;
+  int map;
+  size_t static_bytes_at_start;     // PU_STATIC after the previous level was freed
+  size_t peak_total_bytes;          // whole zone high-water mark during the level
+  size_t peak_tag_bytes[Z_STATS_MAX_TAGS];
+} zone_level_stats_t;
+
+typedef struct {
+  int tag_count;                                        // PU_MAX
+  zone_usage_t usage[Z_STATS_MAX_TAGS][Z_REGION_MAX];
+  size_t total_bytes;
+  size_t peak_total_bytes;                              // since boot
+  unsigned levels_started;                              // total Z_MarkLevel calls
+  int level_count;                                      // valid entries in levels[]
+  zone_level_stats_t levels[Z_STATS_LEVEL_HISTORY];     // oldest first, current last
+} zone_stats_t;
+
+// Snapshot of all counters (cheap, lock-free; may be off by one in-flight block)
+void Z_GetStats(zone_stats_t *out);
+
+// Start a new per-level high-water window (called from P_SetupLevel)
+void Z_MarkLevel(int episode, int map);
+
+// PU_* tag as a short lowercase name ("static", "level", ...)
+const char *Z_TagName(int tag);
+
+// Z_REGION_* as a name ("internal", "psram")
+const char *Z_RegionName(int region);
+
+#endif
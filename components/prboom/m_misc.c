@@ -67,9 +67,12 @@
 #include "i_joy.h"
 #include "lprintf.h"
 #include "d_main.h"
+#include "r_main.h"
 #include "r_draw.h"
 #include "r_demo.h"
 #include "r_fps.h"
+#include "r_views.h"
+#include "p_setup.h"
 
 /* cph - disk icon not implemented */
 static inline void I_BeginRead(void) {}
@@ -189,6 +192,10 @@ default_t defaults[] =
    def_hex, ss_none}, // 0, +1 for colours, +2 for non-ascii chars, +4 for skip-last-line
   {"level_precache",{(int*)&precache},{0},0,1,
    def_bool,ss_none}, // precache level data?
+  {"baked_levels",{&baked_levels},{1},0,1,
+   def_bool,ss_none}, // load maps from the images tools/bake_levels.py adds
+  {"bsp_benchmark",{&bsp_benchmark},{0},0,1,
+   def_bool,ss_none}, // time BSP descents after each level load
   {"demo_smoothturns", {&demo_smoothturns},  {0},0,1,
    def_bool,ss_stat},
   {"demo_smoothturnsfactor", {&demo_smoothturnsfactor},  {6},1,SMOOTH_PLAYING_MAXFACTOR,
@@ -291,6 +298,8 @@ default_t defaults[] =
    def_int, ss_none}, // 0 = kill music when paused, 1 = pause music, 2 = let music continue
   {"snd_channels",{&default_numChannels},{8},1,32,
    def_int,ss_none}, // number of audio events simultaneously // killough
+  {"snd_events",{&snd_events},{1},0,1,
+   def_bool,ss_none}, // send sound events for the browser to play, 0 streams mixed audio
   {"Video settings",{NULL},{0},UL,UL,def_none,ss_none},
   {"videomode",{NULL, &default_videomode},{0,"8"},UL,UL,def_str,ss_none},
   /* 640x480 default resolution */
@@ -314,16 +323,30 @@ default_t defaults[] =
    def_int,ss_none}, // gamma correction level // killough 1/18/98
   {"uncapped_framerate", {&movement_smooth},  {0},0,1,
    def_bool,ss_stat},
+  {"video_pacing_fps", {&video_pacing_fps}, {TICRATE},0,200,
+   def_int,ss_none}, // time renders to the frame sender, 0 disables
+  {"statusbar_layer", {&statusbar_layer}, {1},0,1,
+   def_bool,ss_none}, // send the status bar as its own layer, only when it changes
+  {"draw_lists", {&draw_lists}, {1},0,1,
+   def_bool,ss_none}, // send HUD, menu and intermission patches as draw commands
+  {"video_idle_fps", {&video_idle_fps}, {10},0,TICRATE,
+   def_int,ss_none}, // frame rate in menus, intermissions and pauses, 0 disables
+  {"spectator_fps", {&spectator_fps}, {10},0,TICRATE,
+   def_int,ss_none}, // frame rate of each spectator view, 0 disables them
+  {"spectator_blocks", {&spectator_blocks}, {5},3,11,
+   def_int,ss_none}, // spectator view size, as screenblocks
+  {"spectator_budget", {&spectator_budget}, {25},1,100,
+   def_int,ss_none}, // % of the time spectator views may spend rendering
   {"filter_wall",{(int*)&drawvars.filterwall},{RDRAW_FILTER_POINT},
-   RDRAW_FILTER_POINT, RDRAW_FILTER_ROUNDED, def_int,ss_none},
+   RDRAW_FILTER_POINT, RDRAW_FILTER_UVMAX, def_int,ss_none},
   {"filter_floor",{(int*)&drawvars.filterfloor},{RDRAW_FILTER_POINT},
-   RDRAW_FILTER_POINT, RDRAW_FILTER_ROUNDED, def_int,ss_none},
+   RDRAW_FILTER_POINT, RDRAW_FILTER_UVMAX, def_int,ss_none},
   {"filter_sprite",{(int*)&drawvars.filtersprite},{RDRAW_FILTER_POINT},
-   RDRAW_FILTER_POINT, RDRAW_FILTER_ROUNDED, def_int,ss_none},
+   RDRAW_FILTER_POINT, RDRAW_FILTER_UVMAX, def_int,ss_none},
   {"filter_z",{(int*)&drawvars.filterz},{RDRAW_FILTER_POINT},
-   RDRAW_FILTER_POINT, RDRAW_FILTER_LINEAR, def_int,ss_none},
+   RDRAW_FILTER_POINT, RDRAW_FILTER_ZMAX, def_int,ss_none},
   {"filter_patch",{(int*)&drawvars.filterpatch},{RDRAW_FILTER_POINT},
-   RDRAW_FILTER_POINT, RDRAW_FILTER_ROUNDED, def_int,ss_none},
+   RDRAW_FILTER_POINT, RDRAW_FILTER_UVMAX, def_int,ss_none},
   {"filter_threshold",{(int*)&drawvars.mag_threshold},{49152},
    0, UL, def_int,ss_none},
   {"sprite_edges",{(int*)&drawvars.sprite_edges},{RDRAW_MASKEDCOLUMNEDGE_SQUARE},
@@ -585,6 +608,8 @@ default_t defaults[] =
    def_bool,ss_auto}, // prevents showing secret sectors till after entered
   {"map_point_coord", {&map_point_coordinates}, {0},0,1,
    def_bool,ss_auto},
+  {"map_vector", {&map_vector}, {1},0,1,
+   def_bool,ss_none}, // send the automap to the client as vectors
   //jff 1/7/98 end additions for automap
   {"automapmode", {(int*)&automapmode}, {0}, 0, 31, // CPhipps - remember automap mode
    def_hex,ss_none}, // automap mode
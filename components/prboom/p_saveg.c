@@ -113,6 +113,9 @@ void P_ArchiveWorld (void)
   const side_t   *si;
   short          *put;
 
+  // lazy scroll offsets are saved as of leveltime
+  P_UpdateScrollers(FRACUNIT);
+
   // killough 3/22/98: fix bug caused by hoisting save_p too early
   // killough 10/98: adjust size for changes below
   size_t size =
@@ -627,6 +630,7 @@ void P_ArchiveSpecials (void)
         th->function==T_Pusher       ? 4+sizeof(pusher_t)  :
         th->function==T_FireFlicker? 4+sizeof(fireflicker_t) :
       0;
+  size += numlazyscrollers * (4+sizeof(scroll_t));
 
   CheckSaveGame(size + 1);    // killough; cph: +1 for the tc_endspecials
 
@@ -788,6 +792,17 @@ void P_ArchiveSpecials (void)
         }
     }
 
+  // Lazy scrollers are saved like scroll thinkers
+  {
+    int i;
+    for (i = 0; i < numlazyscrollers; i++)
+      {
+        *save_p++ = tc_scroll;
+        memcpy (save_p, lazyscrollers[i], sizeof(scroll_t));
+        save_p += sizeof(scroll_t);
+      }
+  }
+
   // add a terminating marker
   *save_p++ = tc_endspecials;
 }
@@ -799,6 +814,12 @@ void P_ArchiveSpecials (void)
 void P_UnArchiveSpecials (void)
 {
   byte tclass;
+  int i;
+
+  // the level's own lazy scrollers give way to the saved ones
+  for (i = 0; i < numlazyscrollers; i++)
+    Z_Free (lazyscrollers[i]);
+  P_ClearScrollers ();
 
   // read in saved thinkers
   while ((tclass = *save_p++) != tc_endspecials)  // killough 2/14/98
@@ -937,7 +958,7 @@ void P_UnArchiveSpecials (void)
           memcpy (scroll, save_p, sizeof(scroll_t));
           save_p += sizeof(scroll_t);
           scroll->thinker.function = T_Scroll;
-          P_AddThinker(&scroll->thinker);
+          P_AddScroller(scroll);
           break;
         }
 
@@ -53,6 +53,10 @@
 #include "r_demo.h"
 #include "r_fps.h"
 #include "i_system.h"
+#include "z_stats.h"
+#include "p_bake.h"
+#include "perf_clock.h"
+#include "perf_histogram.h"
 //
 // MAP related Lookup tables.
 // Store VERTEXES, LINEDEFS, SIDEDEFS, etc.
@@ -73,6 +77,11 @@ subsector_t *subsectors;
 int      numnodes;
 node_t   *nodes;
 
+nodesplit_t    *nodesplits;
+nodechildren_t *nodechildren;
+nodebox_t      *nodeboxes;
+segverts_t     *segverts;
+
 int      numlines;
 line_t   *lines;
 
@@ -509,6 +518,39 @@ static void P_LoadSubsectors (int lump)
   W_UnlockLumpNum(lump); // cph - release the data
 }
 
+//
+// P_InitSector
+//
+// Run time state of a sector just loaded, shared with P_LoadBakedLevel
+//
+
+static void P_InitSector(sector_t *ss)
+{
+  ss->thinglist = NULL;
+  ss->touching_thinglist = NULL;            // phares 3/14/98
+
+  ss->nextsec = -1; //jff 2/26/98 add fields to support locking out
+  ss->prevsec = -1; // stair retriggering until build completes
+
+  // killough 3/7/98:
+  ss->floor_xoffs = 0;
+  ss->floor_yoffs = 0;      // floor and ceiling flats offsets
+  ss->ceiling_xoffs = 0;
+  ss->ceiling_yoffs = 0;
+  ss->heightsec = -1;       // sector used to get floor and ceiling height
+  ss->floorlightsec = -1;   // sector used to get floor lighting
+  // killough 3/7/98: end changes
+
+  // killough 4/11/98 sector used to get ceiling lighting:
+  ss->ceilinglightsec = -1;
+
+  // killough 4/4/98: colormaps:
+  ss->bottommap = ss->midmap = ss->topmap = 0;
+
+  // killough 10/98: sky textures coming from sidedefs:
+  ss->sky = 0;
+}
+
 //
 // P_LoadSectors
 //
@@ -537,29 +579,7 @@ static void P_LoadSectors (int lump)
       ss->special = SHORT(ms->special);
       ss->oldspecial = SHORT(ms->special);
       ss->tag = SHORT(ms->tag);
-      ss->thinglist = NULL;
-      ss->touching_thinglist = NULL;            // phares 3/14/98
-
-      ss->nextsec = -1; //jff 2/26/98 add fields to support locking out
-      ss->prevsec = -1; // stair retriggering until build completes
-
-      // killough 3/7/98:
-      ss->floor_xoffs = 0;
-      ss->floor_yoffs = 0;      // floor and ceiling flats offsets
-      ss->ceiling_xoffs = 0;
-      ss->ceiling_yoffs = 0;
-      ss->heightsec = -1;       // sector used to get floor and ceiling height
-      ss->floorlightsec = -1;   // sector used to get floor lighting
-      // killough 3/7/98: end changes
-
-      // killough 4/11/98 sector used to get ceiling lighting:
-      ss->ceilinglightsec = -1;
-
-      // killough 4/4/98: colormaps:
-      ss->bottommap = ss->midmap = ss->topmap = 0;
-
-      // killough 10/98: sky textures coming from sidedefs:
-      ss->sky = 0;
+      P_InitSector(ss);
     }
 
   W_UnlockLumpNum(lump); // cph - release the data
@@ -650,6 +670,49 @@ static void P_LoadThings (int lump)
   W_UnlockLumpNum(lump); // cph - release the data
 }
 
+//
+// P_SetLineGeometry
+//
+// Deltas, slope, box and sound origin of a line, from its vertexes as the
+// map gives them (before slime trail removal)
+//
+
+static void P_SetLineGeometry(line_t *ld, const vertex_t *v1, const vertex_t *v2)
+{
+  ld->dx = v2->x - v1->x;
+  ld->dy = v2->y - v1->y;
+
+  ld->slopetype = !ld->dx ? ST_VERTICAL : !ld->dy ? ST_HORIZONTAL :
+    FixedDiv(ld->dy, ld->dx) > 0 ? ST_POSITIVE : ST_NEGATIVE;
+
+  if (v1->x < v2->x)
+    {
+      ld->bbox[BOXLEFT] = v1->x;
+      ld->bbox[BOXRIGHT] = v2->x;
+    }
+  else
+    {
+      ld->bbox[BOXLEFT] = v2->x;
+      ld->bbox[BOXRIGHT] = v1->x;
+    }
+  if (v1->y < v2->y)
+    {
+      ld->bbox[BOXBOTTOM] = v1->y;
+      ld->bbox[BOXTOP] = v2->y;
+    }
+  else
+    {
+      ld->bbox[BOXBOTTOM] = v2->y;
+      ld->bbox[BOXTOP] = v1->y;
+    }
+
+  /* calculate sound origin of line to be its midpoint */
+  //e6y: fix sound origin for large levels
+  // no need for comp_sound test, these are only used when comp_sound = 0
+  ld->soundorg.x = ld->bbox[BOXLEFT] / 2 + ld->bbox[BOXRIGHT] / 2;
+  ld->soundorg.y = ld->bbox[BOXTOP] / 2 + ld->bbox[BOXBOTTOM] / 2;
+}
+
 //
 // P_LoadLineDefs
 // Also counts secret lines for intermissions.
@@ -681,41 +744,10 @@ static void P_LoadLineDefs (int lump)
       ld->tag = SHORT(mld->tag);
       v1 = ld->v1 = &vertexes[(unsigned short)SHORT(mld->v1)];
       v2 = ld->v2 = &vertexes[(unsigned short)SHORT(mld->v2)];
-      ld->dx = v2->x - v1->x;
-      ld->dy = v2->y - v1->y;
+      P_SetLineGeometry(ld, v1, v2);
 
       ld->tranlump = -1;   // killough 4/11/98: no translucency by default
 
-      ld->slopetype = !ld->dx ? ST_VERTICAL : !ld->dy ? ST_HORIZONTAL :
-        FixedDiv(ld->dy, ld->dx) > 0 ? ST_POSITIVE : ST_NEGATIVE;
-
-      if (v1->x < v2->x)
-        {
-          ld->bbox[BOXLEFT] = v1->x;
-          ld->bbox[BOXRIGHT] = v2->x;
-        }
-      else
-        {
-          ld->bbox[BOXLEFT] = v2->x;
-          ld->bbox[BOXRIGHT] = v1->x;
-        }
-      if (v1->y < v2->y)
-        {
-          ld->bbox[BOXBOTTOM] = v1->y;
-          ld->bbox[BOXTOP] = v2->y;
-        }
-      else
-        {
-          ld->bbox[BOXBOTTOM] = v2->y;
-          ld->bbox[BOXTOP] = v1->y;
-        }
-
-      /* calculate sound origin of line to be its midpoint */
-      //e6y: fix sound origin for large levels
-      // no need for comp_sound test, these are only used when comp_sound = 0
-      ld->soundorg.x = ld->bbox[BOXLEFT] / 2 + ld->bbox[BOXRIGHT] / 2;
-      ld->soundorg.y = ld->bbox[BOXTOP] / 2 + ld->bbox[BOXBOTTOM] / 2;
-
       ld->iLineID=i; // proff 04/05/2000: needed for OpenGL
       ld->sidenum[0] = SHORT(mld->sidenum[0]);
       ld->sidenum[1] = SHORT(mld->sidenum[1]);
@@ -757,6 +789,25 @@ static void P_LoadLineDefs (int lump)
   W_UnlockLumpNum(lump); // cph - release the lump
 }
 
+// killough 4/11/98: handle special types
+static void P_SetLineTranslucency(line_t *ld)
+{
+  switch (ld->special)
+    {
+      int lump, j;
+
+    case 260:               // killough 4/11/98: translucent 2s textures
+        lump = sides[*ld->sidenum].special; // translucency from sidedef
+        if (!ld->tag)                       // if tag==0,
+          ld->tranlump = lump;              // affect this linedef only
+        else
+          for (j=0;j<numlines;j++)          // if tag!=0,
+            if (lines[j].tag == ld->tag)    // affect all matching linedefs
+              lines[j].tranlump = lump;
+        break;
+    }
+}
+
 // killough 4/4/98: delay using sidedefs until they are loaded
 // killough 5/3/98: reformatted, cleaned up
 
@@ -768,20 +819,7 @@ static void P_LoadLineDefs2(int lump)
     {
       ld->frontsector = sides[ld->sidenum[0]].sector; //e6y: Can't be NO_INDEX here
       ld->backsector  = ld->sidenum[1]!=NO_INDEX ? sides[ld->sidenum[1]].sector : 0;
-      switch (ld->special)
-        {                       // killough 4/11/98: handle special types
-          int lump, j;
-
-        case 260:               // killough 4/11/98: translucent 2s textures
-            lump = sides[*ld->sidenum].special; // translucency from sidedef
-            if (!ld->tag)                       // if tag==0,
-              ld->tranlump = lump;              // affect this linedef only
-            else
-              for (j=0;j<numlines;j++)          // if tag!=0,
-                if (lines[j].tag == ld->tag)    // affect all matching linedefs
-                  lines[j].tranlump = lump;
-            break;
-        }
+      P_SetLineTranslucency(ld);
     }
 }
 
@@ -800,6 +838,45 @@ static void P_LoadSideDefs (int lump)
 // after linedefs are loaded, to allow overloading.
 // killough 5/3/98: reformatted, cleaned up
 
+// killough 4/4/98: allow sidedef texture names to be overloaded
+// killough 4/11/98: refined to allow colormaps to work as wall
+// textures if invalid as colormaps but valid as textures.
+static void P_SetSideDefTextures(side_t *sd, const mapsidedef_t *msd, int i)
+{
+  sector_t *sec = sd->sector;
+
+  switch (sd->special)
+    {
+    case 242:                       // variable colormap via 242 linedef
+      sd->bottomtexture =
+        (sec->bottommap =   R_ColormapNumForName(msd->bottomtexture)) < 0 ?
+        sec->bottommap = 0, R_TextureNumForName(msd->bottomtexture): 0 ;
+      sd->midtexture =
+        (sec->midmap =   R_ColormapNumForName(msd->midtexture)) < 0 ?
+        sec->midmap = 0, R_TextureNumForName(msd->midtexture)  : 0 ;
+      sd->toptexture =
+        (sec->topmap =   R_ColormapNumForName(msd->toptexture)) < 0 ?
+        sec->topmap = 0, R_TextureNumForName(msd->toptexture)  : 0 ;
+      break;
+
+    case 260: // killough 4/11/98: apply translucency to 2s normal texture
+      sd->midtexture = strncasecmp("TRANMAP", msd->midtexture, 8) ?
+        (sd->special = W_CheckNumForName(msd->midtexture)) < 0 ||
+        W_LumpLength(sd->special) != 65536 ?
+        sd->special=0, R_TextureNumForName(msd->midtexture) :
+          (sd->special++, 0) : (sd->special=0);
+      sd->toptexture = R_TextureNumForName(msd->toptexture);
+      sd->bottomtexture = R_TextureNumForName(msd->bottomtexture);
+      break;
+
+    default:                        // normal cases
+      sd->midtexture = R_SafeTextureNumForName(msd->midtexture, i);
+      sd->toptexture = R_SafeTextureNumForName(msd->toptexture, i);
+      sd->bottomtexture = R_SafeTextureNumForName(msd->bottomtexture, i);
+      break;
+    }
+}
+
 static void P_LoadSideDefs2(int lump)
 {
   const byte *data = W_CacheLumpNum(lump); // cph - const*, wad lump handling updated
@@ -809,7 +886,6 @@ static void P_LoadSideDefs2(int lump)
     {
       register const mapsidedef_t *msd = (const mapsidedef_t *) data + i;
       register side_t *sd = sides + i;
-      register sector_t *sec;
 
       sd->textureoffset = SHORT(msd->textureoffset)<<FRACBITS;
       sd->rowoffset = SHORT(msd->rowoffset)<<FRACBITS;
@@ -820,42 +896,10 @@ static void P_LoadSideDefs2(int lump)
           lprintf(LO_WARN,"P_LoadSideDefs2: sidedef %i has out-of-range sector num %u\n", i, sector_num);
           sector_num = 0;
         }
-        sd->sector = sec = &sectors[sector_num];
+        sd->sector = &sectors[sector_num];
       }
 
-      // killough 4/4/98: allow sidedef texture names to be overloaded
-      // killough 4/11/98: refined to allow colormaps to work as wall
-      // textures if invalid as colormaps but valid as textures.
-      switch (sd->special)
-        {
-        case 242:                       // variable colormap via 242 linedef
-          sd->bottomtexture =
-            (sec->bottommap =   R_ColormapNumForName(msd->bottomtexture)) < 0 ?
-            sec->bottommap = 0, R_TextureNumForName(msd->bottomtexture): 0 ;
-          sd->midtexture =
-            (sec->midmap =   R_ColormapNumForName(msd->midtexture)) < 0 ?
-            sec->midmap = 0, R_TextureNumForName(msd->midtexture)  : 0 ;
-          sd->toptexture =
-            (sec->topmap =   R_ColormapNumForName(msd->toptexture)) < 0 ?
-            sec->topmap = 0, R_TextureNumForName(msd->toptexture)  : 0 ;
-          break;
-
-        case 260: // killough 4/11/98: apply translucency to 2s normal texture
-          sd->midtexture = strncasecmp("TRANMAP", msd->midtexture, 8) ?
-            (sd->special = W_CheckNumForName(msd->midtexture)) < 0 ||
-            W_LumpLength(sd->special) != 65536 ?
-            sd->special=0, R_TextureNumForName(msd->midtexture) :
-              (sd->special++, 0) : (sd->special=0);
-          sd->toptexture = R_TextureNumForName(msd->toptexture);
-          sd->bottomtexture = R_TextureNumForName(msd->bottomtexture);
-          break;
-
-        default:                        // normal cases
-          sd->midtexture = R_SafeTextureNumForName(msd->midtexture, i);
-          sd->toptexture = R_SafeTextureNumForName(msd->toptexture, i);
-          sd->bottomtexture = R_SafeTextureNumForName(msd->bottomtexture, i);
-          break;
-        }
+      P_SetSideDefTextures(sd, msd, i);
     }
 
   W_UnlockLumpNum(lump); // cph - release the lump
@@ -1312,6 +1356,51 @@ static void P_AddLineToSector(line_t* li, sector_t* sector)
   M_AddToBox (bbox, li->v2->x, li->v2->y);
 }
 
+// Sound origins and map block boxes of sectors, from the bounding boxes of
+// their lines left in blockbox
+static void P_SetSectorBlockBoxes(void)
+{
+  sector_t *sector;
+  int i;
+
+  for (i=0, sector = sectors; i<numsectors; i++, sector++)
+  {
+    fixed_t *bbox = (void*)sector->blockbox; // cph - For convenience, so
+                                  // I can sue the old code unchanged
+    int block;
+
+    // set the degenmobj_t to the middle of the bounding box
+    if (comp[comp_sound])
+    {
+      sector->soundorg.x = (bbox[BOXRIGHT]+bbox[BOXLEFT])/2;
+      sector->soundorg.y = (bbox[BOXTOP]+bbox[BOXBOTTOM])/2;
+    }
+    else
+    {
+      //e6y: fix sound origin for large levels
+      sector->soundorg.x = bbox[BOXRIGHT]/2+bbox[BOXLEFT]/2;
+      sector->soundorg.y = bbox[BOXTOP]/2+bbox[BOXBOTTOM]/2;
+    }
+
+    // adjust bounding box to map blocks
+    block = (bbox[BOXTOP]-bmaporgy+MAXRADIUS)>>MAPBLOCKSHIFT;
+    block = block >= bmapheight ? bmapheight-1 : block;
+    sector->blockbox[BOXTOP]=block;
+
+    block = (bbox[BOXBOTTOM]-bmaporgy-MAXRADIUS)>>MAPBLOCKSHIFT;
+    block = block < 0 ? 0 : block;
+    sector->blockbox[BOXBOTTOM]=block;
+
+    block = (bbox[BOXRIGHT]-bmaporgx+MAXRADIUS)>>MAPBLOCKSHIFT;
+    block = block >= bmapwidth ? bmapwidth-1 : block;
+    sector->blockbox[BOXRIGHT]=block;
+
+    block = (bbox[BOXLEFT]-bmaporgx-MAXRADIUS)>>MAPBLOCKSHIFT;
+    block = block < 0 ? 0 : block;
+    sector->blockbox[BOXLEFT]=block;
+  }
+}
+
 // modified to return totallines (needed by P_LoadReject)
 static int P_GroupLines (void)
 {
@@ -1371,46 +1460,12 @@ static int P_GroupLines (void)
       P_AddLineToSector(li, li->backsector);
   }
 
-  for (i=0, sector = sectors; i<numsectors; i++, sector++)
-  {
-    fixed_t *bbox = (void*)sector->blockbox; // cph - For convenience, so
-                                  // I can sue the old code unchanged
-    int block;
-
-    // set the degenmobj_t to the middle of the bounding box
-    if (comp[comp_sound])
-    {
-      sector->soundorg.x = (bbox[BOXRIGHT]+bbox[BOXLEFT])/2;
-      sector->soundorg.y = (bbox[BOXTOP]+bbox[BOXBOTTOM])/2;
-    }
-    else
-    {
-      //e6y: fix sound origin for large levels
-      sector->soundorg.x = bbox[BOXRIGHT]/2+bbox[BOXLEFT]/2;
-      sector->soundorg.y = bbox[BOXTOP]/2+bbox[BOXBOTTOM]/2;
-    }
-
-    // adjust bounding box to map blocks
-    block = (bbox[BOXTOP]-bmaporgy+MAXRADIUS)>>MAPBLOCKSHIFT;
-    block = block >= bmapheight ? bmapheight-1 : block;
-    sector->blockbox[BOXTOP]=block;
-
-    block = (bbox[BOXBOTTOM]-bmaporgy-MAXRADIUS)>>MAPBLOCKSHIFT;
-    block = block < 0 ? 0 : block;
-    sector->blockbox[BOXBOTTOM]=block;
-
-    block = (bbox[BOXRIGHT]-bmaporgx+MAXRADIUS)>>MAPBLOCKSHIFT;
-    block = block >= bmapwidth ? bmapwidth-1 : block;
-    sector->blockbox[BOXRIGHT]=block;
-
-    block = (bbox[BOXLEFT]-bmaporgx-MAXRADIUS)>>MAPBLOCKSHIFT;
-    block = block < 0 ? 0 : block;
-    sector->blockbox[BOXLEFT]=block;
-  }
+  P_SetSectorBlockBoxes();
 
   return total; // this value is needed by the reject overrun emulation code
 }
 
+
 //
 // killough 10/98
 //
@@ -1493,6 +1548,279 @@ static void P_RemoveSlimeTrails(void)         // killough 10/98
   free(hit);
 }
 
+//
+// P_BuildBSPMirror
+//
+// The packed node and seg fields the BSP walks read (r_defs.h), copied once
+// the level's vertexes have settled. Baked levels carry them in the image.
+//
+
+static void P_BuildBSPMirror(void)
+{
+  int i, j, k;
+
+  nodesplits = Z_Malloc(numnodes*sizeof(*nodesplits), PU_LEVEL, 0);
+  nodechildren = Z_Malloc(numnodes*sizeof(*nodechildren), PU_LEVEL, 0);
+  nodeboxes = Z_Malloc(numnodes*sizeof(*nodeboxes), PU_LEVEL, 0);
+  for (i = 0; i < numnodes; i++)
+    {
+      const node_t *no = nodes + i;
+
+      nodesplits[i].x = no->x >> FRACBITS;
+      nodesplits[i].y = no->y >> FRACBITS;
+      nodesplits[i].dx = no->dx >> FRACBITS;
+      nodesplits[i].dy = no->dy >> FRACBITS;
+      for (j = 0; j < 2; j++)
+        {
+          nodechildren[i].children[j] = no->children[j];
+          for (k = 0; k < 4; k++)
+            nodeboxes[i].bbox[j][k] = no->bbox[j][k] >> FRACBITS;
+        }
+    }
+
+  segverts = Z_Malloc(numsegs*sizeof(*segverts), PU_LEVEL, 0);
+  for (i = 0; i < numsegs; i++)
+    {
+      segverts[i].v1 = *segs[i].v1;
+      segverts[i].v2 = *segs[i].v2;
+    }
+}
+
+//
+// P_LoadBakedLevel
+//
+// Loads the level from the image tools/bake_levels.py appended to the WAD
+// (see p_bake.h) instead of parsing the map lumps. Vertexes and the BSP walk
+// mirror, which nothing changes once the level is up, are used in place from
+// the image (mapped from flash on the target); the other arrays carry
+// pointers or run time state and are filled from it in one pass each. The image is used
+// only when it was built from this map
+// and from the textures and flats loaded now, and when the level would be
+// set up the way the tool sets it up: classic nodes, slime trails removed
+// and the WAD's blockmap. Returns false to have the caller parse the map.
+//
+
+int baked_levels = 1;
+
+// The image stays cached for the level, which uses parts of it in place
+static int bakelump = -1;
+
+// FNV-1a over 8 character names, as the tool hashes them
+static unsigned int P_HashName(unsigned int h, const char *name)
+{
+  int i;
+
+  for (i = 0; i < 8; i++)
+    h = (h ^ (byte)name[i]) * 0x01000193;
+  return h;
+}
+
+static boolean P_BakeMatches(const bake_header_t *bh, int lumpnum)
+{
+  static unsigned int texhash, flathash;
+  static boolean hashed;
+  int i;
+
+  if (!hashed) {
+    texhash = flathash = 0x811c9dc5;
+    for (i = 0; i < numtextures; i++)
+      texhash = P_HashName(texhash, textures[i]->name);
+    for (i = firstflat; i < firstflat + numflats; i++)
+      flathash = P_HashName(flathash, lumpinfo[i].name);
+    hashed = true;
+  }
+
+  if (bh->magic != BAKE_MAGIC || bh->version != BAKE_VERSION ||
+      bh->texhash != texhash || bh->flathash != flathash)
+    return false;
+  for (i = 0; i < BAKE_MAPLUMPS; i++)
+    if (bh->lumpsize[i] != W_LumpLength(lumpnum + ML_THINGS + i))
+      return false;
+  return true;
+}
+
+static boolean P_LoadBakedLevel(int lumpnum, const char *mapname)
+{
+  char name[9];
+  const byte *data;
+  const bake_header_t *bh;
+  const mapvertex_t *mv;
+  const mapsidedef_t *msd;
+  const unsigned short *refs;
+  line_t **linebuffer;
+  int i, lump;
+
+#ifdef WORDS_BIGENDIAN
+  return false;
+#endif
+  if (!baked_levels || nodesVersion > 0 || M_CheckParm("-blockmap") ||
+      !(compatibility_level>=lxdoom_1_compatibility || M_CheckParm("-force_remove_slime_trails") > 0))
+    return false;
+
+  // Only an image from the same file can describe these map lumps
+  snprintf(name, sizeof(name), "%s%s", mapname, BAKE_SUFFIX);
+  if ((lump = W_CheckNumForName(name)) < 0 ||
+      lumpinfo[lump].wadfile != lumpinfo[lumpnum].wadfile ||
+      W_LumpLength(lump) < (int)sizeof(bake_header_t))
+    return false;
+
+  data = W_CacheLumpNum(lump);
+  bh = (const bake_header_t *)data;
+  if (!P_BakeMatches(bh, lumpnum)) {
+    lprintf(LO_WARN, "P_LoadBakedLevel: %s was baked from other data, parsing %s\n",
+            name, mapname);
+    W_UnlockLumpNum(lump);
+    return false;
+  }
+
+  numvertexes = bh->numvertexes;
+  vertexes = (vertex_t *)(data + bh->vertexes);
+
+  numsectors = bh->numsectors;
+  sectors = Z_Calloc(numsectors, sizeof(sector_t), PU_LEVEL, 0);
+  refs = (const unsigned short *)(data + bh->linerefs);
+  linebuffer = Z_Malloc(bh->numlinerefs*sizeof(line_t *), PU_LEVEL, 0);
+  for (i = 0; i < numsectors; i++)
+    {
+      const bake_sector_t *bs = (const bake_sector_t *)(data + bh->sectors) + i;
+      sector_t *ss = sectors + i;
+
+      ss->iSectorID = i;
+      ss->floorheight = bs->floorheight;
+      ss->ceilingheight = bs->ceilingheight;
+      ss->floorpic = bs->floorpic;
+      ss->ceilingpic = bs->ceilingpic;
+      ss->lightlevel = bs->lightlevel;
+      ss->special = bs->special;
+      ss->oldspecial = bs->special;
+      ss->tag = bs->tag;
+      P_InitSector(ss);
+      ss->lines = linebuffer + bs->firstline;
+      ss->linecount = bs->linecount;
+      memcpy(ss->blockbox, bs->bbox, sizeof(ss->blockbox));
+    }
+
+  numlines = bh->numlines;
+  lines = Z_Calloc(numlines, sizeof(line_t), PU_LEVEL, 0);
+  for (i = 0; i < bh->numlinerefs; i++)
+    linebuffer[i] = lines + refs[i];
+
+  // Sidedefs overloaded by 242 and 260 name colormaps and lumps, which the
+  // tool leaves to P_SetSideDefTextures
+  numsides = bh->numsides;
+  sides = Z_Calloc(numsides, sizeof(side_t), PU_LEVEL, 0);
+  msd = W_CacheLumpNum(lumpnum + ML_SIDEDEFS);
+  for (i = 0; i < numsides; i++)
+    {
+      const bake_side_t *bs = (const bake_side_t *)(data + bh->sides) + i;
+      side_t *sd = sides + i;
+
+      sd->textureoffset = bs->textureoffset<<FRACBITS;
+      sd->rowoffset = bs->rowoffset<<FRACBITS;
+      sd->toptexture = bs->toptexture;
+      sd->bottomtexture = bs->bottomtexture;
+      sd->midtexture = bs->midtexture;
+      sd->sector = &sectors[bs->sector];
+      sd->special = bs->special;
+      if (sd->special == 242 || sd->special == 260)
+        P_SetSideDefTextures(sd, msd + i, i);
+    }
+  W_UnlockLumpNum(lumpnum + ML_SIDEDEFS);
+
+  mv = W_CacheLumpNum(lumpnum + ML_VERTEXES);
+  for (i = 0; i < numlines; i++)
+    {
+      const bake_line_t *bl = (const bake_line_t *)(data + bh->lines) + i;
+      line_t *ld = lines + i;
+      vertex_t v1, v2;
+
+      v1.x = SHORT(mv[bl->v1].x)<<FRACBITS;
+      v1.y = SHORT(mv[bl->v1].y)<<FRACBITS;
+      v2.x = SHORT(mv[bl->v2].x)<<FRACBITS;
+      v2.y = SHORT(mv[bl->v2].y)<<FRACBITS;
+      ld->v1 = &vertexes[bl->v1];
+      ld->v2 = &vertexes[bl->v2];
+      P_SetLineGeometry(ld, &v1, &v2);
+
+      ld->flags = bl->flags;
+      ld->special = bl->special;
+      ld->tag = bl->tag;
+      ld->tranlump = -1;
+      ld->iLineID = i;
+      ld->sidenum[0] = bl->sidenum[0];
+      ld->sidenum[1] = bl->sidenum[1];
+      ld->frontsector = &sectors[bl->frontsector];
+      ld->backsector = bl->backsector != BAKE_NO_INDEX ? &sectors[bl->backsector] : NULL;
+    }
+  W_UnlockLumpNum(lumpnum + ML_VERTEXES);
+  for (i = 0; i < numlines; i++)
+    P_SetLineTranslucency(lines + i);
+
+  if (bh->numblockmap)
+    {
+      const int *bm = (const int *)(data + bh->blockmap);
+
+      blockmaplump = Z_Malloc(bh->numblockmap*sizeof(*blockmaplump), PU_LEVEL, 0);
+      for (i = 0; i < bh->numblockmap; i++)
+        blockmaplump[i] = bm[i];
+      bmaporgx = bh->bmaporgx;
+      bmaporgy = bh->bmaporgy;
+      bmapwidth = bh->bmapwidth;
+      bmapheight = bh->bmapheight;
+      blocklinks = Z_Calloc(bmapwidth*bmapheight, sizeof(*blocklinks), PU_LEVEL, 0);
+      blockmap = blockmaplump+4;
+    }
+  else
+    P_LoadBlockMap(lumpnum + ML_BLOCKMAP);
+  P_SetSectorBlockBoxes();
+
+  numsubsectors = bh->numsubsectors;
+  subsectors = Z_Calloc(numsubsectors, sizeof(subsector_t), PU_LEVEL, 0);
+  for (i = 0; i < numsubsectors; i++)
+    {
+      const bake_subsector_t *bs = (const bake_subsector_t *)(data + bh->subsectors) + i;
+
+      subsectors[i].sector = &sectors[bs->sector];
+      subsectors[i].numlines = bs->numlines;
+      subsectors[i].firstline = bs->firstline;
+    }
+
+  numnodes = bh->numnodes;
+  nodes = NULL;
+  nodesplits = (nodesplit_t *)(data + bh->nodesplits);
+  nodechildren = (nodechildren_t *)(data + bh->nodechildren);
+  nodeboxes = (nodebox_t *)(data + bh->nodeboxes);
+
+  numsegs = bh->numsegs;
+  segverts = (segverts_t *)(data + bh->segverts);
+  segs = Z_Calloc(numsegs, sizeof(seg_t), PU_LEVEL, 0);
+  for (i = 0; i < numsegs; i++)
+    {
+      const bake_seg_t *bs = (const bake_seg_t *)(data + bh->segs) + i;
+      seg_t *li = segs + i;
+      line_t *ldef = &lines[bs->linedef];
+      int side = bs->side;
+
+      li->iSegID = i;
+      li->v1 = &segverts[i].v1;
+      li->v2 = &segverts[i].v2;
+      li->miniseg = false;
+      li->length = bs->length;
+      li->angle = (angle_t)bs->angle<<16;
+      li->offset = bs->offset<<16;
+      li->linedef = ldef;
+      li->sidedef = &sides[ldef->sidenum[side]];
+      li->frontsector = ldef->sidenum[side] != NO_INDEX ? sides[ldef->sidenum[side]].sector : 0;
+      li->backsector = ldef->flags & ML_TWOSIDED && ldef->sidenum[side^1] != NO_INDEX ?
+        sides[ldef->sidenum[side^1]].sector : 0;
+    }
+
+  P_LoadReject(lumpnum, bh->numlinerefs);
+
+  bakelump = lump;
+  return true;
+}
+
 //
 // P_SetupLevel
 //
@@ -1507,6 +1835,17 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   char  gl_lumpname[9];
   int   gl_lumpnum;
 
+  static PERF_HISTOGRAM_ATTR perf_latency_t level_load_stats;
+  static boolean registered;
+  boolean baked;
+  uint64_t start;
+  uint32_t took;
+
+  if (!registered) {
+    perf_latency_register(&level_load_stats, "engine_level_load");
+    registered = true;
+  }
+
   R_StopAllInterpolations();
 
   totallive = totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
@@ -1522,10 +1861,15 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   S_Start();
 
   Z_FreeTags(PU_LEVEL, PU_PURGELEVEL-1);
+  Z_MarkLevel(episode, map);  // PU_STATIC at this point should stay flat from level to level
   if (rejectlump != -1) { // cph - unlock the reject table
     W_UnlockLumpNum(rejectlump);
     rejectlump = -1;
   }
+  if (bakelump != -1) {
+    W_UnlockLumpNum(bakelump);
+    bakelump = -1;
+  }
 
   P_InitThinkers();
 
@@ -1560,58 +1904,69 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
       && !strncasecmp(lumpinfo[i].name, "BEHAVIOR", 8))
     I_Error("P_SetupLevel: %s: Hexen format not supported", lumpname);
 
-#if 1
   // figgi 10/19/00 -- check for gl lumps and load them
   P_GetNodesVersion(lumpnum,gl_lumpnum);
 
-  if (nodesVersion > 0)
-    P_LoadVertexes2 (lumpnum+ML_VERTEXES,gl_lumpnum+ML_GL_VERTS);
-  else
-    P_LoadVertexes  (lumpnum+ML_VERTEXES);
-  P_LoadSectors   (lumpnum+ML_SECTORS);
-  P_LoadSideDefs  (lumpnum+ML_SIDEDEFS);
-  P_LoadLineDefs  (lumpnum+ML_LINEDEFS);
-  P_LoadSideDefs2 (lumpnum+ML_SIDEDEFS);
-  P_LoadLineDefs2 (lumpnum+ML_LINEDEFS);
-  P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);
-
-  if (nodesVersion > 0)
+  start = perf_now_us();
+  baked = P_LoadBakedLevel(lumpnum, lumpname);
+  if (!baked)
   {
-    P_LoadSubsectors(gl_lumpnum + ML_GL_SSECT);
-    P_LoadNodes(gl_lumpnum + ML_GL_NODES);
-    P_LoadGLSegs(gl_lumpnum + ML_GL_SEGS);
-  }
-  else
-  {
-    P_LoadSubsectors(lumpnum + ML_SSECTORS);
-    P_LoadNodes(lumpnum + ML_NODES);
-    P_LoadSegs(lumpnum + ML_SEGS);
-  }
+#if 1
+    if (nodesVersion > 0)
+      P_LoadVertexes2 (lumpnum+ML_VERTEXES,gl_lumpnum+ML_GL_VERTS);
+    else
+      P_LoadVertexes  (lumpnum+ML_VERTEXES);
+    P_LoadSectors   (lumpnum+ML_SECTORS);
+    P_LoadSideDefs  (lumpnum+ML_SIDEDEFS);
+    P_LoadLineDefs  (lumpnum+ML_LINEDEFS);
+    P_LoadSideDefs2 (lumpnum+ML_SIDEDEFS);
+    P_LoadLineDefs2 (lumpnum+ML_LINEDEFS);
+    P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);
+
+    if (nodesVersion > 0)
+    {
+      P_LoadSubsectors(gl_lumpnum + ML_GL_SSECT);
+      P_LoadNodes(gl_lumpnum + ML_GL_NODES);
+      P_LoadGLSegs(gl_lumpnum + ML_GL_SEGS);
+    }
+    else
+    {
+      P_LoadSubsectors(lumpnum + ML_SSECTORS);
+      P_LoadNodes(lumpnum + ML_NODES);
+      P_LoadSegs(lumpnum + ML_SEGS);
+    }
 
 #else
 
-  P_LoadVertexes  (lumpnum+ML_VERTEXES);
-  P_LoadSectors   (lumpnum+ML_SECTORS);
-  P_LoadSideDefs  (lumpnum+ML_SIDEDEFS);             // killough 4/4/98
-  P_LoadLineDefs  (lumpnum+ML_LINEDEFS);             //       |
-  P_LoadSideDefs2 (lumpnum+ML_SIDEDEFS);             //       |
-  P_LoadLineDefs2 (lumpnum+ML_LINEDEFS);             // killough 4/4/98
-  P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);             // killough 3/1/98
-  P_LoadSubsectors(lumpnum+ML_SSECTORS);
-  P_LoadNodes     (lumpnum+ML_NODES);
-  P_LoadSegs      (lumpnum+ML_SEGS);
+    P_LoadVertexes  (lumpnum+ML_VERTEXES);
+    P_LoadSectors   (lumpnum+ML_SECTORS);
+    P_LoadSideDefs  (lumpnum+ML_SIDEDEFS);             // killough 4/4/98
+    P_LoadLineDefs  (lumpnum+ML_LINEDEFS);             //       |
+    P_LoadSideDefs2 (lumpnum+ML_SIDEDEFS);             //       |
+    P_LoadLineDefs2 (lumpnum+ML_LINEDEFS);             // killough 4/4/98
+    P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);             // killough 3/1/98
+    P_LoadSubsectors(lumpnum+ML_SSECTORS);
+    P_LoadNodes     (lumpnum+ML_NODES);
+    P_LoadSegs      (lumpnum+ML_SEGS);
 
 #endif
 
-  // reject loading and underflow padding separated out into new function
-  // P_GroupLines modified to return a number the underflow padding needs
-  P_LoadReject(lumpnum, P_GroupLines());
+    // reject loading and underflow padding separated out into new function
+    // P_GroupLines modified to return a number the underflow padding needs
+    P_LoadReject(lumpnum, P_GroupLines());
 
-  // e6y
-  // Correction of desync on dv04-423.lmp/dv.wad
-  // http://www.doomworld.com/vb/showthread.php?s=&postid=627257#post627257
-  if (compatibility_level>=lxdoom_1_compatibility || M_CheckParm("-force_remove_slime_trails") > 0)
-    P_RemoveSlimeTrails();    // killough 10/98: remove slime trails from wad
+    // e6y
+    // Correction of desync on dv04-423.lmp/dv.wad
+    // http://www.doomworld.com/vb/showthread.php?s=&postid=627257#post627257
+    if (compatibility_level>=lxdoom_1_compatibility || M_CheckParm("-force_remove_slime_trails") > 0)
+      P_RemoveSlimeTrails();    // killough 10/98: remove slime trails from wad
+
+    P_BuildBSPMirror();
+  }
+  took = (uint32_t)(perf_now_us() - start);
+  perf_latency_record(&level_load_stats, took);
+  lprintf(LO_INFO, "P_SetupLevel: %s %s in %u us\n",
+          lumpname, baked ? "loaded from its image" : "parsed", (unsigned)took);
 
   // Note: you don't need to clear player queue slots --
   // a much simpler fix is in g_game.c -- killough 10/98
@@ -1661,6 +2016,9 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   if (precache)
     R_PrecacheLevel();
 
+  if (bsp_benchmark)
+    R_BenchmarkBSP();
+
   R_SmoothPlaying_Reset(NULL); // e6y
 }
 
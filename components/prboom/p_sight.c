@@ -200,22 +200,24 @@ static boolean P_CrossSubsector(int num)
 // cph - Made to use R_PointOnSide instead of P_DivlineSide, since the latter
 //  could return 2 which was ambigous, and the former is
 //  better optimised; also removes two casts :-)
+// Both walk the BSP mirror (r_defs.h) rather than the full node_t.
 
 static boolean P_CrossBSPNode_LxDoom(int bspnum)
 {
   while (!(bspnum & NF_SUBSECTOR))
     {
-      register const node_t *bsp = nodes + bspnum;
+      register const nodesplit_t *split = nodesplits + bspnum;
+      const unsigned short *children = nodechildren[bspnum].children;
       int side,side2;
-      side = R_PointOnSide(los.strace.x, los.strace.y, bsp);
-      side2 = R_PointOnSide(los.t2x, los.t2y, bsp);
+      side = R_PointOnSplit(los.strace.x, los.strace.y, split);
+      side2 = R_PointOnSplit(los.t2x, los.t2y, split);
       if (side == side2)
-         bspnum = bsp->children[side]; // doesn't touch the other side
+         bspnum = children[side]; // doesn't touch the other side
       else         // the partition plane is crossed here
-        if (!P_CrossBSPNode_LxDoom(bsp->children[side]))
+        if (!P_CrossBSPNode_LxDoom(children[side]))
           return 0;  // cross the starting side
         else
-          bspnum = bsp->children[side^1];  // cross the ending side
+          bspnum = children[side^1];  // cross the ending side
     }
   return P_CrossSubsector(bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR);
 }
@@ -224,17 +226,23 @@ static boolean P_CrossBSPNode_PrBoom(int bspnum)
 {
   while (!(bspnum & NF_SUBSECTOR))
     {
-      register const node_t *bsp = nodes + bspnum;
+      register const nodesplit_t *split = nodesplits + bspnum;
+      const unsigned short *children = nodechildren[bspnum].children;
+      divline_t bsp;
       int side,side2;
-      side = P_DivlineSide(los.strace.x,los.strace.y,(const divline_t *)bsp)&1;
-      side2= P_DivlineSide(los.t2x, los.t2y, (const divline_t *) bsp);
+      bsp.x = split->x<<FRACBITS;
+      bsp.y = split->y<<FRACBITS;
+      bsp.dx = split->dx<<FRACBITS;
+      bsp.dy = split->dy<<FRACBITS;
+      side = P_DivlineSide(los.strace.x,los.strace.y,&bsp)&1;
+      side2= P_DivlineSide(los.t2x, los.t2y, &bsp);
       if (side == side2)
-         bspnum = bsp->children[side]; // doesn't touch the other side
+         bspnum = children[side]; // doesn't touch the other side
       else         // the partition plane is crossed here
-        if (!P_CrossBSPNode_PrBoom(bsp->children[side]))
+        if (!P_CrossBSPNode_PrBoom(children[side]))
           return 0;  // cross the starting side
         else
-          bspnum = bsp->children[side^1];  // cross the ending side
+          bspnum = children[side^1];  // cross the ending side
     }
   return P_CrossSubsector(bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR);
 }
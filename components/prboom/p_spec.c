@@ -108,6 +108,19 @@ static anim_t*  lastanim;
 static anim_t*  anims;                // new structure w/o limits -- killough
 static size_t maxanims;
 
+// Animation schedule: the leveltime the translation tables were last brought
+// up to, and the first leveltime at which any animation changes frame
+static int animtic = -2;
+static int nextanimtic;
+
+// Constant scrollers (no control sector) run lazily: their offsets are
+// brought up to leveltime when rendered or saved, not by a thinker every tic
+scroll_t **lazyscrollers;
+int numlazyscrollers;
+static int maxlazyscrollers;
+static int scrolltic;           // leveltime the lazy offsets are up to
+static fixed_t scrollfrac;      // sub-tic part applied for uncapped frames
+
 // killough 3/7/98: Initialize generalized scrolling
 static void P_SpawnScrollers(void);
 
@@ -2321,6 +2334,7 @@ void P_UpdateSpecials (void)
   anim_t*     anim;
   int         pic;
   int         i;
+  boolean     force;
 
   // Downcount level timer, exit level if elapsed
   if (levelTimer == true)
@@ -2353,15 +2367,29 @@ void P_UpdateSpecials (void)
   }
 
   // Animate flats and textures globally
-  for (anim = anims ; anim < lastanim ; anim++)
+  // An animation only changes frame when leveltime reaches a multiple of its
+  // speed, so the tables are rewritten only for the animations due this tic.
+  // Any other step in leveltime (new level, loaded game) rewrites them all.
+  force = leveltime != animtic + 1;
+  animtic = leveltime;
+  if (force || leveltime >= nextanimtic)
   {
-    for (i=anim->basepic ; i<anim->basepic+anim->numpics ; i++)
+    nextanimtic = INT_MAX;
+    for (anim = anims ; anim < lastanim ; anim++)
     {
-      pic = anim->basepic + ( (leveltime/anim->speed + i)%anim->numpics );
-      if (anim->istexture)
-        texturetranslation[i] = pic;
-      else
-        flattranslation[i] = pic;
+      int next = (leveltime/anim->speed + 1) * anim->speed;
+
+      if (force || leveltime % anim->speed == 0)
+        for (i=anim->basepic ; i<anim->basepic+anim->numpics ; i++)
+        {
+          pic = anim->basepic + ( (leveltime/anim->speed + i)%anim->numpics );
+          if (anim->istexture)
+            texturetranslation[i] = pic;
+          else
+            flattranslation[i] = pic;
+        }
+      if (next < nextanimtic)
+        nextanimtic = next;
     }
   }
 
@@ -2692,6 +2720,129 @@ void T_Scroll(scroll_t *s)
     }
 }
 
+//
+// P_UpdateScrollers()
+//
+// Bring the offsets of the lazy scrollers up to leveltime. Each one has
+// moved by (dx,dy) every tic since the offsets were last brought up, which
+// unsigned arithmetic reproduces exactly, wrap included. With frac below
+// FRACUNIT (uncapped frames) they are drawn that far into the last tic, as
+// r_fps.c does for thinkers, until P_RestoreScrollers.
+//
+
+static void P_ShiftScroller(const scroll_t *s, fixed_t dx, fixed_t dy)
+{
+  switch (s->type)
+    {
+      side_t *side;
+      sector_t *sec;
+
+    case sc_side:
+      side = sides + s->affectee;
+      side->textureoffset += dx;
+      side->rowoffset += dy;
+      break;
+
+    case sc_floor:
+      sec = sectors + s->affectee;
+      sec->floor_xoffs += dx;
+      sec->floor_yoffs += dy;
+      break;
+
+    case sc_ceiling:
+      sec = sectors + s->affectee;
+      sec->ceiling_xoffs += dx;
+      sec->ceiling_yoffs += dy;
+      break;
+
+    default:
+      break;
+    }
+}
+
+void P_UpdateScrollers(fixed_t frac)
+{
+  unsigned tics = leveltime - scrolltic;
+  int i;
+
+  if (tics)
+    {
+      for (i = 0; i < numlazyscrollers; i++)
+        {
+          const scroll_t *s = lazyscrollers[i];
+          P_ShiftScroller(s, (fixed_t)((unsigned)s->dx * tics),
+                          (fixed_t)((unsigned)s->dy * tics));
+        }
+      scrolltic = leveltime;
+    }
+
+  if (frac < FRACUNIT && leveltime > 0)
+    {
+      scrollfrac = frac - FRACUNIT;
+      for (i = 0; i < numlazyscrollers; i++)
+        {
+          const scroll_t *s = lazyscrollers[i];
+          P_ShiftScroller(s, FixedMul(s->dx, scrollfrac),
+                          FixedMul(s->dy, scrollfrac));
+        }
+    }
+}
+
+void P_RestoreScrollers(void)
+{
+  int i;
+
+  if (scrollfrac)
+    {
+      for (i = 0; i < numlazyscrollers; i++)
+        {
+          const scroll_t *s = lazyscrollers[i];
+          P_ShiftScroller(s, -FixedMul(s->dx, scrollfrac),
+                          -FixedMul(s->dy, scrollfrac));
+        }
+      scrollfrac = 0;
+    }
+}
+
+//
+// P_AddScroller()
+//
+// Start a scroller, spawned or loaded from a savegame. Constant ones go on
+// the lazy list, the others on the thinker list.
+//
+
+void P_AddScroller(scroll_t *s)
+{
+  if (s->control == -1 && !s->accel &&
+      (s->type == sc_side || s->type == sc_floor || s->type == sc_ceiling))
+    {
+      P_UpdateScrollers(FRACUNIT);     // offsets so far moved at the old set
+      if (numlazyscrollers >= maxlazyscrollers)
+        {
+          maxlazyscrollers = maxlazyscrollers ? maxlazyscrollers*2 : 64;
+          lazyscrollers = realloc(lazyscrollers,
+                                  maxlazyscrollers*sizeof(*lazyscrollers));
+        }
+      lazyscrollers[numlazyscrollers++] = s;
+    }
+  else
+    P_AddThinker(&s->thinker);
+}
+
+//
+// P_ClearScrollers()
+//
+// Drop the lazy scrollers, at level start and before a savegame loads its
+// own. Their memory goes with the level.
+//
+
+void P_ClearScrollers(void)
+{
+  numlazyscrollers = 0;
+  scrolltic = leveltime;
+  scrollfrac = 0;
+}
+
 //
 // Add_Scroller()
 //
@@ -2724,7 +2875,7 @@ static void Add_Scroller(int type, fixed_t dx, fixed_t dy,
     s->last_height =
       sectors[control].floorheight + sectors[control].ceilingheight;
   s->affectee = affectee;
-  P_AddThinker(&s->thinker);
+  P_AddScroller(s);
 }
 
 // Adds wall scroller. Scroll amount is rotated with respect to wall's
@@ -2770,6 +2921,8 @@ static void P_SpawnScrollers(void)
   int i;
   line_t *l = lines;
 
+  P_ClearScrollers();
+
   for (i=0;i<numlines;i++,l++)
     {
       fixed_t dx = l->dx >> SCROLL_SHIFT;  // direction and speed of scrolling
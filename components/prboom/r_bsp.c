@@ -40,7 +40,6 @@
 #include "r_bsp.h" // cph - sanity checking
 #include "v_video.h"
 #include "lprintf.h"
-#include "esp_attr.h"
 
 seg_t     *curline;
 side_t    *sidedef;
@@ -293,7 +292,7 @@ sector_t *R_FakeFlat(sector_t *sec, sector_t *tempsec,
 // and adds any visible pieces to the line list.
 //
 #include "rom/ets_sys.h"
-static void IRAM_ATTR R_AddLine (seg_t *line)
+static void PLACEDFUNC R_AddLine (seg_t *line, const segverts_t *verts)
 { 
   int      x1;
   int      x2;
@@ -305,8 +304,8 @@ static void IRAM_ATTR R_AddLine (seg_t *line)
 
   curline = line;
 
-  angle1 = R_PointToAngle (line->v1->x, line->v1->y);
-  angle2 = R_PointToAngle (line->v2->x, line->v2->y);
+  angle1 = R_PointToAngle (verts->v1.x, verts->v1.y);
+  angle2 = R_PointToAngle (verts->v2.x, verts->v2.y);
 
   // Clip to view edges.
   span = angle1 - angle2;
@@ -315,6 +314,11 @@ static void IRAM_ATTR R_AddLine (seg_t *line)
   if (span >= ANG180)
     return;
 
+  // Minisegs are not drawn; tested only for segs facing the view,
+  // so culled ones never touch the seg itself
+  if (line->miniseg)
+    return;
+
   // Global angle needed by segcalc.
   rw_angle1 = angle1;
   angle1 -= viewangle;
@@ -401,9 +405,15 @@ static const int checkcoord[12][4] = // killough -- static const
 };
 
 // killough 1/28/98: static // CPhipps - const parameter, reformatted
-static boolean R_CheckBBox(const fixed_t *bspcoord)
+static boolean R_CheckBBox(const short *bspbox)
 {
   angle_t angle1, angle2;
+  fixed_t bspcoord[4];
+
+  bspcoord[BOXTOP] = bspbox[BOXTOP]<<FRACBITS;
+  bspcoord[BOXBOTTOM] = bspbox[BOXBOTTOM]<<FRACBITS;
+  bspcoord[BOXLEFT] = bspbox[BOXLEFT]<<FRACBITS;
+  bspcoord[BOXRIGHT] = bspbox[BOXRIGHT]<<FRACBITS;
 
   {
     int        boxpos;
@@ -472,6 +482,7 @@ static void R_Subsector(int num)
 {
   int         count;
   seg_t       *line;
+  const segverts_t *verts;
   subsector_t *sub;
   sector_t    tempsec;              // killough 3/7/98: deep water hack
   int         floorlightlevel;      // killough 3/16/98: set floor lightlevel
@@ -486,6 +497,7 @@ static void R_Subsector(int num)
   frontsector = sub->sector;
   count = sub->numlines;
   line = &segs[sub->firstline];
+  verts = &segverts[sub->firstline];
 
   // killough 3/8/98, 4/4/98: Deep water / fake ceiling effect
   frontsector = R_FakeFlat(frontsector, &tempsec, &floorlightlevel,
@@ -536,9 +548,7 @@ static void R_Subsector(int num)
   R_AddSprites(sub, (floorlightlevel + ceilinglightlevel) / 2);
   while (count--)
   {
-    if (line->miniseg == false)
-      R_AddLine (line);
-    line++;
+    R_AddLine (line++, verts++);
     curline = NULL; /* cph 2001/11/18 - must clear curline now we're done with it, so R_ColourMap doesn't try using it for other things */
   }
 }
@@ -555,19 +565,19 @@ void R_RenderBSPNode(int bspnum)
 {
   while (!(bspnum & NF_SUBSECTOR))  // Found a subsector?
     {
-      const node_t *bsp = &nodes[bspnum];
+      const unsigned short *children = nodechildren[bspnum].children;
 
       // Decide which side the view point is on.
-      int side = R_PointOnSide(viewx, viewy, bsp);
+      int side = R_PointOnSplit(viewx, viewy, &nodesplits[bspnum]);
       // Recursively divide front space.
-      R_RenderBSPNode(bsp->children[side]);
+      R_RenderBSPNode(children[side]);
 
       // Possibly divide back space.
 
-      if (!R_CheckBBox(bsp->bbox[side ^ 1]))
+      if (!R_CheckBBox(nodeboxes[bspnum].bbox[side ^ 1]))
         return;
 
-      bspnum = bsp->children[side ^ 1];
+      bspnum = children[side ^ 1];
     }
   R_Subsector(bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR);
 }
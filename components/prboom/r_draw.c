@@ -88,8 +88,10 @@ typedef enum
 static int    temp_x = 0;
 static int    tempyl[4], tempyh[4];
 static byte           byte_tempbuf[MAX_SCREENHEIGHT * 4];
+#ifndef RENDER_8BPP_POINT
 static unsigned short short_tempbuf[MAX_SCREENHEIGHT * 4];
 static unsigned int   int_tempbuf[MAX_SCREENHEIGHT * 4];
+#endif
 static int    startx = 0;
 static int    temptype = COL_NONE;
 static int    commontop, commonbot;
@@ -228,6 +230,7 @@ void R_ResetColumnBuffer(void)
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuadFuzz8
 #include "r_drawflush.inl"
 
+#ifndef RENDER_8BPP_POINT
 #define R_DRAWCOLUMN_PIPELINE RDC_STANDARD
 #define R_DRAWCOLUMN_PIPELINE_BITS 15
 #define R_FLUSHWHOLE_FUNCNAME R_FlushWhole15
@@ -290,6 +293,7 @@ void R_ResetColumnBuffer(void)
 #define R_FLUSHHEADTAIL_FUNCNAME R_FlushHTFuzz32
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuadFuzz32
 #include "r_drawflush.inl"
+#endif
 
 //
 // R_DrawColumn
@@ -315,6 +319,7 @@ byte *translationtables;
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuad8
 #include "r_drawcolpipeline.inl"
 
+#ifndef RENDER_8BPP_POINT
 #define R_DRAWCOLUMN_PIPELINE_BITS 15
 #define R_DRAWCOLUMN_FUNCNAME_COMPOSITE(postfix) R_DrawColumn15 ## postfix
 #define R_FLUSHWHOLE_FUNCNAME R_FlushWhole15
@@ -335,6 +340,7 @@ byte *translationtables;
 #define R_FLUSHHEADTAIL_FUNCNAME R_FlushHT32
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuad32
 #include "r_drawcolpipeline.inl"
+#endif
 
 #undef R_DRAWCOLUMN_PIPELINE_BASE
 #undef R_DRAWCOLUMN_PIPELINE_TYPE
@@ -361,6 +367,7 @@ byte *translationtables;
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuadTL8
 #include "r_drawcolpipeline.inl"
 
+#ifndef RENDER_8BPP_POINT
 #define R_DRAWCOLUMN_PIPELINE_BITS 15
 #define R_DRAWCOLUMN_FUNCNAME_COMPOSITE(postfix) R_DrawTLColumn15 ## postfix
 #define R_FLUSHWHOLE_FUNCNAME R_FlushWholeTL15
@@ -381,6 +388,7 @@ byte *translationtables;
 #define R_FLUSHHEADTAIL_FUNCNAME R_FlushHTTL32
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuadTL32
 #include "r_drawcolpipeline.inl"
+#endif
 
 #undef R_DRAWCOLUMN_PIPELINE_BASE
 #undef R_DRAWCOLUMN_PIPELINE_TYPE
@@ -405,6 +413,7 @@ byte *translationtables;
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuad8
 #include "r_drawcolpipeline.inl"
 
+#ifndef RENDER_8BPP_POINT
 #define R_DRAWCOLUMN_PIPELINE_BITS 15
 #define R_DRAWCOLUMN_FUNCNAME_COMPOSITE(postfix) R_DrawTranslatedColumn15 ## postfix
 #define R_FLUSHWHOLE_FUNCNAME R_FlushWhole15
@@ -425,6 +434,7 @@ byte *translationtables;
 #define R_FLUSHHEADTAIL_FUNCNAME R_FlushHT32
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuad32
 #include "r_drawcolpipeline.inl"
+#endif
 
 #undef R_DRAWCOLUMN_PIPELINE_BASE
 #undef R_DRAWCOLUMN_PIPELINE_TYPE
@@ -448,6 +458,7 @@ byte *translationtables;
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuadFuzz8
 #include "r_drawcolpipeline.inl"
 
+#ifndef RENDER_8BPP_POINT
 #define R_DRAWCOLUMN_PIPELINE_BITS 15
 #define R_DRAWCOLUMN_FUNCNAME_COMPOSITE(postfix) R_DrawFuzzColumn15 ## postfix
 #define R_FLUSHWHOLE_FUNCNAME R_FlushWholeFuzz15
@@ -468,10 +479,12 @@ byte *translationtables;
 #define R_FLUSHHEADTAIL_FUNCNAME R_FlushHTFuzz32
 #define R_FLUSHQUAD_FUNCNAME R_FlushQuadFuzz32
 #include "r_drawcolpipeline.inl"
+#endif
 
 #undef R_DRAWCOLUMN_PIPELINE_BASE
 #undef R_DRAWCOLUMN_PIPELINE_TYPE
 
+#ifndef RENDER_8BPP_POINT
 static R_DrawColumn_f drawcolumnfuncs[VID_MODEMAX][RDRAW_FILTER_MAXFILTERS][RDRAW_FILTER_MAXFILTERS][RDC_PIPELINE_MAXPIPELINES] = {
   {
     {
@@ -672,6 +685,30 @@ R_DrawColumn_f R_GetDrawColumnFunc(enum column_pipeline_e type,
             type, filter, filterz);
   return result;
 }
+#else
+// Only the point sampled 8 bit columns are built: unfiltered for patches,
+// with depth lighting for the world
+R_DrawColumn_f R_GetDrawColumnFunc(enum column_pipeline_e type,
+                                   enum draw_filter_type_e filter,
+                                   enum draw_filter_type_e filterz) {
+  boolean lit = filterz != RDRAW_FILTER_NONE;
+
+  switch (type) {
+  case RDC_PIPELINE_STANDARD:
+    return lit ? R_DrawColumn8_PointUV_PointZ : R_DrawColumn8_PointUV;
+  case RDC_PIPELINE_TRANSLUCENT:
+    return lit ? R_DrawTLColumn8_PointUV_PointZ : R_DrawTLColumn8_PointUV;
+  case RDC_PIPELINE_TRANSLATED:
+    return lit ? R_DrawTranslatedColumn8_PointUV_PointZ : R_DrawTranslatedColumn8_PointUV;
+  case RDC_PIPELINE_FUZZ:
+    return lit ? R_DrawFuzzColumn8_PointUV_PointZ : R_DrawFuzzColumn8_PointUV;
+  default:
+    I_Error("R_GetDrawColumnFunc: undefined function (%d, %d, %d)",
+            type, filter, filterz);
+    return NULL;
+  }
+}
+#endif
 
 void R_SetDefaultDrawColumnVars(draw_column_vars_t *dcvars) {
   dcvars->x = dcvars->yl = dcvars->yh = dcvars->z = 0;
@@ -749,6 +786,7 @@ void R_InitTranslationTables (void)
 #define R_DRAWSPAN_PIPELINE (RDC_STANDARD)
 #include "r_drawspan.inl"
 
+#ifndef RENDER_8BPP_POINT
 #define R_DRAWSPAN_FUNCNAME R_DrawSpan8_PointUV_LinearZ
 #define R_DRAWSPAN_PIPELINE_BITS 8
 #define R_DRAWSPAN_PIPELINE (RDC_STANDARD | RDC_DITHERZ)
@@ -864,6 +902,9 @@ void R_InitTranslationTables (void)
 #define R_DRAWSPAN_PIPELINE (RDC_STANDARD | RDC_ROUNDED | RDC_DITHERZ)
 #include "r_drawspan.inl"
 
+#endif
+
+#ifndef RENDER_8BPP_POINT
 static R_DrawSpan_f drawspanfuncs[VID_MODEMAX][RDRAW_FILTER_MAXFILTERS][RDRAW_FILTER_MAXFILTERS] = {
   {
     {
@@ -983,6 +1024,16 @@ R_DrawSpan_f R_GetDrawSpanFunc(enum draw_filter_type_e filter,
 void R_DrawSpan(draw_span_vars_t *dsvars) {
   R_GetDrawSpanFunc(drawvars.filterfloor, drawvars.filterz)(dsvars);
 }
+#else
+R_DrawSpan_f R_GetDrawSpanFunc(enum draw_filter_type_e filter,
+                               enum draw_filter_type_e filterz) {
+  return R_DrawSpan8_PointUV_PointZ;
+}
+
+void R_DrawSpan(draw_span_vars_t *dsvars) {
+  R_DrawSpan8_PointUV_PointZ(dsvars);
+}
+#endif
 
 //
 // R_InitBuffer
@@ -1024,6 +1075,16 @@ void R_InitBuffer(int width, int height)
   }
 }
 
+void R_SetDrawTarget(byte *topleft, int pitch)
+{
+  int i;
+
+  drawvars.byte_topleft = topleft;
+  drawvars.byte_pitch = pitch;
+  for (i=0; i<FUZZTABLE; i++)
+    fuzzoffset[i] = fuzzoffset_org[i]*pitch;
+}
+
 //
 // R_FillBackScreen
 // Fills the back screen with a pattern
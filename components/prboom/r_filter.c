@@ -42,9 +42,10 @@ byte *filter_roundedUVMap;
 byte filter_roundedRowMap[4*16];
 
 void R_FilterInit(void) {
+  // Only the rounded drawers read these tables; RENDER_8BPP_POINT drops them
+#ifndef RENDER_8BPP_POINT
   int i,j,s,t;
 
-	
 	filter_roundedUVMap=malloc(FILTER_UVDIM*FILTER_UVDIM);
 
   // scale2x takes the following source:
@@ -95,6 +96,7 @@ void R_FilterInit(void) {
       else filter_roundedUVMap[i*FILTER_UVDIM+j] = 4;
     }
   }
+#endif
 }
 
 byte *filter_getScale2xQuadColors(byte e, byte b, byte f, byte h, byte d) {
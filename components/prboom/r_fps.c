@@ -32,12 +32,16 @@
  *---------------------------------------------------------------------
  */
 
+#include <string.h>
+
 #include "doomstat.h"
 #include "r_defs.h"
 #include "r_state.h"
 #include "p_spec.h"
 #include "r_demo.h"
 #include "r_fps.h"
+#include "perf_clock.h"
+#include "perf_histogram.h"
 
 int movement_smooth = false;
 
@@ -66,9 +70,14 @@ view_vars_t original_view_vars;
 extern int realtic_clock_rate;
 void D_Display(void);
 
+// R_DoInterpolations + R_RestoreInterpolations cost per interpolated frame
+static PERF_HISTOGRAM_ATTR perf_latency_t interpolation_stats;
+static uint32_t interpolation_us;
+
 void R_InitInterpolation(void)
 {
-  tic_vars.msec = realtic_clock_rate * TICRATE / 100000.0f;
+  tic_vars.usec = realtic_clock_rate * TICRATE / 100000000.0f;
+  perf_latency_register(&interpolation_stats, "engine_interpolation");
 }
 
 typedef fixed_t fixed2_t[2];
@@ -76,6 +85,13 @@ static fixed2_t *oldipos;
 static fixed2_t *bakipos;
 static interpolation_t *curipos;
 
+// Hashed index over curipos so movers starting and stopping do not scan the
+// whole list. Buckets hold an entry index or -1, and entries are chained
+// through interpnext. The bucket count tracks interpolations_max.
+static int *interphash;
+static int *interpnext;
+static unsigned int interphash_mask;
+
 static boolean NoInterpolateView;
 static boolean didInterp;
 boolean WasRenderedInTryRunTics;
@@ -231,47 +247,89 @@ void R_UpdateInterpolations()
 
 int interpolations_max = 0;
 
-static void R_SetInterpolation(interpolation_type_e type, void *posptr)
+static int *R_InterpolationBucket(interpolation_type_e type, void *posptr)
+{
+  unsigned int h = ((unsigned int)(uintptr_t)posptr >> 2) * 2654435761u;
+  return &interphash[(h ^ type) & interphash_mask];
+}
+
+// Returns the link (bucket or interpnext slot) that points at entry i
+static int *R_InterpolationLink(int i)
+{
+  int *link = R_InterpolationBucket(curipos[i].type, curipos[i].address);
+  while (*link != i)
+    link = &interpnext[*link];
+  return link;
+}
+
+static void R_GrowInterpolations(void)
 {
   int i;
+
+  interpolations_max = interpolations_max ? interpolations_max * 2 : 256;
+
+  oldipos = (fixed2_t*)realloc(oldipos, sizeof(*oldipos) * interpolations_max);
+  bakipos = (fixed2_t*)realloc(bakipos, sizeof(*bakipos) * interpolations_max);
+  curipos = (interpolation_t*)realloc(curipos, sizeof(*curipos) * interpolations_max);
+  interpnext = (int*)realloc(interpnext, sizeof(*interpnext) * interpolations_max);
+  interphash = (int*)realloc(interphash, sizeof(*interphash) * interpolations_max);
+  interphash_mask = interpolations_max - 1;
+
+  memset(interphash, -1, sizeof(*interphash) * interpolations_max);
+  for (i = 0; i < numinterpolations; i++)
+  {
+    int *bucket = R_InterpolationBucket(curipos[i].type, curipos[i].address);
+    interpnext[i] = *bucket;
+    *bucket = i;
+  }
+}
+
+static void R_SetInterpolation(interpolation_type_e type, void *posptr)
+{
+  int i, *bucket;
   if (!movement_smooth)
     return;
   
-  if (numinterpolations >= interpolations_max) {
-    interpolations_max = interpolations_max ? interpolations_max * 2 : 256;
-    
-    oldipos = (fixed2_t*)realloc(oldipos, sizeof(*oldipos) * interpolations_max);
-    bakipos = (fixed2_t*)realloc(bakipos, sizeof(*bakipos) * interpolations_max);
-    curipos = (interpolation_t*)realloc(curipos, sizeof(*curipos) * interpolations_max);
-  }
+  if (numinterpolations >= interpolations_max)
+    R_GrowInterpolations();
   
-  for(i = numinterpolations-1; i >= 0; i--)
+  bucket = R_InterpolationBucket(type, posptr);
+  for (i = *bucket; i >= 0; i = interpnext[i])
     if (curipos[i].address == posptr && curipos[i].type == type)
       return;
 
-  curipos[numinterpolations].address = posptr;
-  curipos[numinterpolations].type = type;
-  R_CopyInterpToOld (numinterpolations);
-  numinterpolations++;
+  i = numinterpolations++;
+  curipos[i].address = posptr;
+  curipos[i].type = type;
+  interpnext[i] = *bucket;
+  *bucket = i;
+  R_CopyInterpToOld (i);
 } 
 
 static void R_StopInterpolation(interpolation_type_e type, void *posptr)
 {
-  int i;
+  int i, last, *link;
 
-  if (!movement_smooth)
+  if (!movement_smooth || !interpolations_max)
     return;
 
-  for(i=numinterpolations-1; i>= 0; --i)
+  for (link = R_InterpolationBucket(type, posptr); (i = *link) >= 0; link = &interpnext[i])
   {
     if (curipos[i].address == posptr && curipos[i].type == type)
     {
-      numinterpolations--;
-      oldipos[i][0] = oldipos[numinterpolations][0];
-      oldipos[i][1] = oldipos[numinterpolations][1];
-      bakipos[i][0] = bakipos[numinterpolations][0];
-      bakipos[i][1] = bakipos[numinterpolations][1];
-      curipos[i] = curipos[numinterpolations];
+      *link = interpnext[i];
+      last = --numinterpolations;
+      if (i != last)
+      {
+        // Move the last entry into the hole and repoint its chain link
+        *R_InterpolationLink(last) = i;
+        interpnext[i] = interpnext[last];
+        oldipos[i][0] = oldipos[last][0];
+        oldipos[i][1] = oldipos[last][1];
+        bakipos[i][0] = bakipos[last][0];
+        bakipos[i][1] = bakipos[last][1];
+        curipos[i] = curipos[last];
+      }
       break;
     }
   }
@@ -279,25 +337,18 @@ static void R_StopInterpolation(interpolation_type_e type, void *posptr)
 
 void R_StopAllInterpolations(void)
 {
-  int i;
-  
   if (!movement_smooth)
     return;
 
-  for(i=numinterpolations-1; i>= 0; --i)
-  {
-    numinterpolations--;
-    oldipos[i][0] = oldipos[numinterpolations][0];
-    oldipos[i][1] = oldipos[numinterpolations][1];
-    bakipos[i][0] = bakipos[numinterpolations][0];
-    bakipos[i][1] = bakipos[numinterpolations][1];
-    curipos[i] = curipos[numinterpolations];
-  }
+  numinterpolations = 0;
+  if (interphash)
+    memset(interphash, -1, sizeof(*interphash) * interpolations_max);
 }
 
 void R_DoInterpolations(fixed_t smoothratio)
 {
   int i;
+  uint64_t start;
   if (!movement_smooth)
     return;
 
@@ -309,10 +360,12 @@ void R_DoInterpolations(fixed_t smoothratio)
 
   didInterp = true;
 
+  start = perf_now_us();
   for (i = numinterpolations-1; i >= 0; --i)
   {
     R_DoAnInterpolation (i, smoothratio);
   }
+  interpolation_us = (uint32_t)(perf_now_us() - start);
 }
 
 void R_RestoreInterpolations()
@@ -324,11 +377,15 @@ void R_RestoreInterpolations()
 
   if (didInterp)
   {
+    uint64_t start = perf_now_us();
+
     didInterp = false;
     for (i = numinterpolations-1; i >= 0; --i)
     {
       R_CopyBakToInterp (i);
     }
+    interpolation_us += (uint32_t)(perf_now_us() - start);
+    perf_latency_record(&interpolation_stats, interpolation_us);
   }
 }
 
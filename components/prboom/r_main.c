@@ -58,6 +58,11 @@
 #include "g_game.h"
 #include "r_demo.h"
 #include "r_fps.h"
+#include "perf_trace.h"
+#include "p_spec.h"
+#include "perf_counters.h"
+#include "p_setup.h"
+#include "p_maputl.h"
 
 // Fineangles in the SCREENWIDTH wide window.
 #define FIELDOFVIEW 2048
@@ -141,6 +146,26 @@ PUREFUNC int R_PointOnSide(fixed_t x, fixed_t y, const node_t *node)
   return FixedMul(y, node->dx>>FRACBITS) >= FixedMul(node->dy>>FRACBITS, x);
 }
 
+// R_PointOnSide against a node's partition in the BSP walk mirror
+// (r_defs.h), which holds it in map units
+
+PUREFUNC int R_PointOnSplit(fixed_t x, fixed_t y, const nodesplit_t *split)
+{
+  if (!split->dx)
+    return x <= split->x<<FRACBITS ? split->dy > 0 : split->dy < 0;
+
+  if (!split->dy)
+    return y <= split->y<<FRACBITS ? split->dx < 0 : split->dx > 0;
+
+  x -= split->x<<FRACBITS;
+  y -= split->y<<FRACBITS;
+
+  // Try to quickly decide by looking at sign bits.
+  if ((split->dy ^ split->dx ^ x ^ y) < 0)
+    return (split->dy ^ x) < 0;  // (left is negative)
+  return FixedMul(y, split->dx) >= FixedMul(split->dy, x);
+}
+
 // killough 5/2/98: reformatted
 
 PUREFUNC int R_PointOnSegSide(fixed_t x, fixed_t y, const seg_t *line)
@@ -346,6 +371,7 @@ static void R_InitLightTables (void)
 
 boolean setsizeneeded;
 int     setblocks;
+boolean r_spectating;
 
 void R_SetViewSize(int blocks)
 {
@@ -465,10 +491,101 @@ subsector_t *R_PointInSubsector(fixed_t x, fixed_t y)
     return subsectors;
 
   while (!(nodenum & NF_SUBSECTOR))
-    nodenum = nodes[nodenum].children[R_PointOnSide(x, y, nodes+nodenum)];
+    nodenum = nodechildren[nodenum].children[R_PointOnSplit(x, y, nodesplits+nodenum)];
   return &subsectors[nodenum & ~NF_SUBSECTOR];
 }
 
+//
+// R_BenchmarkBSP
+//
+// Times point-in-subsector descents of the loaded level through node_t and
+// through the BSP walk mirror, each pass starting from a cold cache, and logs
+// cycles and the data stall share per descent. Run by P_SetupLevel when
+// bsp_benchmark is set. The points come from a private generator, so demo
+// and net sync are untouched.
+
+int bsp_benchmark;
+
+#define BENCH_DESCENTS 4096
+
+static int R_BenchDescend(fixed_t x, fixed_t y, boolean mirror)
+{
+  int nodenum = numnodes-1;
+
+  if (mirror)
+    while (!(nodenum & NF_SUBSECTOR))
+      nodenum = nodechildren[nodenum].children[R_PointOnSplit(x, y, nodesplits+nodenum)];
+  else
+    while (!(nodenum & NF_SUBSECTOR))
+      nodenum = nodes[nodenum].children[R_PointOnSide(x, y, nodes+nodenum)];
+  return nodenum;
+}
+
+// Read a framebuffer's worth, twice the 32KB cache, one load per line
+static void R_BenchEvictCache(void)
+{
+  const byte *p = screens[0].data;
+  int n = screens[0].byte_pitch * screens[0].height;
+  unsigned sum = 0;
+  volatile unsigned sink;
+
+  if (p)
+    while ((n -= 32) >= 0)
+      sum += p[n];
+  sink = sum;
+  (void)sink;
+}
+
+static unsigned R_BenchPass(boolean mirror, perf_counter_sample_t *cost)
+{
+  unsigned seed = 1, check = 0;
+  unsigned w = bmapwidth*MAPBLOCKUNITS, h = bmapheight*MAPBLOCKUNITS;
+  perf_counter_sample_t start, end;
+  int i;
+
+  R_BenchEvictCache();
+  perf_counters_sample(&start);
+  for (i = 0; i < BENCH_DESCENTS; i++)
+    {
+      fixed_t x, y;
+      seed = seed * 1664525u + 1013904223u;
+      x = bmaporgx + (int)((seed >> 8) % w << FRACBITS);
+      seed = seed * 1664525u + 1013904223u;
+      y = bmaporgy + (int)((seed >> 8) % h << FRACBITS);
+      check += R_BenchDescend(x, y, mirror);
+    }
+  perf_counters_sample(&end);
+  cost->cycles = end.cycles - start.cycles;
+  cost->dstall = end.dstall - start.dstall;
+  cost->istall = end.istall - start.istall;
+  return check;
+}
+
+void R_BenchmarkBSP(void)
+{
+  perf_counter_sample_t full, mirror;
+
+  if (numnodes == 0 || bmapwidth <= 0 || bmapheight <= 0)
+    return;
+  if (!nodes) {
+    // A baked level only has the mirror
+    R_BenchPass(true, &mirror);
+    lprintf(LO_INFO, "R_BenchmarkBSP: %d nodes, %d descents: mirror %u cycles (%u%% dstall) "
+            "per descent, no node_t on a baked level\n", numnodes, BENCH_DESCENTS,
+            (unsigned)(mirror.cycles / BENCH_DESCENTS),
+            mirror.cycles ? (unsigned)((uint64_t)mirror.dstall * 100 / mirror.cycles) : 0);
+    return;
+  }
+  if (R_BenchPass(false, &full) != R_BenchPass(true, &mirror))
+    lprintf(LO_WARN, "R_BenchmarkBSP: mirror descends to different subsectors\n");
+  lprintf(LO_INFO, "R_BenchmarkBSP: %d nodes, %d descents: node_t %u cycles (%u%% dstall), "
+          "mirror %u cycles (%u%% dstall) per descent\n", numnodes, BENCH_DESCENTS,
+          (unsigned)(full.cycles / BENCH_DESCENTS),
+          full.cycles ? (unsigned)((uint64_t)full.dstall * 100 / full.cycles) : 0,
+          (unsigned)(mirror.cycles / BENCH_DESCENTS),
+          mirror.cycles ? (unsigned)((uint64_t)mirror.dstall * 100 / mirror.cycles) : 0);
+}
+
 //
 // R_SetupFrame
 //
@@ -480,21 +597,34 @@ static void R_SetupFrame (player_t *player)
 
   viewplayer = player;
 
-  if (player->mo != oviewer || NoInterpolate)
+  // Spectator views run between main frames at a few fps; they take the
+  // camera as it is and leave the main view's interpolation state alone
+  if (r_spectating)
   {
-    R_ResetViewInterpolation ();
-    oviewer = player->mo;
+    viewx = player->mo->x;
+    viewy = player->mo->y;
+    viewz = player->viewz;
+    viewangle = player->mo->angle;
+  }
+  else
+  {
+    if (player->mo != oviewer || NoInterpolate)
+    {
+      R_ResetViewInterpolation ();
+      oviewer = player->mo;
+    }
+    tic_vars.frac = I_GetTimeFrac ();
+    if (NoInterpolate)
+      tic_vars.frac = FRACUNIT;
+    R_InterpolateView (player, tic_vars.frac);
   }
-  tic_vars.frac = I_GetTimeFrac ();
-  if (NoInterpolate)
-    tic_vars.frac = FRACUNIT;
-  R_InterpolateView (player, tic_vars.frac);
 
   extralight = player->extralight;
 
   viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
   viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
 
+  P_UpdateScrollers(movement_smooth ? tic_vars.frac : FRACUNIT);
   R_DoInterpolations(tic_vars.frac);
 
   // killough 3/20/98, 4/4/98: select colormap based on player status
@@ -574,6 +704,7 @@ static void R_ShowStats(void)
 //
 void R_RenderPlayerView (player_t* player)
 {
+  PERF_TRACE_BEGIN(PERF_TRACE_RENDER_VIEW);
   R_SetupFrame (player);
 
   // Clear buffers.
@@ -587,7 +718,7 @@ void R_RenderPlayerView (player_t* player)
   {
 
   } else {
-    if (autodetect_hom)
+    if (autodetect_hom && !r_spectating)
     { // killough 2/10/98: add flashing red HOM indicators
       unsigned char color=(gametic % 20) < 9 ? 0xb0 : 0;
       V_FillRect(0, viewwindowx, viewwindowy, viewwidth, viewheight, color);
@@ -602,7 +733,9 @@ void R_RenderPlayerView (player_t* player)
 
       // The head node is the last node output.
     {
+    PERF_TRACE_BEGIN(PERF_TRACE_RENDER_BSP);
     R_RenderBSPNode (numnodes-1);
+    PERF_TRACE_END(PERF_TRACE_RENDER_BSP);
   }
   R_ResetColumnBuffer();
 
@@ -611,8 +744,11 @@ void R_RenderPlayerView (player_t* player)
   NetUpdate ();
 #endif
 
-  if (V_GetMode() != VID_MODEGL)
+  if (V_GetMode() != VID_MODEGL) {
+    PERF_TRACE_BEGIN(PERF_TRACE_RENDER_PLANES);
     R_DrawPlanes ();
+    PERF_TRACE_END(PERF_TRACE_RENDER_PLANES);
+  }
 
   // Check for new console commands.
 #ifdef HAVE_NET
@@ -621,7 +757,9 @@ void R_RenderPlayerView (player_t* player)
 
       if (V_GetMode() != VID_MODEGL) {
       {
+      PERF_TRACE_BEGIN(PERF_TRACE_RENDER_MASKED);
       R_DrawMasked ();
+      PERF_TRACE_END(PERF_TRACE_RENDER_MASKED);
     }
     R_ResetColumnBuffer();
   }
@@ -635,7 +773,9 @@ void R_RenderPlayerView (player_t* player)
 
   }
 
-  if (rendering_stats) R_ShowStats();
+  if (rendering_stats && !r_spectating) R_ShowStats();
 
   R_RestoreInterpolations();
+  P_RestoreScrollers();
+  PERF_TRACE_END(PERF_TRACE_RENDER_VIEW);
 }
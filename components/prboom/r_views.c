@@ -0,0 +1,275 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Spectator views: other players, a chase camera or a fixed camera,
+ *      rendered with R_RenderPlayerView into a compact buffer of their own
+ *      after the main frame has gone out.
+ *
+ *      The renderer keeps its view state in globals, so a spectator view
+ *      temporarily switches the view size and draw target, renders, and
+ *      switches back. At most one view is rendered per main frame, each at
+ *      spectator_fps, and only while spectator_budget allows it and the next
+ *      tic is far enough away that the view cannot delay it.
+ *
+ *-----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include "doomstat.h"
+#include "p_map.h"
+#include "r_main.h"
+#include "r_draw.h"
+#include "r_views.h"
+#include "v_video.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "perf_clock.h"
+#include "perf_histogram.h"
+#include "perf_trace.h"
+
+int spectator_fps = 10;
+int spectator_blocks = 5;
+int spectator_budget = 25;
+
+typedef struct {
+  volatile int request;   /* kind << 8 | arg, a single store from any task */
+  uint64_t next_us;       /* when the view is due again */
+} spectator_view_t;
+
+static spectator_view_t views[R_MAX_VIEWS];
+static int next_view;     /* round robin start */
+
+static byte *viewbuf;
+static size_t viewbuf_size;
+
+static int64_t credit_us; /* render time the budget has accrued */
+static uint64_t credit_last_us;
+static spectator_stats_t stats;
+static PERF_HISTOGRAM_ATTR perf_latency_t view_render_stats;
+
+// Chase and fixed cameras render through a stand-in player
+static player_t camplayer;
+static mobj_t camera;
+
+#define CHASE_DIST    (128*FRACUNIT)
+#define CHASE_STEP    (32*FRACUNIT)
+#define CHASE_RAISE   (16*FRACUNIT)  /* above the target's eyes */
+#define CAMERA_CLEAR  (4*FRACUNIT)   /* from floor and ceiling */
+
+void R_SetSpectatorView(int slot, int kind, int arg)
+{
+  if (slot < 0 || slot >= R_MAX_VIEWS || kind < RV_OFF || kind > RV_FIXED)
+    return;
+  views[slot].request = (kind << 8) | (arg & 0xff);
+}
+
+void R_GetSpectatorStats(spectator_stats_t *out)
+{
+  *out = stats;
+}
+
+// Put the camera at x,y, its height clamped into the sector; false if the
+// sector is too low to hold it
+static boolean R_PlaceCamera(fixed_t x, fixed_t y, fixed_t z)
+{
+  const sector_t *sec;
+
+  camera.x = x;
+  camera.y = y;
+  camera.subsector = R_PointInSubsector(x, y);
+  sec = camera.subsector->sector;
+  if (sec->ceilingheight - sec->floorheight < 2*CAMERA_CLEAR)
+    return false;
+  if (z > sec->ceilingheight - CAMERA_CLEAR)
+    z = sec->ceilingheight - CAMERA_CLEAR;
+  if (z < sec->floorheight + CAMERA_CLEAR)
+    z = sec->floorheight + CAMERA_CLEAR;
+  camera.z = z;
+  return true;
+}
+
+// Behind and above the target, pulled in until the target is in sight
+static player_t *R_ChaseCamera(player_t *target)
+{
+  const mobj_t *mo = target->mo;
+  unsigned an = mo->angle >> ANGLETOFINESHIFT;
+  fixed_t dist;
+
+  for (dist = CHASE_DIST; dist > 0; dist -= CHASE_STEP)
+    if (R_PlaceCamera(mo->x - FixedMul(dist, finecosine[an]),
+                      mo->y - FixedMul(dist, finesine[an]),
+                      target->viewz + CHASE_RAISE) &&
+        P_CheckSight(&camera, target->mo))
+      break;
+
+  // Wedged against a wall: fall back to the target's own eyes
+  if (dist <= 0)
+    return target;
+
+  camera.angle = mo->angle;
+  camplayer.mo = &camera;
+  camplayer.viewz = camera.z;
+  camplayer.extralight = target->extralight;
+  camplayer.fixedcolormap = target->fixedcolormap;
+  return &camplayer;
+}
+
+// Eye height over a deathmatch or player start
+static player_t *R_FixedCamera(int spot)
+{
+  const mapthing_t *mt;
+  fixed_t x, y;
+
+  if (spot < (int)num_deathmatchstarts)
+    mt = &deathmatchstarts[spot];
+  else if ((spot -= num_deathmatchstarts) < MAXPLAYERS && playerstarts[spot].type)
+    mt = &playerstarts[spot];
+  else
+    return NULL;
+
+  x = mt->x << FRACBITS;
+  y = mt->y << FRACBITS;
+  if (!R_PlaceCamera(x, y, R_PointInSubsector(x, y)->sector->floorheight + VIEWHEIGHT))
+    return NULL;
+
+  camera.angle = ANG45 * (mt->angle / 45);
+  camplayer.mo = &camera;
+  camplayer.viewz = camera.z;
+  camplayer.extralight = 0;
+  camplayer.fixedcolormap = 0;
+  return &camplayer;
+}
+
+// The player to render a request through, or NULL if there is nothing to show
+static player_t *R_SpectatorViewer(int request)
+{
+  int kind = request >> 8, arg = request & 0xff;
+
+  switch (kind) {
+  case RV_PLAYER:
+  case RV_CHASE:
+    if (arg >= MAXPLAYERS || !playeringame[arg] || !players[arg].mo)
+      return NULL;
+    return kind == RV_PLAYER ? &players[arg] : R_ChaseCamera(&players[arg]);
+  case RV_FIXED:
+    return R_FixedCamera(arg);
+  default:
+    return NULL;
+  }
+}
+
+static void R_RenderSpectatorView(int slot, player_t *viewer)
+{
+  int saved_blocks = setblocks;
+  boolean saved_needed = setsizeneeded;
+  size_t size;
+
+  setblocks = spectator_blocks;
+  R_ExecuteSetViewSize();
+
+  size = (size_t)viewwidth * viewheight;
+  if (size > viewbuf_size) {
+    viewbuf = realloc(viewbuf, size);
+    viewbuf_size = size;
+  }
+  R_SetDrawTarget(viewbuf, viewwidth);
+
+  r_spectating = true;
+  R_RenderPlayerView(viewer);
+  r_spectating = false;
+
+  I_PublishSpectatorView(slot, viewbuf, viewwidth, viewheight);
+
+  setblocks = saved_blocks;
+  R_ExecuteSetViewSize();
+  setsizeneeded = saved_needed;
+}
+
+void R_RenderSpectatorViews(void)
+{
+  static boolean registered;
+  uint64_t now = perf_now_us(), start;
+  int64_t cap;
+  player_t *viewer = NULL;
+  uint32_t took;
+  int i, slot = -1;
+
+  if (!registered) {
+    perf_latency_register(&view_render_stats, "render_spectator_view");
+    registered = true;
+  }
+
+  // Refill the budget; cap it at two views so an idle spell cannot bank a
+  // burst that would eat into the main view
+  credit_us += (int64_t)(now - credit_last_us) * spectator_budget / 100;
+  credit_last_us = now;
+  cap = 2 * (int64_t)(stats.avg_us ? stats.avg_us : 10000);
+  if (credit_us > cap)
+    credit_us = cap;
+
+  if (gamestate != GS_LEVEL || V_GetMode() != VID_MODE8 || spectator_fps <= 0)
+    return;
+
+  for (i = 0; i < R_MAX_VIEWS; i++) {
+    int s = (next_view + i) % R_MAX_VIEWS;
+    if (now < views[s].next_us || !I_SpectatorViewWanted(s))
+      continue;
+    if ((viewer = R_SpectatorViewer(views[s].request)) != NULL) {
+      slot = s;
+      break;
+    }
+  }
+  if (slot < 0)
+    return;
+
+  if (credit_us < (int64_t)stats.avg_us) {
+    stats.skipped_budget++;
+    PERF_TRACE_INSTANT(PERF_TRACE_SPECTATOR_SKIP, 0);
+    return;
+  }
+  if (I_uSecsToNextTic() < stats.avg_us) {
+    stats.skipped_deadline++;
+    PERF_TRACE_INSTANT(PERF_TRACE_SPECTATOR_SKIP, 1);
+    return;
+  }
+
+  PERF_TRACE_BEGIN(PERF_TRACE_RENDER_SPECTATOR);
+  start = perf_now_us();
+  R_RenderSpectatorView(slot, viewer);
+  took = (uint32_t)(perf_now_us() - start);
+  PERF_TRACE_END(PERF_TRACE_RENDER_SPECTATOR);
+
+  perf_latency_record(&view_render_stats, took);
+  // 1/8 weight EWMA, seeded by the first view
+  stats.avg_us = stats.avg_us ? stats.avg_us - (stats.avg_us >> 3) + (took >> 3) : took;
+  stats.rendered++;
+  credit_us -= took;
+  views[slot].next_us = start + 1000000 / spectator_fps;
+  next_view = (slot + 1) % R_MAX_VIEWS;
+}
@@ -374,10 +374,6 @@ void S_UpdateSounds(void* listener_p)
   if (!snd_card || nosfxparm)
     return;
 
-#ifdef UPDATE_MUSIC
-  I_UpdateMusic();
-#endif
-
   for (cnum=0 ; cnum<numChannels ; cnum++)
     {
       sfxinfo_t *sfx;
@@ -419,10 +415,22 @@ void S_UpdateSounds(void* listener_p)
             S_StopChannel(cnum);
         }
     }
+
+  I_UpdateSound();
 }
 
 
 
+//
+// Advances the music sequencer, once per frame
+//
+void S_UpdateMusic(void)
+{
+  if (!mus_card || nomusicparm)
+    return;
+  I_UpdateMusic();
+}
+
 void S_SetMusicVolume(int volume)
 {
   //jff 1/22/98 return if music is not enabled
@@ -134,6 +134,7 @@ static void STlib_drawNum
 #endif
 
   V_CopyRect(x, n->y - ST_Y, BG, w*numdigits, h, x, n->y, FG, VPT_STRETCH);
+  st_changed = true;
 
   // if non-number, do not draw it
   if (num == 1994)
@@ -232,6 +233,7 @@ void STlib_updatePercent
     V_DrawNumPatch(per->n.x, per->n.y, FG, per->p->lumpnum,
        sts_pct_always_gray ? CR_GRAY : cm,
        (sts_always_red ? VPT_NONE : VPT_TRANS) | VPT_STRETCH);
+    st_changed = true;
   }
 
   STlib_updateNum(&per->n, cm, refresh);
@@ -301,6 +303,7 @@ void STlib_updateMultIcon
     if (*mi->inum != -1)  // killough 2/16/98: redraw only if != -1
       V_DrawNumPatch(mi->x, mi->y, FG, mi->p[*mi->inum].lumpnum, CR_DEFAULT, VPT_STRETCH);
     mi->oldinum = *mi->inum;
+    st_changed = true;
   }
 }
 
@@ -370,5 +373,6 @@ void STlib_updateBinIcon
       V_CopyRect(x, y-ST_Y, BG, w, h, x, y, FG, VPT_STRETCH);
 
     bi->oldval = *bi->val;
+    st_changed = true;
   }
 }
@@ -823,6 +823,7 @@ static void ST_doRefresh(void)
 {
 
   st_firsttime = false;
+  st_changed = true;
 
   // draw status bar background to off-screen buff
   ST_refreshBackground();
@@ -838,6 +839,9 @@ static void ST_diffDraw(void)
   ST_drawWidgets(false);
 }
 
+boolean st_layer;
+boolean st_changed;
+
 void ST_Drawer(boolean statusbaron, boolean refresh)
 {
   /* cph - let status bar on be controlled
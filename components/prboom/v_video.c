@@ -44,7 +44,7 @@
 #include "i_video.h"
 #include "r_filter.h"
 #include "lprintf.h"
-#include "esp_attr.h"
+#include "i_videostats.h"
 
 // Each screen is [SCREENWIDTH*SCREENHEIGHT];
 screeninfo_t screens[NUM_SCREENS];
@@ -90,12 +90,16 @@ static const crdef_t crdefs[] = {
   {NULL}
 };
 
+// Lump of each table, for the draw lists
+static int colrng_lumps[CR_LIMIT];
+
 // killough 5/2/98: tiny engine driven by table above
 void V_InitColorTranslation(void)
 {
   register const crdef_t *p;
   for (p=crdefs; p->name; p++) {
     int lump = W_CheckNumForName(p->name);
+    colrng_lumps[p->map - colrngs] = lump;
     if (lump != -1) {
       *p->map = W_CacheLumpName(p->name);
     } else {
@@ -262,7 +266,7 @@ void V_Init (void)
 // (indeed, laziness of the people who wrote the 'clones' of the original V_DrawPatch
 //  means that their inner loops weren't so well optimised, so merging code may even speed them).
 //
-static void IRAM_ATTR V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
+static void PLACEDFUNC V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
         int cm, enum patch_translation_e flags)
 {
   const byte *trans;
@@ -703,6 +707,7 @@ static void V_FillRect8(int scrn, int x, int y, int width, int height, byte colo
   }
 }
 
+#ifndef RENDER_8BPP_POINT
 static void V_FillRect15(int scrn, int x, int y, int width, int height, byte colour)
 {
   unsigned short* dest = (unsigned short *)screens[scrn].data + x + y*screens[scrn].short_pitch;
@@ -741,12 +746,15 @@ static void V_FillRect32(int scrn, int x, int y, int width, int height, byte col
     dest += screens[scrn].int_pitch;
   }
 }
+#endif
 
 static void WRAP_V_DrawLine(fline_t* fl, int color);
 static void V_PlotPixel8(int scrn, int x, int y, byte color);
+#ifndef RENDER_8BPP_POINT
 static void V_PlotPixel15(int scrn, int x, int y, byte color);
 static void V_PlotPixel16(int scrn, int x, int y, byte color);
 static void V_PlotPixel32(int scrn, int x, int y, byte color);
+#endif
 
 static void NULL_FillRect(int scrn, int x, int y, int width, int height, byte colour) {}
 static void NULL_CopyRect(int srcx, int srcy, int srcscrn, int width, int height, int destx, int desty, int destscrn, enum patch_translation_e flags) {}
@@ -766,6 +774,230 @@ V_DrawBackground_f V_DrawBackground = NULL_DrawBackground;
 V_PlotPixel_f V_PlotPixel = NULL_PlotPixel;
 V_DrawLine_f V_DrawLine = NULL_DrawLine;
 
+//
+// Draw lists
+//
+// Overlays (the HUD, menus, the pause sign, intermission screens) are text
+// and graphics drawn with V_DrawNumPatch. Between V_RecordPatches(true) and
+// (false), patches bound for screen 0 are not drawn but kept as commands:
+// lump, position, translation lump and flags. V_FlushDrawList hands the
+// list to the platform with the frame, and the client draws it from patches
+// it fetched and cached, so an overlay costs 9 bytes a patch and leaves the
+// frame itself unchanged.
+//
+// Anything the list cannot say sends the frame back to raster: a raster op
+// on screen 0 once commands are kept (it would have to go over them), a
+// player translation, a full list, or a list the platform refused. The kept
+// commands are then drawn into the frame in order, and the rest of the frame
+// is drawn as usual.
+//
+
+int draw_lists = 1;
+
+#define VDL_MAX_CMDS  200
+#define VDL_HEADER    3   /* type, count(2) */
+#define VDL_CMD_SIZE  9
+#define VDL_NO_TRANS  0xffff
+
+typedef struct {
+  short lump, x, y;
+  byte cm, flags;
+} vdl_cmd_t;
+
+static struct {
+  boolean recording;
+  boolean raster;       /* fell back this frame */
+  int listeners;        /* at the last flush */
+  int count;
+  vdl_cmd_t cmds[VDL_MAX_CMDS];
+  int shown_count;      /* commands the client is drawing, -1 unknown */
+  vdl_cmd_t shown[VDL_MAX_CMDS];
+  byte msg[VDL_HEADER + VDL_MAX_CMDS*VDL_CMD_SIZE];
+} vdl;
+
+static drawlist_stats_t vdl_stats;
+
+void V_GetDrawListStats(drawlist_stats_t *stats)
+{
+  *stats = vdl_stats;
+}
+
+static void V_DrawListCommands(int scrn, const vdl_cmd_t *cmds, int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    FUNC_V_DrawNumPatch(cmds[i].x, cmds[i].y, scrn, cmds[i].lump,
+                        cmds[i].cm, cmds[i].flags);
+}
+
+// Raster from here on: draw what was kept into the frame
+static void V_DrawListFallback(void)
+{
+  V_DrawListCommands(0, vdl.cmds, vdl.count);
+  vdl.count = 0;
+  vdl.recording = false;
+  if (!vdl.raster)
+    vdl_stats.fallbacks++;
+  vdl.raster = true;
+}
+
+void V_RecordPatches(boolean on)
+{
+  vdl.recording = on && draw_lists && vdl.listeners > 0 && !vdl.raster &&
+    V_GetMode() == VID_MODE8;
+}
+
+static void VDL_DrawNumPatch(int x, int y, int scrn, int lump,
+         int cm, enum patch_translation_e flags)
+{
+  vdl_cmd_t *c;
+
+  if (!vdl.recording || scrn != 0) {
+    FUNC_V_DrawNumPatch(x, y, scrn, lump, cm, flags);
+    return;
+  }
+  if ((flags & VPT_TRANS) && cm >= CR_LIMIT) {
+    V_DrawListFallback();
+    FUNC_V_DrawNumPatch(x, y, scrn, lump, cm, flags);
+    return;
+  }
+  if (vdl.count == VDL_MAX_CMDS) {
+    V_DrawListFallback();
+    FUNC_V_DrawNumPatch(x, y, scrn, lump, cm, flags);
+    return;
+  }
+  c = &vdl.cmds[vdl.count++];
+  c->lump = lump;
+  c->x = x;
+  c->y = y;
+  c->cm = cm;
+  c->flags = flags;
+}
+
+// Raster ops go over the kept commands
+static void VDL_CopyRect(int srcx, int srcy, int srcscrn, int width,
+                int height, int destx, int desty, int destscrn,
+                enum patch_translation_e flags)
+{
+  if (vdl.count && destscrn == 0)
+    V_DrawListFallback();
+  FUNC_V_CopyRect(srcx, srcy, srcscrn, width, height, destx, desty, destscrn, flags);
+}
+
+static void VDL_FillRect(int scrn, int x, int y, int width, int height, byte colour)
+{
+  if (vdl.count && scrn == 0)
+    V_DrawListFallback();
+  V_FillRect8(scrn, x, y, width, height, colour);
+}
+
+static void VDL_DrawBackground(const char *flatname, int scrn)
+{
+  if (vdl.count && scrn == 0)
+    V_DrawListFallback();
+  FUNC_V_DrawBackground(flatname, scrn);
+}
+
+static void VDL_PlotPixel(int scrn, int x, int y, byte color)
+{
+  if (vdl.count && scrn == 0)
+    V_DrawListFallback();
+  V_PlotPixel8(scrn, x, y, color);
+}
+
+static byte *V_DrawListPut16(byte *p, int v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  return p + 2;
+}
+
+// [type, count(2)] then count x (lump(2), x(2), y(2), translation lump(2),
+// flags), positions as passed to V_DrawNumPatch
+static int V_DrawListMessage(void)
+{
+  byte *p = vdl.msg + 1;
+  int i;
+
+  p = V_DrawListPut16(p, vdl.count);
+  for (i = 0; i < vdl.count; i++) {
+    const vdl_cmd_t *c = &vdl.cmds[i];
+    int trans = VDL_NO_TRANS, flags = c->flags;
+
+    if ((flags & VPT_TRANS) && colrngs[c->cm])
+      trans = colrng_lumps[c->cm];
+    else
+      flags &= ~VPT_TRANS;
+    p = V_DrawListPut16(p, c->lump);
+    p = V_DrawListPut16(p, c->x);
+    p = V_DrawListPut16(p, c->y);
+    p = V_DrawListPut16(p, trans);
+    *p++ = flags;
+  }
+  return p - vdl.msg;
+}
+
+//
+// V_FlushDrawList
+//
+// Called once per frame, just before I_FinishUpdate. Hands the list to the
+// platform to go out with that frame, unless the client already draws the
+// same one; a list the platform refuses goes into the frame instead, and
+// the next one is sent whatever it holds.
+//
+void V_FlushDrawList(void)
+{
+  int listeners = I_DrawListListeners();
+  int len;
+
+  vdl.recording = false;
+  vdl.raster = false;
+  if (listeners > vdl.listeners)
+    vdl.shown_count = -1;   // somebody new: they have no list yet
+  vdl.listeners = listeners;
+  if (!listeners) {
+    vdl.count = 0;
+    vdl.shown_count = 0;
+    return;
+  }
+
+  if (vdl.count == vdl.shown_count &&
+      !memcmp(vdl.cmds, vdl.shown, vdl.count * sizeof(*vdl.cmds))) {
+    if (vdl.count)
+      vdl_stats.repeats++;
+    vdl.count = 0;
+    return;
+  }
+
+  len = V_DrawListMessage();
+  if (I_SendDrawList(vdl.msg, len)) {
+    memcpy(vdl.shown, vdl.cmds, vdl.count * sizeof(*vdl.cmds));
+    vdl.shown_count = vdl.count;
+    vdl_stats.lists++;
+    vdl_stats.commands += vdl.count;
+    vdl_stats.bytes += len;
+  } else {
+    V_DrawListCommands(0, vdl.cmds, vdl.count);
+    vdl.shown_count = -1;
+    if (vdl.count)
+      vdl_stats.fallbacks++;
+  }
+  vdl.count = 0;
+}
+
+//
+// V_DrawListRaster
+//
+// Draws the list the client was last sent into scrn, for a copy of the frame
+// that has to look as it did on the client (the start of a wipe).
+//
+void V_DrawListRaster(int scrn)
+{
+  if (vdl.shown_count > 0)
+    V_DrawListCommands(scrn, vdl.shown, vdl.shown_count);
+}
+
 //
 // V_InitMode
 //
@@ -776,14 +1008,15 @@ void V_InitMode(video_mode_t mode) {
 	default:
     case VID_MODE8:
       lprintf(LO_INFO, "V_InitMode: using 8 bit video mode\n");
-      V_CopyRect = FUNC_V_CopyRect;
-      V_FillRect = V_FillRect8;
-      V_DrawNumPatch = FUNC_V_DrawNumPatch;
-      V_DrawBackground = FUNC_V_DrawBackground;
-      V_PlotPixel = V_PlotPixel8;
+      V_CopyRect = VDL_CopyRect;
+      V_FillRect = VDL_FillRect;
+      V_DrawNumPatch = VDL_DrawNumPatch;
+      V_DrawBackground = VDL_DrawBackground;
+      V_PlotPixel = VDL_PlotPixel;
       V_DrawLine = WRAP_V_DrawLine;
       current_videomode = VID_MODE8;
       break;
+#ifndef RENDER_8BPP_POINT
     case VID_MODE15:
       lprintf(LO_INFO, "V_InitMode: using 15 bit video mode\n");
       V_CopyRect = FUNC_V_CopyRect;
@@ -814,6 +1047,7 @@ void V_InitMode(video_mode_t mode) {
       V_DrawLine = WRAP_V_DrawLine;
       current_videomode = VID_MODE32;
       break;
+#endif
   }
   R_FilterInit();
 }
@@ -821,7 +1055,7 @@ void V_InitMode(video_mode_t mode) {
 //
 // V_GetMode
 //
-video_mode_t V_GetMode(void) {
+video_mode_t (V_GetMode)(void) {
   return current_videomode;
 }
 
@@ -841,7 +1075,7 @@ int V_GetModePixelDepth(video_mode_t mode) {
 //
 // V_GetNumPixelBits
 //
-int V_GetNumPixelBits(void) {
+int (V_GetNumPixelBits)(void) {
   switch (current_videomode) {
     case VID_MODE8: return 8;
     case VID_MODE15: return 15;
@@ -854,7 +1088,7 @@ int V_GetNumPixelBits(void) {
 //
 // V_GetPixelDepth
 //
-int V_GetPixelDepth(void) {
+int (V_GetPixelDepth)(void) {
   return V_GetModePixelDepth(current_videomode);
 }
 
@@ -901,6 +1135,7 @@ static void V_PlotPixel8(int scrn, int x, int y, byte color) {
   screens[scrn].data[x+screens[scrn].byte_pitch*y] = color;
 }
 
+#ifndef RENDER_8BPP_POINT
 static void V_PlotPixel15(int scrn, int x, int y, byte color) {
   ((unsigned short *)screens[scrn].data)[x+screens[scrn].short_pitch*y] = VID_PAL15(color, VID_COLORWEIGHTMASK);
 }
@@ -912,6 +1147,7 @@ static void V_PlotPixel16(int scrn, int x, int y, byte color) {
 static void V_PlotPixel32(int scrn, int x, int y, byte color) {
   ((unsigned int *)screens[scrn].data)[x+screens[scrn].int_pitch*y] = VID_PAL32(color, VID_COLORWEIGHTMASK);
 }
+#endif
 
 //
 // WRAP_V_DrawLine()
@@ -49,8 +49,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
 
 #include "z_zone.h"
+#include "z_stats.h"
 #include "doomstat.h"
 #include "m_argv.h"
 #include "v_video.h"
@@ -96,6 +98,7 @@ typedef struct memblock {
   size_t size;
   void **user;
   unsigned char tag;
+  unsigned char region;       // Z_REGION_*, for the always-on accounting
 
 #ifdef INSTRUMENTED
   const char *file;
@@ -116,6 +119,108 @@ static memblock_t *blockbytag[PU_MAX];
 static int memory_size = 0;
 static int free_memory = 0;
 
+// Always-on per-tag/per-region accounting (see z_stats.h). Only the engine
+// task allocates, so plain counters suffice; readers take a racy snapshot.
+typedef char z_stats_tags_fit[PU_MAX <= Z_STATS_MAX_TAGS ? 1 : -1];
+
+static zone_usage_t zone_usage[PU_MAX][Z_REGION_MAX];
+static size_t zone_total_bytes;
+static size_t zone_peak_total_bytes;
+static unsigned zone_levels_started;
+static zone_level_stats_t zone_levels[Z_STATS_LEVEL_HISTORY];
+
+static const char *const zone_tag_names[PU_MAX] = {
+  "free", "static", "sound", "music", "level", "levspec", "cache"
+};
+
+static const char *const zone_region_names[Z_REGION_MAX] = {
+  "internal", "psram"
+};
+
+static zone_level_stats_t *Z_CurrentLevel(void)
+{
+  return &zone_levels[(zone_levels_started + Z_STATS_LEVEL_HISTORY - 1) % Z_STATS_LEVEL_HISTORY];
+}
+
+static size_t Z_TagBytes(int tag)
+{
+  size_t bytes = 0;
+  int region;
+  for (region = 0; region < Z_REGION_MAX; region++)
+    bytes += zone_usage[tag][region].bytes;
+  return bytes;
+}
+
+static void Z_AccountAdd(const memblock_t *block, int tag)
+{
+  zone_usage_t *u = &zone_usage[tag][block->region];
+  u->bytes += block->size;
+  u->blocks++;
+  zone_total_bytes += block->size;
+  if (zone_total_bytes > zone_peak_total_bytes)
+    zone_peak_total_bytes = zone_total_bytes;
+
+  if (zone_levels_started)
+  {
+    zone_level_stats_t *level = Z_CurrentLevel();
+    size_t tag_bytes = Z_TagBytes(tag);
+    if (zone_total_bytes > level->peak_total_bytes)
+      level->peak_total_bytes = zone_total_bytes;
+    if (tag_bytes > level->peak_tag_bytes[tag])
+      level->peak_tag_bytes[tag] = tag_bytes;
+  }
+}
+
+static void Z_AccountRemove(const memblock_t *block, int tag)
+{
+  zone_usage_t *u = &zone_usage[tag][block->region];
+  u->bytes -= block->size;
+  u->blocks--;
+  zone_total_bytes -= block->size;
+}
+
+void Z_MarkLevel(int episode, int map)
+{
+  zone_level_stats_t *level;
+  int tag;
+
+  zone_levels_started++;
+  level = Z_CurrentLevel();
+  memset(level, 0, sizeof(*level));
+  level->episode = episode;
+  level->map = map;
+  level->static_bytes_at_start = Z_TagBytes(PU_STATIC);
+  level->peak_total_bytes = zone_total_bytes;
+  for (tag = 0; tag < PU_MAX; tag++)
+    level->peak_tag_bytes[tag] = Z_TagBytes(tag);
+}
+
+void Z_GetStats(zone_stats_t *out)
+{
+  unsigned started = zone_levels_started;
+  int i;
+
+  memset(out, 0, sizeof(*out));
+  out->tag_count = PU_MAX;
+  memcpy(out->usage, zone_usage, sizeof(zone_usage));
+  out->total_bytes = zone_total_bytes;
+  out->peak_total_bytes = zone_peak_total_bytes;
+  out->levels_started = started;
+  out->level_count = started < Z_STATS_LEVEL_HISTORY ? (int)started : Z_STATS_LEVEL_HISTORY;
+  for (i = 0; i < out->level_count; i++)
+    out->levels[i] = zone_levels[(started - out->level_count + i) % Z_STATS_LEVEL_HISTORY];
+}
+
+const char *Z_TagName(int tag)
+{
+  return tag >= 0 && tag < PU_MAX ? zone_tag_names[tag] : "?";
+}
+
+const char *Z_RegionName(int region)
+{
+  return region >= 0 && region < Z_REGION_MAX ? zone_region_names[region] : "?";
+}
+
 #ifdef INSTRUMENTED
 
 // statistics for evaluating performance
@@ -381,6 +486,8 @@ void *(Z_Malloc)(size_t size, int tag, void **user
   }
     
   block->size = size;
+  block->region = esp_ptr_external_ram(block) ? Z_REGION_PSRAM : Z_REGION_INTERNAL;
+  Z_AccountAdd(block, tag);
 
 #ifdef INSTRUMENTED
   if (tag >= PU_PURGELEVEL)
@@ -458,6 +565,7 @@ void (Z_Free)(void *p
   block->next->prev = block->prev;
 
   free_memory += block->size;
+  Z_AccountRemove(block, block->tag);
 #ifdef INSTRUMENTED
   if (block->tag >= PU_PURGELEVEL)
     purgable_memory -= block->size;
@@ -580,6 +688,9 @@ void (Z_ChangeTag)(void *ptr, int tag
     blockbytag[tag]->prev = block;
   }
 
+  Z_AccountRemove(block, block->tag);
+  Z_AccountAdd(block, tag);
+
 #ifdef INSTRUMENTED
   if (block->tag < PU_PURGELEVEL && tag >= PU_PURGELEVEL)
   {
@@ -2,6 +2,11 @@
 #include "esp_log.h"
 #include "esp_spiffs.h"
 #include "esp_heap_caps.h"
+#include "perf_trace.h"
+#include "perf_profiler.h"
+#include "instrumentation.h"
+#include "i_soundstats.h"
+#include "i_videostats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -111,6 +116,121 @@ esp_err_t http_palette_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// Stream one chunk of the trace export into the HTTP response
+static int http_trace_write(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK ? 0 : -1;
+}
+
+// Download the frame-timeline trace as Chrome trace JSON
+esp_err_t http_trace_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"doom-trace.json\"");
+    if (perf_trace_export_json(http_trace_write, req) != 0) {
+        ESP_LOGE(TAG, "Trace export failed");
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Stream one chunk of the metrics export into the HTTP response
+static int http_metrics_write(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK ? 0 : -1;
+}
+
+// Prometheus text exposition of all instrumentation counters
+esp_err_t http_metrics_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    if (instrumentation_write_metrics(http_metrics_write, req) != ESP_OK) {
+        ESP_LOGE(TAG, "Metrics export failed");
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Stream one chunk of the profile download into the HTTP response
+static int http_profile_write(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK ? 0 : -1;
+}
+
+// Sampling profiler control and download.
+// ?cmd=start[&hz=N] and ?cmd=stop control sampling; no command drains the
+// sample ring as a binary profile for tools/profile_fold.py
+esp_err_t http_profile_handler(httpd_req_t *req) {
+    char query[64];
+    char cmd[16] = "";
+    char hz[12] = "";
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        httpd_query_key_value(query, "cmd", cmd, sizeof(cmd));
+        httpd_query_key_value(query, "hz", hz, sizeof(hz));
+    }
+
+    if (strcmp(cmd, "start") == 0) {
+        if (perf_profiler_start((uint32_t)strtoul(hz, NULL, 10)) != 0) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Profiler failed to start");
+            return ESP_OK;
+        }
+        httpd_resp_sendstr(req, "started\n");
+        return ESP_OK;
+    }
+    if (strcmp(cmd, "stop") == 0) {
+        perf_profiler_stop();
+        httpd_resp_sendstr(req, "stopped\n");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"doom.prof\"");
+    if (perf_profiler_read(http_profile_write, req) != 0) {
+        ESP_LOGE(TAG, "Profile download failed");
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Raw DMX sound lump by sfx number, for the browser-side sound backend.
+// Lumps come straight from the memory-mapped WAD and never change.
+esp_err_t http_sfx_handler(httpd_req_t *req) {
+    char query[32];
+    char id[8] = "";
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        httpd_query_key_value(query, "id", id, sizeof(id));
+    }
+
+    int len = 0;
+    const void *lump = I_GetSfxLump(atoi(id), &len);
+    if (!lump) {
+        httpd_resp_send_404(req);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "max-age=86400");
+    httpd_resp_send(req, lump, len);
+    return ESP_OK;
+}
+
+// Raw lump by number, for the patches and translation tables that draw lists
+// refer to. Same source and lifetime as the sfx lumps.
+esp_err_t http_lump_handler(httpd_req_t *req) {
+    char query[32];
+    char num[8] = "";
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        httpd_query_key_value(query, "num", num, sizeof(num));
+    }
+
+    int len = 0;
+    const void *lump = num[0] ? I_GetLump(atoi(num), &len) : NULL;
+    if (!lump) {
+        httpd_resp_send_404(req);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "max-age=86400");
+    httpd_resp_send(req, lump, len);
+    return ESP_OK;
+}
+
 esp_err_t http_ws_handler(httpd_req_t *req) {
     // This is a placeholder - actual WebSocket handling is done in websocket_server.c
     httpd_resp_send_404(req);
@@ -19,6 +19,11 @@ typedef struct {
 esp_err_t http_index_handler(httpd_req_t *req);
 esp_err_t http_palette_handler(httpd_req_t *req);
 esp_err_t http_ws_handler(httpd_req_t *req);
+esp_err_t http_trace_handler(httpd_req_t *req);
+esp_err_t http_metrics_handler(httpd_req_t *req);
+esp_err_t http_profile_handler(httpd_req_t *req);
+esp_err_t http_sfx_handler(httpd_req_t *req);
+esp_err_t http_lump_handler(httpd_req_t *req);
 
 // Static file management
 esp_err_t http_load_static_files(void);
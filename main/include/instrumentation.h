@@ -6,6 +6,7 @@
 #include "freertos/task.h"
 #include "esp_psram.h"
 #include "esp_wifi.h"
+#include "perf_counters.h"
 
 // Configuration
 #define INSTRUMENTATION_TASK_STACK_SIZE 4096
@@ -18,22 +19,54 @@
 // Lightweight mode - reduce stack usage
 #define INSTRUMENTATION_LIGHTWEIGHT_MODE 1  // Use compact logging and smaller buffers
 
+// Periodic serial report; stats are still collected for /metrics when disabled
+#define INSTRUMENTATION_SERIAL_LOGGING 1
+
+// Hot-path counters are padded to the ESP32 cache line so per-core slots never share one
+#define INSTRUMENTATION_CACHE_LINE_SIZE 32
+
 // CPU usage tracking configuration
 #define MAX_TASKS_TO_TRACK 16
 #define CPU_USAGE_HISTORY_SIZE 10
 
+// Hardware counter deltas for one engine phase over the last period
+typedef struct {
+    uint32_t count;                 // phase executions (tics, frames, sends)
+    uint32_t busy_us;               // time spent inside the phase
+    uint32_t dstall_percent;        // share of phase cycles stalled on data memory (PSRAM)
+    uint32_t istall_percent;        // share of phase cycles stalled on instruction fetch (flash)
+    uint32_t cache_misses;          // data stall cycles / measured miss latency
+} phase_counter_stats_t;
+
 // PSRAM bandwidth tracking
 typedef struct {
     uint32_t read_operations;
     uint32_t write_operations;
     uint32_t bytes_read;
     uint32_t bytes_written;
-    uint32_t cache_hits;
-    uint32_t cache_misses;
-    uint32_t bandwidth_utilization_percent;
+    uint32_t cache_misses;                  // all phases, derived from measured stall cycles
+    uint32_t bandwidth_utilization_percent; // data stall cycles / period cycles, both cores
+    uint32_t bytes_percent_of_peak;         // reported bytes against the measured peak
     uint32_t last_reset_time;
+    phase_counter_stats_t phases[PERF_PHASE_COUNT];
 } psram_bandwidth_stats_t;
 
+// Per-core PSRAM hot-path counters (monotonic, lock-free)
+typedef struct {
+    uint32_t read_operations;
+    uint32_t write_operations;
+    uint32_t bytes_read;
+    uint32_t bytes_written;
+} __attribute__((aligned(INSTRUMENTATION_CACHE_LINE_SIZE))) psram_core_counters_t;
+
+// Per-core network hot-path counters (monotonic, lock-free)
+typedef struct {
+    uint32_t bytes_sent;
+    uint32_t bytes_received;
+    uint32_t packets_sent;
+    uint32_t packets_received;
+} __attribute__((aligned(INSTRUMENTATION_CACHE_LINE_SIZE))) network_core_counters_t;
+
 // CPU usage per task tracking
 typedef struct {
     char task_name[configMAX_TASK_NAME_LEN];
@@ -87,6 +120,18 @@ typedef struct {
     uint8_t wifi_phy_mode;
 } wifi_throughput_stats_t;
 
+// Sound mixer load over the last period (see i_sound.c)
+typedef struct {
+    uint32_t mixer_cpu_permille;    // share of one core spent mixing and encoding
+    uint32_t bytes_per_sec;         // encoded audio queued on the game socket
+    uint32_t blocks;                // blocks queued since boot
+    uint32_t blocks_dropped;        // blocks the socket queue refused since boot
+    uint32_t voices;                // voices playing in the last block
+    uint32_t music_bytes_per_sec;   // music sequencer events queued on the game socket
+    uint32_t music_events;          // sequencer events queued since boot
+    uint32_t last_reset_time;
+} audio_stats_t;
+
 // Memory usage tracking
 typedef struct {
     size_t free_internal_ram;
@@ -112,10 +157,38 @@ typedef struct {
     network_throughput_stats_t network_stats;
     wifi_throughput_stats_t wifi_stats;
     memory_stats_t memory_stats;
+    audio_stats_t audio_stats;
     uint32_t total_cpu_usage_percent;
     uint32_t system_uptime_ms;
 } system_stats_t;
 
+// Live stats packet streamed on the game WebSocket (little-endian, packed).
+// Bump INSTRUMENTATION_STATS_VERSION whenever the layout changes.
+#define INSTRUMENTATION_STATS_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t total_cpu_percent;
+    int8_t wifi_rssi;
+    uint8_t psram_bandwidth_percent;
+    uint32_t uptime_ms;
+    uint32_t free_internal_ram;
+    uint32_t min_free_internal_ram;
+    uint32_t free_psram;
+    uint32_t net_bytes_per_sec_sent;
+    uint32_t net_bytes_per_sec_received;
+    uint16_t fps_x10;
+    uint32_t frame_time_p50_us;
+    uint32_t frame_time_p99_us;
+    uint32_t tic_time_p50_us;
+    uint32_t tic_time_p99_us;
+    uint32_t send_p50_us;
+    uint32_t send_p99_us;
+} instrumentation_stats_packet_t;
+
+// Sink for the metrics exporter. Returns 0 on success, non-zero aborts.
+typedef int (*instrumentation_write_fn)(void *ctx, const char *data, size_t len);
+
 // Function declarations
 esp_err_t instrumentation_init(void);
 void instrumentation_start(void);
@@ -143,18 +216,30 @@ esp_err_t instrumentation_log_task_stats(void);
 // Configuration logging
 void instrumentation_log_configuration(void);
 
+// Serial report on/off (defaults to INSTRUMENTATION_SERIAL_LOGGING)
+void instrumentation_set_serial_logging(bool enabled);
+bool instrumentation_get_serial_logging(void);
+
+// Export all counters in Prometheus text exposition format
+esp_err_t instrumentation_write_metrics(instrumentation_write_fn write, void *ctx);
+
+// Fill buf with an instrumentation_stats_packet_t, returns bytes written (0 if too small)
+size_t instrumentation_build_stats_packet(uint8_t *buf, size_t len);
+
 // New comprehensive instrumentation functions
 esp_err_t instrumentation_get_cpu_usage_per_task(cpu_task_stats_t *stats, uint32_t *count);
 esp_err_t instrumentation_get_psram_bandwidth_stats(psram_bandwidth_stats_t *stats);
 esp_err_t instrumentation_get_network_throughput_stats(network_throughput_stats_t *stats);
+esp_err_t instrumentation_get_audio_stats(audio_stats_t *stats);
 esp_err_t instrumentation_get_comprehensive_stats(system_stats_t *stats);
 void instrumentation_log_comprehensive_stats(void);
 
 // PSRAM bandwidth tracking
 void instrumentation_psram_read_operation(uint32_t bytes);
 void instrumentation_psram_write_operation(uint32_t bytes);
-void instrumentation_psram_cache_hit(void);
-void instrumentation_psram_cache_miss(void);
+
+// Measured PSRAM characteristics from boot calibration
+const perf_psram_calibration_t *instrumentation_get_psram_calibration(void);
 
 // Network throughput tracking
 void instrumentation_network_sent_bytes(uint32_t bytes);
@@ -9,7 +9,7 @@ extern "C" {
 
 // Server integration configuration
 #define HTTP_SERVER_PORT 80
-#define HTTP_SERVER_MAX_URI_HANDLERS 8
+#define HTTP_SERVER_MAX_URI_HANDLERS 12
 
 // Function declarations
 esp_err_t server_integration_init(void);
@@ -11,12 +11,22 @@
 #include "freertos/timers.h"
 #include "freertos/semphr.h"
 #include "sdkconfig.h"
+#include "perf_histogram.h"
+#include "z_stats.h"
+#include "i_soundstats.h"
+#include "i_videostats.h"
+#include "r_views.h"
+#include "websocket_server.h"
 #include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 static const char *TAG = "Instrumentation";
 
 // Global state
 static bool instrumentation_running = false;
+static volatile bool serial_logging_enabled = INSTRUMENTATION_SERIAL_LOGGING;
 static TaskHandle_t instrumentation_task_handle = NULL;
 static TimerHandle_t instrumentation_timer = NULL;
 
@@ -31,14 +41,66 @@ static uint32_t cpu_stats_count = 0;
 static SemaphoreHandle_t cpu_stats_mutex = NULL;
 static uint32_t last_cpu_stats_time = 0;
 
-// PSRAM bandwidth tracking (protected by mutex)
+// PSRAM bandwidth period stats (protected by mutex, reader side only)
 static psram_bandwidth_stats_t psram_stats = {0};
 static SemaphoreHandle_t psram_stats_mutex = NULL;
 
-// Network throughput tracking (protected by mutex)
+// Network throughput period stats (protected by mutex, reader side only)
 static network_throughput_stats_t network_stats = {0};
+
+// Sound mixer load (single writer: the report timer)
+static audio_stats_t audio_stats = {0};
+static sound_stats_t sound_stats_snapshot;
 static SemaphoreHandle_t network_stats_mutex = NULL;
 
+// Hot-path counters, one cache line per core. Writers only ever touch the
+// slot of the core they run on, so the render core and the network core never
+// share a line; the atomic add only guards against preemption by another task
+// on the same core. The counters are monotonic and the periodic update works
+// on deltas against the previous snapshot, so nothing is ever reset under a
+// writer's feet.
+static psram_core_counters_t psram_core_counters[portNUM_PROCESSORS];
+static network_core_counters_t network_core_counters[portNUM_PROCESSORS];
+
+// Snapshots taken at the previous periodic update (reader side only)
+static psram_core_counters_t psram_counters_snapshot;
+static perf_phase_totals_t phase_totals_snapshot[PERF_PHASE_COUNT];
+
+// PSRAM bandwidth and miss latency measured once at init
+static perf_psram_calibration_t psram_calibration;
+static network_core_counters_t network_counters_snapshot;
+
+#define COUNTER_ADD(field, value) __atomic_fetch_add(&(field), (value), __ATOMIC_RELAXED)
+#define COUNTER_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/**
+ * @brief Sum the per-core PSRAM counters into one consistent-enough total
+ */
+static void psram_counters_aggregate(psram_core_counters_t *total) {
+    memset(total, 0, sizeof(*total));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        psram_core_counters_t *c = &psram_core_counters[core];
+        total->read_operations += COUNTER_LOAD(c->read_operations);
+        total->write_operations += COUNTER_LOAD(c->write_operations);
+        total->bytes_read += COUNTER_LOAD(c->bytes_read);
+        total->bytes_written += COUNTER_LOAD(c->bytes_written);
+    }
+}
+
+/**
+ * @brief Sum the per-core network counters
+ */
+static void network_counters_aggregate(network_core_counters_t *total) {
+    memset(total, 0, sizeof(*total));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        network_core_counters_t *c = &network_core_counters[core];
+        total->bytes_sent += COUNTER_LOAD(c->bytes_sent);
+        total->bytes_received += COUNTER_LOAD(c->bytes_received);
+        total->packets_sent += COUNTER_LOAD(c->packets_sent);
+        total->packets_received += COUNTER_LOAD(c->packets_received);
+    }
+}
+
 // Configuration cache
 static struct {
     uint32_t cpu_freq_mhz;
@@ -534,49 +596,60 @@ esp_err_t instrumentation_get_psram_bandwidth_stats(psram_bandwidth_stats_t *sta
 }
 
 /**
- * @brief Track PSRAM read operation
+ * @brief Track PSRAM read operation (lock-free, per-core)
  */
 void instrumentation_psram_read_operation(uint32_t bytes) {
-    if (xSemaphoreTake(psram_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        psram_stats.read_operations++;
-        psram_stats.bytes_read += bytes;
-        xSemaphoreGive(psram_stats_mutex);
-    }
+    psram_core_counters_t *c = &psram_core_counters[xPortGetCoreID()];
+    COUNTER_ADD(c->read_operations, 1);
+    COUNTER_ADD(c->bytes_read, bytes);
 }
 
 /**
- * @brief Track PSRAM write operation
+ * @brief Track PSRAM write operation (lock-free, per-core)
  */
 void instrumentation_psram_write_operation(uint32_t bytes) {
-    if (xSemaphoreTake(psram_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        psram_stats.write_operations++;
-        psram_stats.bytes_written += bytes;
-        xSemaphoreGive(psram_stats_mutex);
-    }
+    psram_core_counters_t *c = &psram_core_counters[xPortGetCoreID()];
+    COUNTER_ADD(c->write_operations, 1);
+    COUNTER_ADD(c->bytes_written, bytes);
 }
 
 /**
- * @brief Track PSRAM cache hit
+ * @brief Measured PSRAM characteristics from boot calibration
  */
-void instrumentation_psram_cache_hit(void) {
-    if (xSemaphoreTake(psram_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        psram_stats.cache_hits++;
-        xSemaphoreGive(psram_stats_mutex);
-    }
+const perf_psram_calibration_t *instrumentation_get_psram_calibration(void) {
+    return &psram_calibration;
 }
 
 /**
- * @brief Track PSRAM cache miss
+ * @brief Fold the per-phase hardware counters into this period's deltas
+ *
+ * @return Data stall cycles summed over all phases
  */
-void instrumentation_psram_cache_miss(void) {
-    if (xSemaphoreTake(psram_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        psram_stats.cache_misses++;
-        xSemaphoreGive(psram_stats_mutex);
-    }
+static uint64_t update_phase_counter_stats(void) {
+    uint64_t total_dstall = 0;
+    for (int phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+        perf_phase_totals_t now;
+        perf_phase_get_totals(phase, &now);
+        perf_phase_totals_t *prev = &phase_totals_snapshot[phase];
+        phase_counter_stats_t *out = &psram_stats.phases[phase];
+
+        uint64_t cycles = now.cycles - prev->cycles;
+        uint64_t dstall = now.dstall_cycles - prev->dstall_cycles;
+        uint64_t istall = now.istall_cycles - prev->istall_cycles;
+        out->count = now.count - prev->count;
+        out->busy_us = psram_calibration.cpu_hz ? (uint32_t)(cycles * 1000000 / psram_calibration.cpu_hz) : 0;
+        out->dstall_percent = cycles ? (uint32_t)(dstall * 100 / cycles) : 0;
+        out->istall_percent = cycles ? (uint32_t)(istall * 100 / cycles) : 0;
+        out->cache_misses = psram_calibration.miss_latency_cycles ?
+                            (uint32_t)(dstall / psram_calibration.miss_latency_cycles) : 0;
+        total_dstall += dstall;
+        *prev = now;
+    }
+    return total_dstall;
 }
 
 /**
- * @brief Update PSRAM bandwidth utilization
+ * @brief Update PSRAM bandwidth utilization from measured counters
  */
 static void update_psram_bandwidth_stats(void) {
     if (xSemaphoreTake(psram_stats_mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
@@ -588,52 +661,58 @@ static void update_psram_bandwidth_stats(void) {
     uint32_t time_diff = current_time - psram_stats.last_reset_time;
     
     if (time_diff > 0) {
-        // Calculate bandwidth utilization based on total operations
-        uint32_t total_operations = psram_stats.read_operations + psram_stats.write_operations;
-        uint32_t total_bytes = psram_stats.bytes_read + psram_stats.bytes_written;
+        // Fold the per-core counters into this period's deltas
+        psram_core_counters_t total;
+        psram_counters_aggregate(&total);
+        psram_stats.read_operations = total.read_operations - psram_counters_snapshot.read_operations;
+        psram_stats.write_operations = total.write_operations - psram_counters_snapshot.write_operations;
+        psram_stats.bytes_read = total.bytes_read - psram_counters_snapshot.bytes_read;
+        psram_stats.bytes_written = total.bytes_written - psram_counters_snapshot.bytes_written;
+        psram_counters_snapshot = total;
         
-        // Calculate actual bandwidth in bytes per second
-        uint32_t bytes_per_second = (total_bytes * 1000) / time_diff;
-        
-        // Estimate bandwidth utilization based on operations and access patterns
-        // PSRAM theoretical bandwidth is ~40MB/s, but actual usable bandwidth is lower
-        // Consider both operation frequency and data volume
-        uint32_t theoretical_bandwidth_bps = 20 * 1024 * 1024; // 20 MB/s conservative estimate
+        // Bulk bytes reported by the frame path, against the bandwidth
+        // measured at boot rather than a datasheet figure
+        uint32_t total_bytes = psram_stats.bytes_read + psram_stats.bytes_written;
+        uint32_t bytes_per_second = (uint32_t)(((uint64_t)total_bytes * 1000) / time_diff);
+        uint32_t peak = psram_calibration.read_bytes_per_sec;
+        psram_stats.bytes_percent_of_peak = peak ? (uint32_t)((uint64_t)bytes_per_second * 100 / peak) : 0;
         
-        if (theoretical_bandwidth_bps > 0) {
-            // Calculate utilization based on both data volume and operation frequency
-            uint32_t data_utilization = (bytes_per_second * 100) / theoretical_bandwidth_bps;
-            uint32_t operation_utilization = 0;
-            
-            // Factor in operation frequency (high frequency = higher utilization)
-            if (time_diff > 0) {
-                uint32_t ops_per_second = (total_operations * 1000) / time_diff;
-                // Assume max 1000 ops/sec is 100% utilization
-                operation_utilization = (ops_per_second * 100) / 1000;
-                if (operation_utilization > 100) operation_utilization = 100;
-            }
-            
-            // Combine data and operation utilization
-            psram_stats.bandwidth_utilization_percent = (data_utilization + operation_utilization) / 2;
-            
-            if (psram_stats.bandwidth_utilization_percent > 100) {
-                psram_stats.bandwidth_utilization_percent = 100;
-            }
+        // Time the cores spent waiting on data memory. The PSRAM interface is
+        // shared, so stall cycles of both cores add up against one core's clock
+        uint64_t dstall = update_phase_counter_stats();
+        uint64_t period_cycles = (uint64_t)psram_calibration.cpu_hz * time_diff / 1000;
+        uint32_t misses = 0;
+        for (int phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+            misses += psram_stats.phases[phase].cache_misses;
+        }
+        psram_stats.cache_misses = misses;
+        psram_stats.bandwidth_utilization_percent = period_cycles ? (uint32_t)(dstall * 100 / period_cycles) : 0;
+        if (psram_stats.bandwidth_utilization_percent > 100) {
+            psram_stats.bandwidth_utilization_percent = 100;
         }
         
-        // Reset counters for next period
-        psram_stats.read_operations = 0;
-        psram_stats.write_operations = 0;
-        psram_stats.bytes_read = 0;
-        psram_stats.bytes_written = 0;
-        psram_stats.cache_hits = 0;
-        psram_stats.cache_misses = 0;
+        // Start the next period; the reported deltas stay readable until then
         psram_stats.last_reset_time = current_time;
     }
     
     xSemaphoreGive(psram_stats_mutex);
 }
 
+/**
+ * @brief Log per-phase stall attribution
+ */
+static void log_phase_counter_stats(const psram_bandwidth_stats_t *stats) {
+    if (!perf_counters_supported()) {
+        return;
+    }
+    for (int phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+        const phase_counter_stats_t *p = &stats->phases[phase];
+        ESP_LOGI(TAG, "  %-8s %5u runs %7u us  dstall %2u%%  istall %2u%%  ~%u misses",
+                 perf_phase_name(phase), p->count, p->busy_us,
+                 p->dstall_percent, p->istall_percent, p->cache_misses);
+    }
+}
+
 /**
  * @brief Log PSRAM bandwidth statistics
  */
@@ -650,23 +729,21 @@ static void log_psram_bandwidth_stats(void) {
     ESP_LOGI(TAG, "=== PSRAM ===");
     ESP_LOGI(TAG, "Read: %u ops, %u bytes", stats.read_operations, stats.bytes_read);
     ESP_LOGI(TAG, "Write: %u ops, %u bytes", stats.write_operations, stats.bytes_written);
-    ESP_LOGI(TAG, "Cache: %u hits, %u misses", stats.cache_hits, stats.cache_misses);
-    ESP_LOGI(TAG, "Bandwidth: %u%%", stats.bandwidth_utilization_percent);
+    ESP_LOGI(TAG, "Stalled: %u%% (~%u misses), bytes %u%% of peak",
+             stats.bandwidth_utilization_percent, stats.cache_misses, stats.bytes_percent_of_peak);
+    log_phase_counter_stats(&stats);
 #else
     ESP_LOGI(TAG, "=== PSRAM BANDWIDTH STATS ===");
     ESP_LOGI(TAG, "Read Operations: %u", stats.read_operations);
     ESP_LOGI(TAG, "Write Operations: %u", stats.write_operations);
     ESP_LOGI(TAG, "Bytes Read: %u", stats.bytes_read);
     ESP_LOGI(TAG, "Bytes Written: %u", stats.bytes_written);
-    ESP_LOGI(TAG, "Cache Hits: %u", stats.cache_hits);
-    ESP_LOGI(TAG, "Cache Misses: %u", stats.cache_misses);
-    
-    if (stats.cache_hits + stats.cache_misses > 0) {
-        uint32_t cache_hit_rate = (stats.cache_hits * 100) / (stats.cache_hits + stats.cache_misses);
-        ESP_LOGI(TAG, "Cache Hit Rate: %u%%", cache_hit_rate);
-    }
-    
-    ESP_LOGI(TAG, "Bandwidth Utilization: %u%%", stats.bandwidth_utilization_percent);
+    ESP_LOGI(TAG, "Estimated Cache Misses: %u (miss latency %u cycles)",
+             stats.cache_misses, psram_calibration.miss_latency_cycles);
+    ESP_LOGI(TAG, "Bytes vs Measured Peak: %u%% of %u KB/s",
+             stats.bytes_percent_of_peak, psram_calibration.read_bytes_per_sec / 1024);
+    ESP_LOGI(TAG, "Bandwidth Utilization (stall time): %u%%", stats.bandwidth_utilization_percent);
+    log_phase_counter_stats(&stats);
 #endif
 }
 
@@ -689,45 +766,35 @@ esp_err_t instrumentation_get_network_throughput_stats(network_throughput_stats_
 }
 
 /**
- * @brief Track network bytes sent
+ * @brief Track network bytes sent (lock-free, per-core)
  */
 void instrumentation_network_sent_bytes(uint32_t bytes) {
-    if (xSemaphoreTake(network_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        network_stats.bytes_sent += bytes;
-        network_stats.packets_sent++;
-        xSemaphoreGive(network_stats_mutex);
-    }
+    network_core_counters_t *c = &network_core_counters[xPortGetCoreID()];
+    COUNTER_ADD(c->bytes_sent, bytes);
+    COUNTER_ADD(c->packets_sent, 1);
 }
 
 /**
- * @brief Track network bytes received
+ * @brief Track network bytes received (lock-free, per-core)
  */
 void instrumentation_network_received_bytes(uint32_t bytes) {
-    if (xSemaphoreTake(network_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        network_stats.bytes_received += bytes;
-        network_stats.packets_received++;
-        xSemaphoreGive(network_stats_mutex);
-    }
+    network_core_counters_t *c = &network_core_counters[xPortGetCoreID()];
+    COUNTER_ADD(c->bytes_received, bytes);
+    COUNTER_ADD(c->packets_received, 1);
 }
 
 /**
- * @brief Track network packet sent
+ * @brief Track network packet sent (lock-free, per-core)
  */
 void instrumentation_network_sent_packet(void) {
-    if (xSemaphoreTake(network_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        network_stats.packets_sent++;
-        xSemaphoreGive(network_stats_mutex);
-    }
+    COUNTER_ADD(network_core_counters[xPortGetCoreID()].packets_sent, 1);
 }
 
 /**
- * @brief Track network packet received
+ * @brief Track network packet received (lock-free, per-core)
  */
 void instrumentation_network_received_packet(void) {
-    if (xSemaphoreTake(network_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        network_stats.packets_received++;
-        xSemaphoreGive(network_stats_mutex);
-    }
+    COUNTER_ADD(network_core_counters[xPortGetCoreID()].packets_received, 1);
 }
 
 /**
@@ -743,13 +810,27 @@ static void update_network_throughput_stats(void) {
     uint32_t time_diff = current_time - network_stats.last_reset_time;
     
     if (time_diff > 0) {
-        // Calculate bytes per second
-        network_stats.bytes_per_sec_sent = (network_stats.bytes_sent * 1000) / time_diff;
-        network_stats.bytes_per_sec_received = (network_stats.bytes_received * 1000) / time_diff;
+        // Fold the per-core counters; totals are cumulative, rates use this period's delta
+        network_core_counters_t total;
+        network_counters_aggregate(&total);
+        uint32_t bytes_sent = total.bytes_sent - network_counters_snapshot.bytes_sent;
+        uint32_t bytes_received = total.bytes_received - network_counters_snapshot.bytes_received;
+        uint32_t packets_sent = total.packets_sent - network_counters_snapshot.packets_sent;
+        uint32_t packets_received = total.packets_received - network_counters_snapshot.packets_received;
+        network_counters_snapshot = total;
+        
+        network_stats.bytes_sent = total.bytes_sent;
+        network_stats.bytes_received = total.bytes_received;
+        network_stats.packets_sent = total.packets_sent;
+        network_stats.packets_received = total.packets_received;
+        
+        // Calculate bytes per second (uint64 so a busy period cannot overflow)
+        network_stats.bytes_per_sec_sent = (uint32_t)(((uint64_t)bytes_sent * 1000) / time_diff);
+        network_stats.bytes_per_sec_received = (uint32_t)(((uint64_t)bytes_received * 1000) / time_diff);
         
         // Calculate packets per second
-        network_stats.packets_per_sec_sent = (network_stats.packets_sent * 1000) / time_diff;
-        network_stats.packets_per_sec_received = (network_stats.packets_received * 1000) / time_diff;
+        network_stats.packets_per_sec_sent = (packets_sent * 1000) / time_diff;
+        network_stats.packets_per_sec_received = (packets_received * 1000) / time_diff;
         
         // Calculate connection quality based on WiFi RSSI
         if (wifi_stats.wifi_rssi != 0) {
@@ -771,7 +852,7 @@ static void update_network_throughput_stats(void) {
         }
         
         // Calculate retransmission rate (simplified)
-        uint32_t total_packets = network_stats.packets_sent + network_stats.packets_received;
+        uint32_t total_packets = packets_sent + packets_received;
         if (total_packets > 0) {
             // Estimate retransmission rate based on WiFi errors
             uint32_t total_errors = wifi_stats.wifi_tx_errors + wifi_stats.wifi_rx_errors;
@@ -780,6 +861,8 @@ static void update_network_throughput_stats(void) {
                 network_stats.retransmission_rate_percent = 100;
             }
         }
+        
+        network_stats.last_reset_time = current_time;
     }
     
     xSemaphoreGive(network_stats_mutex);
@@ -814,6 +897,86 @@ static void log_network_throughput_stats(void) {
 #endif
 }
 
+esp_err_t instrumentation_get_audio_stats(audio_stats_t *stats) {
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = audio_stats;
+    return ESP_OK;
+}
+
+/**
+ * @brief Turn the mixer's monotonic counters into per-period load and rate
+ */
+static void update_audio_stats(void) {
+    uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    uint32_t time_diff = current_time - audio_stats.last_reset_time;
+    sound_stats_t now;
+
+    if (time_diff == 0) {
+        return;
+    }
+    I_GetSoundStats(&now);
+    audio_stats.mixer_cpu_permille = (uint32_t)((now.busy_us - sound_stats_snapshot.busy_us) / time_diff);
+    audio_stats.bytes_per_sec = (uint32_t)((now.bytes - sound_stats_snapshot.bytes) * 1000 / time_diff);
+    audio_stats.blocks = now.blocks;
+    audio_stats.blocks_dropped = now.blocks_dropped;
+    audio_stats.voices = now.voices;
+    audio_stats.music_bytes_per_sec = (uint32_t)((now.music_bytes - sound_stats_snapshot.music_bytes) * 1000 / time_diff);
+    audio_stats.music_events = now.music_events;
+    audio_stats.last_reset_time = current_time;
+    sound_stats_snapshot = now;
+}
+
+static void log_audio_stats(void) {
+    if (audio_stats.blocks == 0 && audio_stats.blocks_dropped == 0 && audio_stats.music_events == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "=== AUDIO ===");
+    ESP_LOGI(TAG, "Mixer CPU: %u.%u%%  Stream: %u B/s  Voices: %u  Blocks: %u (dropped %u)",
+             audio_stats.mixer_cpu_permille / 10, audio_stats.mixer_cpu_permille % 10,
+             audio_stats.bytes_per_sec, audio_stats.voices, audio_stats.blocks, audio_stats.blocks_dropped);
+    ESP_LOGI(TAG, "Music: %u B/s  Events: %u", audio_stats.music_bytes_per_sec, audio_stats.music_events);
+}
+
+/**
+ * @brief Log zone heap usage per tag and region, and the per-level history
+ */
+static void log_zone_stats(void) {
+    zone_stats_t *stats = malloc(sizeof(zone_stats_t));
+    if (!stats) {
+        return;
+    }
+    Z_GetStats(stats);
+    
+    ESP_LOGI(TAG, "=== ZONE ===");
+    ESP_LOGI(TAG, "Total: %u bytes (peak %u)", (unsigned)stats->total_bytes, (unsigned)stats->peak_total_bytes);
+    for (int tag = 0; tag < stats->tag_count; tag++) {
+        const zone_usage_t *internal = &stats->usage[tag][Z_REGION_INTERNAL];
+        const zone_usage_t *psram = &stats->usage[tag][Z_REGION_PSRAM];
+        if (internal->blocks + psram->blocks == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "  %-8s internal %7u B/%4u  psram %8u B/%5u", Z_TagName(tag),
+                 (unsigned)internal->bytes, internal->blocks, (unsigned)psram->bytes, psram->blocks);
+    }
+    // PU_STATIC at level start should be flat; a rising column is a leak
+    for (int i = 0; i < stats->level_count; i++) {
+        const zone_level_stats_t *level = &stats->levels[i];
+        char peaks[128];
+        int used = 0;
+        for (int tag = 0; tag < stats->tag_count && used < (int)sizeof(peaks); tag++) {
+            if (level->peak_tag_bytes[tag]) {
+                used += snprintf(peaks + used, sizeof(peaks) - used, " %s=%u", Z_TagName(tag),
+                                 (unsigned)level->peak_tag_bytes[tag]);
+            }
+        }
+        ESP_LOGI(TAG, "  E%dM%-2d static at start %7u  peak %8u |%s", level->episode, level->map,
+                 (unsigned)level->static_bytes_at_start, (unsigned)level->peak_total_bytes, used ? peaks : "");
+    }
+    free(stats);
+}
+
 /**
  * @brief Log system configuration
  */
@@ -823,6 +986,11 @@ void instrumentation_log_configuration(void) {
     ESP_LOGI(TAG, "Flash: %u MB", config_cache.flash_size_mb);
     ESP_LOGI(TAG, "PSRAM: %s", config_cache.psram_enabled ? "Yes" : "No");
     ESP_LOGI(TAG, "WiFi Mode: %u", config_cache.wifi_mode);
+    if (config_cache.psram_enabled) {
+        ESP_LOGI(TAG, "PSRAM Measured: read %u KB/s, write %u KB/s, miss %u cycles",
+                 psram_calibration.read_bytes_per_sec / 1024, psram_calibration.write_bytes_per_sec / 1024,
+                 psram_calibration.miss_latency_cycles);
+    }
     ESP_LOGI(TAG, "Doom Stack: %u bytes", config_cache.doom_task_stack_size);
     ESP_LOGI(TAG, "Server Stack: %u bytes", config_cache.server_task_stack_size);
     
@@ -857,6 +1025,25 @@ void instrumentation_log_configuration(void) {
     ESP_LOGI(TAG, "  Priority: %d", INSTRUMENTATION_TASK_PRIORITY);
 }
 
+/**
+ * @brief Optionally log the current window of every registered latency histogram, then roll it
+ */
+static void roll_latency_stats(bool log) {
+    size_t count = perf_latency_count();
+    for (size_t i = 0; i < count; i++) {
+        perf_latency_t *latency = perf_latency_get(i);
+        perf_histogram_summary_t window;
+        perf_histogram_summarize(&latency->window, &window);
+        if (log && window.count > 0) {
+            ESP_LOGI(TAG, "Latency %s: n=%lu mean=%luus p50=%luus p90=%luus p99=%luus p99.9=%luus max=%luus",
+                     latency->name, (unsigned long)window.count, (unsigned long)window.mean,
+                     (unsigned long)window.p50, (unsigned long)window.p90, (unsigned long)window.p99,
+                     (unsigned long)window.p999, (unsigned long)window.max);
+        }
+        perf_latency_roll(latency);
+    }
+}
+
 /**
  * @brief Periodic instrumentation timer callback (with error handling)
  */
@@ -865,6 +1052,18 @@ static void instrumentation_timer_callback(TimerHandle_t xTimer) {
         return;
     }
     
+    // Refresh period statistics first; /metrics and the live stats stream read them
+    instrumentation_wifi_update_stats();
+    update_cpu_usage_stats();
+    update_psram_bandwidth_stats();
+    update_network_throughput_stats();
+    update_audio_stats();
+    
+    if (!serial_logging_enabled) {
+        roll_latency_stats(false);
+        return;
+    }
+    
     // Wrap the entire callback in error handling to prevent crashes
     ESP_LOGI(TAG, "=== INSTRUMENTATION REPORT ===");
     
@@ -877,28 +1076,19 @@ static void instrumentation_timer_callback(TimerHandle_t xTimer) {
         ESP_LOGW(TAG, "Failed to log task statistics");
     }
     
-    // Update and log WiFi stats (with error handling)
-    instrumentation_wifi_update_stats();
+    // Log WiFi, CPU, PSRAM and network stats
     log_wifi_stats();
-    
-    // Update and log CPU usage stats (with error handling)
-    update_cpu_usage_stats();
     log_cpu_usage_stats();
-
-    // Update and log PSRAM bandwidth stats (with error handling)
-    update_psram_bandwidth_stats();
     log_psram_bandwidth_stats();
-
-    // Update and log network throughput stats (with error handling)
-    update_network_throughput_stats();
     log_network_throughput_stats();
+    log_audio_stats();
+    log_zone_stats();
     
     // Log comprehensive system statistics
     instrumentation_log_comprehensive_stats();
     
-    // Log WebSocket profiling stats (if available)
-    extern void log_all_websocket_profiles(void);
-    log_all_websocket_profiles();
+    // Log and roll latency histograms (WebSocket operations, engine frame/tic time)
+    roll_latency_stats(true);
     
     ESP_LOGI(TAG, "=== END REPORT ===");
 }
@@ -948,7 +1138,9 @@ void instrumentation_wifi_update_stats(void) {
         
         // Get WiFi driver statistics using esp_wifi_statis_dump()
         // This provides actual driver-level statistics instead of manual tracking
-        esp_wifi_statis_dump(0); // Dump to console for debugging
+        if (serial_logging_enabled) {
+            esp_wifi_statis_dump(0); // Dump to console for debugging
+        }
         
         xSemaphoreGive(wifi_stats_mutex);
     } else {
@@ -995,6 +1187,12 @@ esp_err_t instrumentation_init(void) {
     config_cache.flash_size_mb = 4;    // ESP32 default flash size in MB
     config_cache.psram_enabled = esp_psram_is_initialized();
     
+    // Measure the PSRAM bandwidth and miss latency the utilization figures
+    // are computed against
+    if (config_cache.psram_enabled && perf_psram_calibrate(&psram_calibration) != 0) {
+        ESP_LOGW(TAG, "PSRAM calibration failed");
+    }
+    
     // Get WiFi mode with error checking
     wifi_mode_t wifi_mode;
     esp_err_t ret = esp_wifi_get_mode(&wifi_mode);
@@ -1148,6 +1346,9 @@ esp_err_t instrumentation_get_comprehensive_stats(system_stats_t *stats) {
     // Get memory stats
     stats->memory_stats = instrumentation_get_heap_memory_stats();
     
+    // Get sound mixer stats
+    stats->audio_stats = audio_stats;
+    
     // Get WiFi stats
     stats->wifi_stats = wifi_stats;
     
@@ -1208,4 +1409,345 @@ void instrumentation_log_comprehensive_stats(void) {
                      stats.cpu_stats[i].avg_runtime_ms);
         }
     }
-} 
\ No newline at end of file
+} 
+/**
+ * @brief Enable or disable the periodic serial report
+ */
+void instrumentation_set_serial_logging(bool enabled) {
+    serial_logging_enabled = enabled;
+    ESP_LOGI(TAG, "Serial instrumentation report %s", enabled ? "enabled" : "disabled");
+}
+
+/**
+ * @brief Check whether the periodic serial report is enabled
+ */
+bool instrumentation_get_serial_logging(void) {
+    return serial_logging_enabled;
+}
+
+// Buffered writer for the metrics exporter
+typedef struct {
+    instrumentation_write_fn write;
+    void *ctx;
+    char buf[1024];
+    size_t used;
+    int error;
+} metrics_writer_t;
+
+static void metrics_flush(metrics_writer_t *w) {
+    if (w->used > 0 && !w->error) {
+        w->error = w->write(w->ctx, w->buf, w->used);
+    }
+    w->used = 0;
+}
+
+static void metrics_printf(metrics_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void metrics_printf(metrics_writer_t *w, const char *fmt, ...) {
+    char line[192];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len <= 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof(line)) {
+        len = sizeof(line) - 1;
+    }
+    if (w->used + len > sizeof(w->buf)) {
+        metrics_flush(w);
+    }
+    memcpy(w->buf + w->used, line, len);
+    w->used += len;
+}
+
+static void metrics_header(metrics_writer_t *w, const char *name, const char *type, const char *help) {
+    metrics_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * @brief Export all counters in Prometheus text exposition format
+ */
+esp_err_t instrumentation_write_metrics(instrumentation_write_fn write, void *ctx) {
+    if (!write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    metrics_writer_t *w = malloc(sizeof(metrics_writer_t));
+    system_stats_t *stats = calloc(1, sizeof(system_stats_t));
+    perf_histogram_t *merged = malloc(sizeof(perf_histogram_t));
+    if (!w || !stats || !merged) {
+        free(w);
+        free(stats);
+        free(merged);
+        return ESP_ERR_NO_MEM;
+    }
+    w->write = write;
+    w->ctx = ctx;
+    w->used = 0;
+    w->error = 0;
+
+    instrumentation_get_comprehensive_stats(stats);
+
+    metrics_header(w, "doom_uptime_seconds", "counter", "Time since boot");
+    metrics_printf(w, "doom_uptime_seconds %lu\n", (unsigned long)(stats->system_uptime_ms / 1000));
+
+    // Memory
+    metrics_header(w, "doom_heap_free_bytes", "gauge", "Free heap by region");
+    metrics_printf(w, "doom_heap_free_bytes{region=\"internal\"} %u\n", (unsigned)stats->memory_stats.free_internal_ram);
+    metrics_printf(w, "doom_heap_free_bytes{region=\"psram\"} %u\n", (unsigned)stats->memory_stats.free_psram);
+    metrics_header(w, "doom_heap_min_free_bytes", "gauge", "Lowest free internal heap since boot");
+    metrics_printf(w, "doom_heap_min_free_bytes{region=\"internal\"} %u\n", (unsigned)stats->memory_stats.min_free_internal_ram);
+    metrics_header(w, "doom_psram_size_bytes", "gauge", "Total PSRAM");
+    metrics_printf(w, "doom_psram_size_bytes %u\n", (unsigned)stats->memory_stats.total_psram);
+
+    // Per-task CPU
+    metrics_header(w, "doom_cpu_percent", "gauge", "CPU usage of all tasks over the last period");
+    metrics_printf(w, "doom_cpu_percent %lu\n", (unsigned long)stats->total_cpu_usage_percent);
+    metrics_header(w, "doom_task_cpu_percent", "gauge", "CPU usage per task over the last period");
+    for (uint32_t i = 0; i < stats->cpu_stats_count && i < MAX_TASKS_TO_TRACK; i++) {
+        metrics_printf(w, "doom_task_cpu_percent{task=\"%s\"} %lu\n",
+                       stats->cpu_stats[i].task_name, (unsigned long)stats->cpu_stats[i].cpu_usage_percent);
+    }
+    metrics_header(w, "doom_task_stack_free_bytes", "gauge", "Stack high water mark per task");
+    for (uint32_t i = 0; i < stats->cpu_stats_count && i < MAX_TASKS_TO_TRACK; i++) {
+        metrics_printf(w, "doom_task_stack_free_bytes{task=\"%s\"} %lu\n",
+                       stats->cpu_stats[i].task_name, (unsigned long)stats->cpu_stats[i].stack_high_water_mark);
+    }
+
+    // WiFi
+    metrics_header(w, "doom_wifi_rssi_dbm", "gauge", "Signal strength of the associated AP");
+    metrics_printf(w, "doom_wifi_rssi_dbm %d\n", stats->wifi_stats.wifi_rssi);
+    metrics_header(w, "doom_wifi_channel", "gauge", "WiFi primary channel");
+    metrics_printf(w, "doom_wifi_channel %u\n", stats->wifi_stats.wifi_channel);
+
+    // PSRAM and network hot-path counters (monotonic)
+    psram_core_counters_t psram_total;
+    network_core_counters_t network_total;
+    psram_counters_aggregate(&psram_total);
+    network_counters_aggregate(&network_total);
+
+    metrics_header(w, "doom_psram_bytes_total", "counter", "Bytes moved through tracked PSRAM buffers");
+    metrics_printf(w, "doom_psram_bytes_total{op=\"read\"} %lu\n", (unsigned long)psram_total.bytes_read);
+    metrics_printf(w, "doom_psram_bytes_total{op=\"write\"} %lu\n", (unsigned long)psram_total.bytes_written);
+    metrics_header(w, "doom_psram_operations_total", "counter", "Tracked PSRAM buffer operations");
+    metrics_printf(w, "doom_psram_operations_total{op=\"read\"} %lu\n", (unsigned long)psram_total.read_operations);
+    metrics_printf(w, "doom_psram_operations_total{op=\"write\"} %lu\n", (unsigned long)psram_total.write_operations);
+    metrics_header(w, "doom_psram_bandwidth_percent", "gauge", "Share of the last period the cores stalled on PSRAM");
+    metrics_printf(w, "doom_psram_bandwidth_percent %lu\n", (unsigned long)stats->psram_stats.bandwidth_utilization_percent);
+    metrics_header(w, "doom_psram_peak_bytes_per_second", "gauge", "PSRAM bandwidth measured at boot");
+    metrics_printf(w, "doom_psram_peak_bytes_per_second{op=\"read\"} %lu\n", (unsigned long)psram_calibration.read_bytes_per_sec);
+    metrics_printf(w, "doom_psram_peak_bytes_per_second{op=\"write\"} %lu\n", (unsigned long)psram_calibration.write_bytes_per_sec);
+    metrics_header(w, "doom_psram_miss_latency_cycles", "gauge", "Dependent PSRAM load latency measured at boot");
+    metrics_printf(w, "doom_psram_miss_latency_cycles %lu\n", (unsigned long)psram_calibration.miss_latency_cycles);
+    if (perf_counters_supported()) {
+        metrics_header(w, "doom_phase_cycles_total", "counter", "CPU cycles per engine phase, and stalls within them");
+        for (int phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+            perf_phase_totals_t t;
+            perf_phase_get_totals(phase, &t);
+            metrics_printf(w, "doom_phase_cycles_total{phase=\"%s\",kind=\"busy\"} %llu\n",
+                           perf_phase_name(phase), (unsigned long long)t.cycles);
+            metrics_printf(w, "doom_phase_cycles_total{phase=\"%s\",kind=\"dstall\"} %llu\n",
+                           perf_phase_name(phase), (unsigned long long)t.dstall_cycles);
+            metrics_printf(w, "doom_phase_cycles_total{phase=\"%s\",kind=\"istall\"} %llu\n",
+                           perf_phase_name(phase), (unsigned long long)t.istall_cycles);
+        }
+    }
+
+    metrics_header(w, "doom_network_bytes_total", "counter", "Application bytes on the game socket");
+    metrics_printf(w, "doom_network_bytes_total{direction=\"sent\"} %lu\n", (unsigned long)network_total.bytes_sent);
+    metrics_printf(w, "doom_network_bytes_total{direction=\"received\"} %lu\n", (unsigned long)network_total.bytes_received);
+    metrics_header(w, "doom_network_packets_total", "counter", "Application messages on the game socket");
+    metrics_printf(w, "doom_network_packets_total{direction=\"sent\"} %lu\n", (unsigned long)network_total.packets_sent);
+    metrics_printf(w, "doom_network_packets_total{direction=\"received\"} %lu\n", (unsigned long)network_total.packets_received);
+    metrics_header(w, "doom_network_bytes_per_second", "gauge", "Game socket throughput over the last period");
+    metrics_printf(w, "doom_network_bytes_per_second{direction=\"sent\"} %lu\n", (unsigned long)stats->network_stats.bytes_per_sec_sent);
+    metrics_printf(w, "doom_network_bytes_per_second{direction=\"received\"} %lu\n", (unsigned long)stats->network_stats.bytes_per_sec_received);
+
+    metrics_header(w, "doom_audio_mixer_cpu_ratio", "gauge", "Share of one core spent mixing and encoding sound over the last period");
+    metrics_printf(w, "doom_audio_mixer_cpu_ratio %u.%03u\n", (unsigned)(stats->audio_stats.mixer_cpu_permille / 1000),
+                   (unsigned)(stats->audio_stats.mixer_cpu_permille % 1000));
+    metrics_header(w, "doom_audio_bytes_per_second", "gauge", "Encoded audio streamed over the last period");
+    metrics_printf(w, "doom_audio_bytes_per_second %lu\n", (unsigned long)stats->audio_stats.bytes_per_sec);
+    metrics_header(w, "doom_audio_blocks_total", "counter", "Audio blocks by outcome");
+    metrics_printf(w, "doom_audio_blocks_total{result=\"queued\"} %lu\n", (unsigned long)stats->audio_stats.blocks);
+    metrics_printf(w, "doom_audio_blocks_total{result=\"dropped\"} %lu\n", (unsigned long)stats->audio_stats.blocks_dropped);
+    metrics_header(w, "doom_audio_voices", "gauge", "Sound effect voices playing in the last mixed block");
+    metrics_printf(w, "doom_audio_voices %lu\n", (unsigned long)stats->audio_stats.voices);
+    metrics_header(w, "doom_music_bytes_per_second", "gauge", "Music sequencer events streamed over the last period");
+    metrics_printf(w, "doom_music_bytes_per_second %lu\n", (unsigned long)stats->audio_stats.music_bytes_per_sec);
+    metrics_header(w, "doom_music_events_total", "counter", "Music sequencer events queued");
+    metrics_printf(w, "doom_music_events_total %lu\n", (unsigned long)stats->audio_stats.music_events);
+
+    video_stats_t video;
+    I_GetVideoStats(&video);
+    metrics_header(w, "doom_video_frames_total", "counter", "Main frames by how they were queued");
+    metrics_printf(w, "doom_video_frames_total{kind=\"full\"} %u\n", video.frames - video.layered);
+    metrics_printf(w, "doom_video_frames_total{kind=\"layered\"} %u\n", video.layered);
+    metrics_printf(w, "doom_video_frames_total{kind=\"dropped\"} %u\n", video.frames_dropped);
+    metrics_printf(w, "doom_video_frames_total{kind=\"static\"} %u\n", video.frames_static);
+    metrics_header(w, "doom_video_statusbar_sends_total", "counter", "Layered frames that carried the status bar rows");
+    metrics_printf(w, "doom_video_statusbar_sends_total %u\n", video.statusbar_sent);
+    metrics_header(w, "doom_video_frame_bytes_total", "counter", "Main frame bytes queued for the sender");
+    metrics_printf(w, "doom_video_frame_bytes_total %llu\n", video.bytes);
+    metrics_header(w, "doom_video_idle_seconds_total", "counter", "Time in menus, intermissions, finales and pauses");
+    metrics_printf(w, "doom_video_idle_seconds_total %llu.%03u\n", video.idle_us / 1000000,
+                   (unsigned)(video.idle_us / 1000 % 1000));
+    metrics_header(w, "doom_video_idle_frames_total", "counter", "Main frames queued while idle");
+    metrics_printf(w, "doom_video_idle_frames_total %u\n", video.idle_frames);
+    metrics_header(w, "doom_video_idle_bytes_total", "counter", "Main frame bytes queued while idle");
+    metrics_printf(w, "doom_video_idle_bytes_total %llu\n", video.idle_bytes);
+
+    drawlist_stats_t drawlist;
+    V_GetDrawListStats(&drawlist);
+    metrics_header(w, "doom_drawlist_lists_total", "counter", "Draw lists by outcome");
+    metrics_printf(w, "doom_drawlist_lists_total{result=\"sent\"} %u\n", drawlist.lists);
+    metrics_printf(w, "doom_drawlist_lists_total{result=\"repeated\"} %u\n", drawlist.repeats);
+    metrics_printf(w, "doom_drawlist_lists_total{result=\"raster\"} %u\n", drawlist.fallbacks);
+    metrics_header(w, "doom_drawlist_commands_total", "counter", "Patches sent as draw commands");
+    metrics_printf(w, "doom_drawlist_commands_total %u\n", drawlist.commands);
+    metrics_header(w, "doom_drawlist_bytes_total", "counter", "Draw list bytes queued");
+    metrics_printf(w, "doom_drawlist_bytes_total %llu\n", drawlist.bytes);
+
+    spectator_stats_t spectator;
+    R_GetSpectatorStats(&spectator);
+    metrics_header(w, "doom_spectator_views_total", "counter", "Spectator views by outcome");
+    metrics_printf(w, "doom_spectator_views_total{result=\"rendered\"} %u\n", spectator.rendered);
+    metrics_printf(w, "doom_spectator_views_total{result=\"skipped_budget\"} %u\n", spectator.skipped_budget);
+    metrics_printf(w, "doom_spectator_views_total{result=\"skipped_deadline\"} %u\n", spectator.skipped_deadline);
+    metrics_printf(w, "doom_spectator_views_total{result=\"dropped\"} %u\n", websocket_server_views_dropped());
+    metrics_header(w, "doom_spectator_view_render_us", "gauge", "Smoothed render time of one spectator view");
+    metrics_printf(w, "doom_spectator_view_render_us %u\n", spectator.avg_us);
+
+    // Zone heap: live usage, and the current level's high-water marks. The
+    // static-at-level-start gauge is the one to graph for level leaks.
+    zone_stats_t *zone = malloc(sizeof(zone_stats_t));
+    if (zone) {
+        Z_GetStats(zone);
+        metrics_header(w, "doom_zone_bytes", "gauge", "Zone heap bytes per purge tag and memory region");
+        for (int tag = 0; tag < zone->tag_count; tag++) {
+            for (int region = 0; region < Z_REGION_MAX; region++) {
+                metrics_printf(w, "doom_zone_bytes{tag=\"%s\",region=\"%s\"} %u\n", Z_TagName(tag),
+                               Z_RegionName(region), (unsigned)zone->usage[tag][region].bytes);
+            }
+        }
+        metrics_header(w, "doom_zone_blocks", "gauge", "Zone heap blocks per purge tag and memory region");
+        for (int tag = 0; tag < zone->tag_count; tag++) {
+            for (int region = 0; region < Z_REGION_MAX; region++) {
+                metrics_printf(w, "doom_zone_blocks{tag=\"%s\",region=\"%s\"} %u\n", Z_TagName(tag),
+                               Z_RegionName(region), zone->usage[tag][region].blocks);
+            }
+        }
+        metrics_header(w, "doom_zone_peak_bytes", "gauge", "Zone heap high-water mark since boot");
+        metrics_printf(w, "doom_zone_peak_bytes %u\n", (unsigned)zone->peak_total_bytes);
+        metrics_header(w, "doom_zone_levels_started_total", "counter", "Levels set up since boot");
+        metrics_printf(w, "doom_zone_levels_started_total %u\n", zone->levels_started);
+        if (zone->level_count > 0) {
+            const zone_level_stats_t *level = &zone->levels[zone->level_count - 1];
+            metrics_header(w, "doom_zone_level_static_bytes", "gauge", "PU_STATIC bytes when the current level was set up");
+            metrics_printf(w, "doom_zone_level_static_bytes %u\n", (unsigned)level->static_bytes_at_start);
+            metrics_header(w, "doom_zone_level_peak_bytes", "gauge", "High-water mark per tag during the current level");
+            metrics_printf(w, "doom_zone_level_peak_bytes{tag=\"all\"} %u\n", (unsigned)level->peak_total_bytes);
+            for (int tag = 0; tag < zone->tag_count; tag++) {
+                metrics_printf(w, "doom_zone_level_peak_bytes{tag=\"%s\"} %u\n", Z_TagName(tag),
+                               (unsigned)level->peak_tag_bytes[tag]);
+            }
+        }
+        free(zone);
+    }
+
+    // Latency histograms as summaries: since boot, including the open window
+    metrics_header(w, "doom_latency_microseconds", "summary", "WebSocket operation and engine frame/tic latency");
+    size_t latency_count = perf_latency_count();
+    for (size_t i = 0; i < latency_count; i++) {
+        perf_latency_t *latency = perf_latency_get(i);
+        perf_histogram_summary_t summary;
+        *merged = latency->lifetime;
+        perf_histogram_merge(merged, &latency->window);
+        perf_histogram_summarize(merged, &summary);
+        metrics_printf(w, "doom_latency_microseconds{op=\"%s\",quantile=\"0.5\"} %lu\n", latency->name, (unsigned long)summary.p50);
+        metrics_printf(w, "doom_latency_microseconds{op=\"%s\",quantile=\"0.9\"} %lu\n", latency->name, (unsigned long)summary.p90);
+        metrics_printf(w, "doom_latency_microseconds{op=\"%s\",quantile=\"0.99\"} %lu\n", latency->name, (unsigned long)summary.p99);
+        metrics_printf(w, "doom_latency_microseconds{op=\"%s\",quantile=\"0.999\"} %lu\n", latency->name, (unsigned long)summary.p999);
+        metrics_printf(w, "doom_latency_microseconds_sum{op=\"%s\"} %llu\n", latency->name, (unsigned long long)merged->sum);
+        metrics_printf(w, "doom_latency_microseconds_count{op=\"%s\"} %lu\n", latency->name, (unsigned long)merged->count);
+    }
+    metrics_header(w, "doom_latency_max_microseconds", "gauge", "Largest latency seen since boot");
+    for (size_t i = 0; i < latency_count; i++) {
+        perf_latency_t *latency = perf_latency_get(i);
+        uint32_t max = latency->lifetime.max > latency->window.max ? latency->lifetime.max : latency->window.max;
+        metrics_printf(w, "doom_latency_max_microseconds{op=\"%s\"} %lu\n", latency->name, (unsigned long)max);
+    }
+
+    metrics_flush(w);
+    esp_err_t ret = w->error ? ESP_FAIL : ESP_OK;
+    free(w);
+    free(stats);
+    free(merged);
+    return ret;
+}
+
+/**
+ * @brief Build the live stats packet streamed to subscribed WebSocket clients
+ */
+size_t instrumentation_build_stats_packet(uint8_t *buf, size_t len) {
+    static uint32_t last_frame_count = 0;
+    static uint32_t last_packet_time = 0;
+
+    if (!buf || len < sizeof(instrumentation_stats_packet_t)) {
+        return 0;
+    }
+
+    instrumentation_stats_packet_t packet = {0};
+    memory_stats_t memory = instrumentation_get_heap_memory_stats();
+    psram_bandwidth_stats_t psram = {0};
+    network_throughput_stats_t network = {0};
+    instrumentation_get_psram_bandwidth_stats(&psram);
+    instrumentation_get_network_throughput_stats(&network);
+
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    packet.version = INSTRUMENTATION_STATS_VERSION;
+    packet.uptime_ms = now;
+    packet.free_internal_ram = memory.free_internal_ram;
+    packet.min_free_internal_ram = memory.min_free_internal_ram;
+    packet.free_psram = memory.free_psram;
+    packet.psram_bandwidth_percent = psram.bandwidth_utilization_percent > 100 ? 100 : psram.bandwidth_utilization_percent;
+    packet.net_bytes_per_sec_sent = network.bytes_per_sec_sent;
+    packet.net_bytes_per_sec_received = network.bytes_per_sec_received;
+    packet.wifi_rssi = wifi_stats.wifi_rssi;
+
+    uint32_t total_cpu = 0;
+    for (uint32_t i = 0; i < cpu_stats_count && i < MAX_TASKS_TO_TRACK; i++) {
+        total_cpu += cpu_stats[i].cpu_usage_percent;
+    }
+    packet.total_cpu_percent = total_cpu > 255 ? 255 : total_cpu;
+
+    // Percentiles come from the current report window
+    perf_latency_t *frame_time = perf_latency_find("engine_frame_time");
+    perf_latency_t *tic_time = perf_latency_find("engine_tic_time");
+    perf_latency_t *send_time = perf_latency_find("ws_frame_send");
+    if (frame_time) {
+        packet.frame_time_p50_us = perf_histogram_percentile(&frame_time->window, 50.0);
+        packet.frame_time_p99_us = perf_histogram_percentile(&frame_time->window, 99.0);
+
+        // Frame rate from the frames recorded since the previous packet
+        uint32_t frames = frame_time->lifetime.count + frame_time->window.count;
+        if (last_packet_time && now > last_packet_time) {
+            packet.fps_x10 = (uint16_t)((uint64_t)(frames - last_frame_count) * 10000 / (now - last_packet_time));
+        }
+        last_frame_count = frames;
+    }
+    if (tic_time) {
+        packet.tic_time_p50_us = perf_histogram_percentile(&tic_time->window, 50.0);
+        packet.tic_time_p99_us = perf_histogram_percentile(&tic_time->window, 99.0);
+    }
+    if (send_time) {
+        packet.send_p50_us = perf_histogram_percentile(&send_time->window, 50.0);
+        packet.send_p99_us = perf_histogram_percentile(&send_time->window, 99.0);
+    }
+    last_packet_time = now;
+
+    memcpy(buf, &packet, sizeof(packet));
+    return sizeof(packet);
+}
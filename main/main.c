@@ -26,6 +26,7 @@
 #include "esp_heap_caps.h"
 #include "instrumentation.h"
 #include "websocket_server.h"
+#include "perf_trace.h"
 
 #define DOOM_TASK_CORE 1         // Core 0 = WiFi, Core 1 = Doom
 #define DOOM_TASK_STACK_SIZE 32768  // 32KB is the absolute minimum
@@ -46,8 +47,12 @@ static const char *TAG = "Main Application";
  * @param pvParameters Task parameters (unused)
  */
 void doom_task(void *pvParameters) {
+    // Build with -DDOOM_NET_SERVER=\"host:port\" to join a tic relay (tools/tic_relay.c)
     char const *argv[] = {
-        "doom", "-cout", "ICWEFDA"
+        "doom", "-cout", "ICWEFDA",
+#ifdef DOOM_NET_SERVER
+        "-net", DOOM_NET_SERVER,
+#endif
     };
     
     ESP_LOGI(TAG, "Starting Doom game task");
@@ -95,6 +100,11 @@ void app_main(void) {
     // Start periodic instrumentation
     instrumentation_start();
 
+    // Frame-timeline trace ring, downloadable from /trace.json
+    if (perf_trace_init() != 0) {
+        ESP_LOGW(TAG, "Frame tracing unavailable");
+    }
+
     // Start server integration task (handles both HTTP and WebSocket)
     ESP_LOGI(TAG, "Creating server integration task...");
     BaseType_t server_task_created = xTaskCreatePinnedToCore(
@@ -1,6 +1,7 @@
 #include "server_integration.h"
 #include "http_handlers.h"
 #include "websocket_server.h"
+#include "instrumentation.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
@@ -39,6 +40,41 @@ static const httpd_uri_t palette_uri = {
     .user_ctx = NULL
 };
 
+static const httpd_uri_t trace_uri = {
+    .uri = "/trace.json",
+    .method = HTTP_GET,
+    .handler = http_trace_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t metrics_uri = {
+    .uri = "/metrics",
+    .method = HTTP_GET,
+    .handler = http_metrics_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t profile_uri = {
+    .uri = "/profile",
+    .method = HTTP_GET,
+    .handler = http_profile_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t sfx_uri = {
+    .uri = "/sfx",
+    .method = HTTP_GET,
+    .handler = http_sfx_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t lump_uri = {
+    .uri = "/lump",
+    .method = HTTP_GET,
+    .handler = http_lump_handler,
+    .user_ctx = NULL
+};
+
 static const httpd_uri_t websocket_uri = {
     .uri = "/ws",
     .method = HTTP_GET,
@@ -63,6 +99,9 @@ esp_err_t server_integration_init(void) {
     // Initialize WebSocket server
     websocket_server_init(&g_websocket_server);
     
+    // Feed the optional live stats stream on the game socket
+    websocket_server_set_stats_provider(instrumentation_build_stats_packet);
+    
     ESP_LOGI(TAG, "Server integration initialized");
     return ESP_OK;
 }
@@ -86,6 +125,11 @@ esp_err_t server_integration_start(void) {
     httpd_register_uri_handler(g_http_server, &index_uri);
     httpd_register_uri_handler(g_http_server, &index_html_uri);
     httpd_register_uri_handler(g_http_server, &palette_uri);
+    httpd_register_uri_handler(g_http_server, &trace_uri);
+    httpd_register_uri_handler(g_http_server, &metrics_uri);
+    httpd_register_uri_handler(g_http_server, &profile_uri);
+    httpd_register_uri_handler(g_http_server, &sfx_uri);
+    httpd_register_uri_handler(g_http_server, &lump_uri);
     httpd_register_uri_handler(g_http_server, &websocket_uri);
     
     ESP_LOGI(TAG, "Server integration started on port %d", HTTP_SERVER_PORT);
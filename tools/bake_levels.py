@@ -0,0 +1,505 @@
+#!/usr/bin/env python3
+"""Compile the maps of a WAD into baked level images.
+
+Does the work of P_SetupLevel once, on the host, and appends the result to
+the WAD as one lump per map (E1M1BK, MAP01BK, ...) in the layout described in
+components/prboom/include/p_bake.h:
+
+    tools/bake_levels.py newdoom1_silent.wad -o build/wad_partition.bin
+
+The engine checks each image against the WAD it is loaded with and parses
+the map lumps as before when it does not match. The original lumps stay in
+the output, so demos that need the unbaked behaviour still play.
+
+Maps are baked in directory order until --max-size would be exceeded; the
+rest are reported and left to the normal loader. Sidedefs overloaded by Boom
+linedef types 242 and 260 name colormaps and translucency lumps rather than
+textures; the image leaves those to the engine, which reads them from
+SIDEDEFS as before.
+"""
+
+import argparse
+import math
+import re
+import struct
+import sys
+
+FRACBITS = 16
+NO_INDEX = 0xffff
+ML_TWOSIDED = 4
+BOXTOP, BOXBOTTOM, BOXLEFT, BOXRIGHT = 0, 1, 2, 3
+INT_MIN, INT_MAX = -0x80000000, 0x7fffffff
+
+BAKE_MAGIC = 0x4b414244
+BAKE_VERSION = 2
+BAKE_SUFFIX = "BK"
+BAKE_NO_INDEX = 0xffff
+
+MAP_LUMPS = ["THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+             "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP"]
+
+# Namespaces W_Init coalesces, in its order
+MARKERS = [("S_START", "S_END"), ("F_START", "F_END"),
+           ("C_START", "C_END"), ("B_START", "B_END")]
+
+HEADER = struct.Struct("<iiII10i" + "i" * 25)
+SECTOR = struct.Struct("<ii4i5hHHh")
+SIDE = struct.Struct("<7h")
+LINE = struct.Struct("<3H2h4H")
+SEG = struct.Struct("<2HhHf")     # vertexes are in the seg's SEGVERTS
+SUBSECTOR = struct.Struct("<3H")
+# BSP walk mirror (r_defs.h), used in place instead of node_t
+NODESPLIT = struct.Struct("<4h")
+NODECHILDREN = struct.Struct("<2H")
+NODEBOX = struct.Struct("<8h")
+SEGVERTS = struct.Struct("<4i")
+
+
+class SkipMap(Exception):
+    pass
+
+
+def s32(v):
+    return (v + 0x80000000) % 0x100000000 - 0x80000000
+
+
+def cdiv(a, b):
+    """C integer division, truncating toward zero."""
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def f32(v):
+    return struct.unpack("<f", struct.pack("<f", v))[0]
+
+
+def fnv1a(chunks):
+    h = 0x811c9dc5
+    for chunk in chunks:
+        for b in chunk:
+            h = ((h ^ b) * 0x01000193) & 0xffffffff
+    return h
+
+
+def lumpname(raw):
+    """Name as lumpinfo holds it: cut at the first NUL, zero padded."""
+    return raw.split(b"\0", 1)[0].ljust(8, b"\0")
+
+
+def key(raw):
+    return raw.split(b"\0", 1)[0][:8].upper()
+
+
+def is_marker(marker, name):
+    marker = marker.encode()
+    name = key(name)
+    return name == marker or (name[:1] == marker[:1] and name[1:] == marker[:7])
+
+
+class Wad:
+    def __init__(self, data):
+        ident, numlumps, dirofs = struct.unpack_from("<4sii", data, 0)
+        if ident not in (b"IWAD", b"PWAD"):
+            sys.exit("not a WAD file")
+        self.data = data
+        self.ident = ident
+        self.dir = [struct.unpack_from("<ii8s", data, dirofs + 16 * i) for i in range(numlumps)]
+        self.names = [key(e[2]) for e in self.dir]
+
+        # Namespaces after W_CoalesceMarkedResource; flats in engine number order
+        self.ns = [None] * numlumps
+        self.flats = []
+        for ns, (start, end) in enumerate(MARKERS, 1):
+            inside = False
+            for i, e in enumerate(self.dir):
+                if is_marker(start, e[2]):
+                    inside = True
+                    self.ns[i] = "marker"
+                elif is_marker(end, e[2]):
+                    inside = False
+                    self.ns[i] = "marker"
+                elif inside and self.ns[i] is None:
+                    self.ns[i] = ns
+                    if start == "F_START":
+                        self.flats.append(i)
+
+    def lump(self, i):
+        pos, size, _ = self.dir[i]
+        return self.data[pos:pos + size]
+
+    def global_lump(self, name):
+        for i in reversed(range(len(self.dir))):
+            if self.names[i] == name.encode() and self.ns[i] is None:
+                return i
+        return -1
+
+
+def texture_names(wad):
+    names = []
+    for lump in ("TEXTURE1", "TEXTURE2"):
+        i = wad.global_lump(lump)
+        if i < 0:
+            if lump == "TEXTURE1":
+                sys.exit("no TEXTURE1")
+            continue
+        data = wad.lump(i)
+        count = struct.unpack_from("<i", data, 0)[0]
+        for ofs in struct.unpack_from("<%di" % count, data, 4):
+            names.append(data[ofs:ofs + 8])
+    return names
+
+
+def group_lines(sectors, lines):
+    """P_GroupLines: per sector line lists and M_AddToBox bounding boxes."""
+    lists = [[] for _ in sectors]
+    for i, ln in enumerate(lines):
+        lists[ln["front"]].append(i)
+        if ln["back"] is not None and ln["back"] != ln["front"]:
+            lists[ln["back"]].append(i)
+    boxes = []
+    for lst in lists:
+        box = [INT_MIN, INT_MAX, INT_MAX, INT_MIN]
+        for i in lst:
+            for x, y in (lines[i]["p1"], lines[i]["p2"]):
+                if x < box[BOXLEFT]:
+                    box[BOXLEFT] = x
+                elif x > box[BOXRIGHT]:
+                    box[BOXRIGHT] = x
+                if y < box[BOXBOTTOM]:
+                    box[BOXBOTTOM] = y
+                elif y > box[BOXTOP]:
+                    box[BOXTOP] = y
+        boxes.append(box)
+    return lists, boxes
+
+
+def create_blockmap(vertexes, lines):
+    """P_CreateBlockMap, for maps whose BLOCKMAP lump is unusable."""
+    blkshift, blkmask = 7, 127
+    xs = [v[0] for v in vertexes]
+    ys = [v[1] for v in vertexes]
+    map_minx, map_maxx = min(xs) >> FRACBITS, max(xs) >> FRACBITS
+    map_miny, map_maxy = min(ys) >> FRACBITS, max(ys) >> FRACBITS
+    xorg, yorg = map_minx, map_miny
+    ncols = (map_maxx - xorg + 1 + blkmask) >> blkshift
+    nrows = (map_maxy - yorg + 1 + blkmask) >> blkshift
+    nblocks = ncols * nrows
+    blocks = [[-1] for _ in range(nblocks)]   # built tail first, like the C lists
+
+    for i, ln in enumerate(lines):
+        done = set()
+
+        def add(b):
+            if b not in done:
+                blocks[b].append(i)
+                done.add(b)
+
+        x1, y1 = ln["p1"][0] >> FRACBITS, ln["p1"][1] >> FRACBITS
+        x2, y2 = ln["p2"][0] >> FRACBITS, ln["p2"][1] >> FRACBITS
+        dx, dy = x2 - x1, y2 - y1
+        vert, horiz = not dx, not dy
+        spos, sneg = (dx ^ dy) > 0, (dx ^ dy) < 0
+        minx, maxx = min(x1, x2), max(x1, x2)
+        miny, maxy = min(y1, y2), max(y1, y2)
+        add(((y1 - yorg) >> blkshift) * ncols + ((x1 - xorg) >> blkshift))
+        add(((y2 - yorg) >> blkshift) * ncols + ((x2 - xorg) >> blkshift))
+        if not vert:
+            for j in range(ncols):
+                x = xorg + (j << blkshift)
+                y = cdiv(dy * (x - x1), dx) + y1
+                yb, yp = (y - yorg) >> blkshift, (y - yorg) & blkmask
+                if yb < 0 or yb > nrows - 1 or x < minx or x > maxx:
+                    continue
+                add(ncols * yb + j)
+                if yp == 0:
+                    if sneg:
+                        if yb > 0 and miny < y:
+                            add(ncols * (yb - 1) + j)
+                        if j > 0 and minx < x:
+                            add(ncols * yb + j - 1)
+                    elif spos:
+                        if yb > 0 and j > 0 and minx < x:
+                            add(ncols * (yb - 1) + j - 1)
+                    elif horiz:
+                        if j > 0 and minx < x:
+                            add(ncols * yb + j - 1)
+                elif j > 0 and minx < x:
+                    add(ncols * yb + j - 1)
+        if not horiz:
+            for j in range(nrows):
+                y = yorg + (j << blkshift)
+                x = cdiv(dx * (y - y1), dy) + x1
+                xb, xp = (x - xorg) >> blkshift, (x - xorg) & blkmask
+                if xb < 0 or xb > ncols - 1 or y < miny or y > maxy:
+                    continue
+                add(ncols * j + xb)
+                if xp == 0:
+                    if sneg:
+                        if j > 0 and miny < y:
+                            add(ncols * (j - 1) + xb)
+                        if xb > 0 and minx < x:
+                            add(ncols * j + xb - 1)
+                    elif vert:
+                        if j > 0 and miny < y:
+                            add(ncols * (j - 1) + xb)
+                    elif spos:
+                        if xb > 0 and j > 0 and miny < y:
+                            add(ncols * (j - 1) + xb - 1)
+                elif j > 0 and miny < y:
+                    add(ncols * (j - 1) + xb)
+
+    out = [xorg << FRACBITS, yorg << FRACBITS, ncols, nrows]
+    offs = 4 + nblocks
+    lists = []
+    for b in blocks:
+        b.append(0)
+        out.append(offs)
+        offs += len(b)
+        lists.extend(reversed(b))
+    return out + lists, xorg << FRACBITS, yorg << FRACBITS, ncols, nrows
+
+
+def bake_map(wad, marker, textures, texnum, flatnum, texhash, flathash):
+    lumps = [wad.lump(marker + 1 + k) for k in range(len(MAP_LUMPS))]
+    (things, linedefs, sidedefs, vertexdata, segdata,
+     ssectors, nodedata, sectordata, reject, blockmapdata) = lumps
+
+    def texture(raw):
+        if raw[:1] == b"-":
+            return 0
+        return texnum.get(key(raw), 0)
+
+    def flat(raw):
+        n = flatnum.get(key(raw))
+        if n is None:
+            raise SkipMap("flat %s not found" % key(raw).decode("latin-1"))
+        return n
+
+    # P_LoadVertexes
+    vertexes = [[x << FRACBITS, y << FRACBITS]
+                for x, y in struct.iter_unpack("<hh", vertexdata)]
+    orig = [tuple(v) for v in vertexes]
+
+    # P_LoadSectors
+    sectors = []
+    for fh, ch, fpic, cpic, light, special, tag in struct.iter_unpack("<hh8s8shhh", sectordata):
+        sectors.append(dict(floor=fh << FRACBITS, ceiling=ch << FRACBITS,
+                            floorpic=flat(fpic), ceilingpic=flat(cpic),
+                            light=light, special=special, tag=tag))
+
+    numsides = len(sidedefs) // 30
+    sides = [dict(special=0) for _ in range(numsides)]
+
+    # P_LoadLineDefs
+    lines = []
+    for v1, v2, flags, special, tag, s0, s1 in struct.iter_unpack("<HHHhhHH", linedefs):
+        p1, p2 = orig[v1], orig[v2]
+        dx, dy = p2[0] - p1[0], p2[1] - p1[1]
+        sidenum = [s0, s1]
+        for j in range(2):
+            if sidenum[j] != NO_INDEX and sidenum[j] >= numsides:
+                sidenum[j] = NO_INDEX
+        if sidenum[0] == NO_INDEX:
+            sidenum[0] = 0
+        if sidenum[1] == NO_INDEX and flags & ML_TWOSIDED:
+            flags &= ~ML_TWOSIDED
+        if special:
+            sides[sidenum[0]]["special"] = special
+        lines.append(dict(v1=v1, v2=v2, p1=p1, p2=p2, dx=dx, dy=dy, flags=flags,
+                          special=special, tag=tag, sidenum=sidenum))
+
+    # P_LoadSideDefs2
+    for i, (xoff, yoff, top, bottom, mid, sector) in enumerate(struct.iter_unpack("<hh8s8s8sH", sidedefs)):
+        if sector >= len(sectors):
+            print("  sidedef %d has out-of-range sector %d" % (i, sector), file=sys.stderr)
+            sector = 0
+        if sides[i]["special"] in (242, 260):
+            # Colormap and lump names: resolved by the engine from SIDEDEFS
+            top = bottom = mid = b"-"
+        sides[i].update(xoff=xoff, yoff=yoff, top=texture(top), bottom=texture(bottom),
+                        mid=texture(mid), sector=sector)
+
+    # P_LoadLineDefs2
+    for ln in lines:
+        ln["front"] = sides[ln["sidenum"][0]]["sector"]
+        ln["back"] = sides[ln["sidenum"][1]]["sector"] if ln["sidenum"][1] != NO_INDEX else None
+
+    # P_LoadBlockMap
+    # Only a blockmap P_CreateBlockMap would have to build is worth carrying;
+    # expanding a usable lump costs no more than copying it out of the image
+    blockmap, orgx, orgy, bwidth, bheight = [], 0, 0, 0, 0
+    if len(blockmapdata) < 8 or len(blockmapdata) // 2 >= 0x10000:
+        blockmap, orgx, orgy, bwidth, bheight = create_blockmap(orig, lines)
+
+    # P_LoadSubsectors, P_LoadNodes, P_LoadSegs
+    subsectors = list(struct.iter_unpack("<HH", ssectors))
+    nodes = list(struct.iter_unpack("<4h8h2H", nodedata))
+    segs = []
+    for v1, v2, angle, linedef, side, offset in struct.iter_unpack("<HHhHhh", segdata):
+        ln = lines[linedef]
+        sn = ln["sidenum"][side]
+        dx = f32(f32(orig[v2][0] - orig[v1][0]) / (1 << FRACBITS))
+        dy = f32(f32(orig[v2][1] - orig[v1][1]) / (1 << FRACBITS))
+        length = f32(math.sqrt(f32(f32(dx * dx) + f32(dy * dy))))
+        if sn == NO_INDEX:
+            print("  front of seg %d has no sidedef" % len(segs), file=sys.stderr)
+        segs.append(dict(v1=v1, v2=v2, angle=angle & 0xffff, offset=offset, linedef=linedef,
+                         side=side, sidedef=sn, length=length))
+    if not segs or not subsectors:
+        raise SkipMap("no segs or subsectors")
+
+    # P_GroupLines
+    subsector_sector = []
+    for numsegs, first in subsectors:
+        for seg in segs[first:first + numsegs]:
+            if seg["sidedef"] != NO_INDEX:
+                subsector_sector.append(sides[seg["sidedef"]]["sector"])
+                break
+        else:
+            raise SkipMap("subsector a part of no sector")
+    linelists, boxes = group_lines(sectors, lines)
+
+    # P_RemoveSlimeTrails
+    hit = [False] * len(vertexes)
+    for seg in segs:
+        ln = lines[seg["linedef"]]
+        if not (ln["dx"] and ln["dy"]):
+            continue
+        for v in (seg["v1"], seg["v2"]) if seg["v1"] != seg["v2"] else (seg["v1"],):
+            if hit[v]:
+                continue
+            hit[v] = True
+            if v in (ln["v1"], ln["v2"]):
+                continue
+            ldx, ldy = ln["dx"] >> FRACBITS, ln["dy"] >> FRACBITS
+            dx2, dy2, dxy = ldx * ldx, ldy * ldy, ldx * ldy
+            s = dx2 + dy2
+            x0, y0 = vertexes[v]
+            x1, y1 = vertexes[ln["v1"]]
+            vertexes[v][0] = s32(cdiv(dx2 * x0 + dy2 * x1 + dxy * s32(y0 - y1), s))
+            vertexes[v][1] = s32(cdiv(dy2 * y0 + dx2 * y1 + dxy * s32(x0 - x1), s))
+
+    # --- Pack ----------------------------------------------------------------
+    for name, n in (("vertexes", len(vertexes)), ("sectors", len(sectors)), ("sides", numsides),
+                    ("lines", len(lines)), ("segs", len(segs))):
+        if n >= BAKE_NO_INDEX:
+            raise SkipMap("too many %s" % name)
+
+    sections = []
+    sections.append(b"".join(struct.pack("<ii", x, y) for x, y in vertexes))
+
+    refs, first = [], []
+    for lst in linelists:
+        first.append(len(refs))
+        refs.extend(lst)
+    sections.append(b"".join(
+        SECTOR.pack(sec["floor"], sec["ceiling"], *boxes[i], sec["floorpic"], sec["ceilingpic"],
+                    sec["light"], sec["special"], sec["tag"], first[i], len(linelists[i]), 0)
+        for i, sec in enumerate(sectors)))
+    sections.append(b"".join(
+        SIDE.pack(sd["xoff"], sd["yoff"], sd["top"], sd["bottom"], sd["mid"], sd["sector"],
+                  s32(sd["special"] << 16) >> 16)
+        for sd in sides))
+    sections.append(b"".join(
+        LINE.pack(ln["v1"], ln["v2"], ln["flags"], ln["special"], ln["tag"],
+                  ln["sidenum"][0], ln["sidenum"][1], ln["front"],
+                  BAKE_NO_INDEX if ln["back"] is None else ln["back"])
+        for ln in lines))
+    sections.append(b"".join(
+        SEG.pack(sg["linedef"], sg["side"],
+                 sg["offset"], sg["angle"], sg["length"])
+        for sg in segs))
+    sections.append(b"".join(
+        SUBSECTOR.pack(subsector_sector[i], numsegs, first)
+        for i, (numsegs, first) in enumerate(subsectors)))
+    sections.append(struct.pack("<%dH" % len(refs), *refs))
+    sections.append(struct.pack("<%di" % len(blockmap), *blockmap))
+    # P_BuildBSPMirror, after slime trail removal
+    sections.append(b"".join(NODESPLIT.pack(*n[:4]) for n in nodes))
+    sections.append(b"".join(NODECHILDREN.pack(*n[12:]) for n in nodes))
+    sections.append(b"".join(NODEBOX.pack(*n[4:12]) for n in nodes))
+    sections.append(b"".join(
+        SEGVERTS.pack(*vertexes[sg["v1"]], *vertexes[sg["v2"]]) for sg in segs))
+
+    offsets, body, pos = [], b"", HEADER.size
+    for sec in sections:
+        sec += b"\0" * (-len(sec) % 4)
+        offsets.append(pos)
+        body += sec
+        pos += len(sec)
+
+    header = HEADER.pack(BAKE_MAGIC, BAKE_VERSION, texhash, flathash, *[len(l) for l in lumps],
+                         len(vertexes), len(sectors), numsides, len(lines),
+                         len(segs), len(subsectors), len(nodes), len(refs), len(blockmap),
+                         orgx, orgy, bwidth, bheight, *offsets)
+    return header + body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("wad", help="IWAD or PWAD to bake")
+    parser.add_argument("-o", "--output", required=True, help="baked WAD to write")
+    parser.add_argument("--max-size", type=int,
+                        help="largest output in bytes, e.g. the wad partition size")
+    args = parser.parse_args()
+
+    with open(args.wad, "rb") as f:
+        wad = Wad(f.read())
+    if any(n.endswith(BAKE_SUFFIX.encode()) and n[:-2] in wad.names for n in wad.names):
+        sys.exit("%s already has baked levels" % args.wad)
+
+    textures = texture_names(wad)
+    texnum = {}
+    for i, name in enumerate(textures):
+        texnum.setdefault(key(name), i)     # first of a name wins, as in R_InitTextures
+    flatnum = {}
+    for n, i in enumerate(wad.flats):
+        flatnum[wad.names[i]] = n           # last wins, as in W_CheckNumForName
+    texhash = fnv1a(textures)
+    flathash = fnv1a(lumpname(wad.dir[i][2]) for i in wad.flats)
+
+    # Lump data stays where it is; the old directory is dropped when nothing
+    # follows it
+    dirofs = struct.unpack_from("<i", wad.data, 8)[0]
+    if any(pos + lsize > dirofs for pos, lsize, _ in wad.dir):
+        dirofs = len(wad.data)
+    out = bytearray(wad.data[:dirofs])
+    directory = [(pos, size, name) for pos, size, name in wad.dir]
+    size = len(out) + 16 * len(directory)
+    for i, name in enumerate(wad.names):
+        if not re.match(rb"^(E\dM\d|MAP\d\d)$", name):
+            continue
+        if [n.decode() for n in wad.names[i + 1:i + 1 + len(MAP_LUMPS)]] != MAP_LUMPS:
+            continue
+        mapname = name.decode()
+        try:
+            image = bake_map(wad, i, textures, texnum, flatnum, texhash, flathash)
+        except SkipMap as e:
+            print("%-6s skipped: %s" % (mapname, e), file=sys.stderr)
+            continue
+        pad = -len(out) % 4
+        if args.max_size and size + pad + len(image) + 16 > args.max_size:
+            print("%-6s skipped: %d bytes over --max-size" %
+                  (mapname, size + pad + len(image) + 16 - args.max_size), file=sys.stderr)
+            continue
+        out += b"\0" * pad
+        directory.append((len(out), len(image), (mapname + BAKE_SUFFIX).encode().ljust(8, b"\0")))
+        out += image
+        size = len(out) + 16 * len(directory)
+        parsed = sum(wad.dir[i + 1 + k][1] for k in range(1, len(MAP_LUMPS)))
+        print("%-6s %7d bytes (map lumps %d)" % (mapname, len(image), parsed), file=sys.stderr)
+
+    out += b"\0" * (-len(out) % 4)
+    dirofs = len(out)
+    for pos, lsize, name in directory:
+        out += struct.pack("<ii8s", pos, lsize, name)
+    struct.pack_into("<4sii", out, 0, wad.ident, len(directory), dirofs)
+    with open(args.output, "wb") as f:
+        f.write(out)
+    print("%s: %d bytes%s" % (args.output, len(out),
+                              ", %d free" % (args.max_size - len(out)) if args.max_size else ""),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
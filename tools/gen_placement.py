@@ -0,0 +1,376 @@
+#!/usr/bin/env python3
+"""Generate profile-guided IRAM/DRAM placement rules for the engine.
+
+Reads folded stacks from tools/profile_fold.py and the component archives
+from a previous build, then writes an ESP-IDF linker fragment that moves the
+hottest functions into IRAM and the hottest read-only tables into DRAM, each
+within a byte budget:
+
+    tools/profile_fold.py build/esp32-doom.elf doom.prof > doom.folded
+    tools/gen_placement.py doom.folded \\
+        --archive build/esp-idf/prboom/libprboom.a \\
+        --archive build/esp-idf/prboom-wad-tables/libprboom-wad-tables.a \\
+        -o components/prboom/placement.lf
+
+The build can run this step itself, writing build/placement.lf and linking
+with it: idf.py -DDOOM_PLACEMENT_PROFILE=doom.folded build (see
+components/prboom). Copy the result over components/prboom/placement.lf to
+make it the default.
+
+Functions are ranked by self samples per byte, so a small inner loop beats a
+large function with the same sample count. A table is weighted by the samples
+of every sampled function that references it, found from the archive
+relocations. Tables already in RAM (.bss/.data) are reported but need no rule.
+Symbols are keyed by archive:object:name, so same-named statics in different
+objects never stand in for each other; a profiled name that several objects
+define is skipped, since its samples cannot be split between them.
+
+A function named with --keep must exist in its archive when that archive is
+given; a static the compiler inlined has no symbol left to place, so such
+functions are marked PLACEDFUNC (noinline) in the source. Without the
+prboom-wad-tables archive its tables are sized from the .dat files they are
+generated from, which are byte for byte the same on every target.
+
+With --metrics (a saved scrape of the device's /metrics) the report turns
+sample shares into estimated cache misses per second, using the same estimate
+as the instrumentation report: stall cycles / measured miss latency.
+"""
+
+import argparse
+import collections
+import os
+import re
+import subprocess
+import sys
+
+# Flash cache line size on the ESP32
+CACHE_LINE = 32
+
+# The generated tables of prboom-wad-tables, sized from their .dat sources
+WAD_TABLES_ARCHIVE = "libprboom-wad-tables.a"
+WAD_TABLES_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              "..", "components", "prboom-wad-tables")
+
+# Engine globals that point into a table defined elsewhere
+DATA_ALIASES = {
+    "finesine": "SINETABL_dat",
+    "finecosine": "SINETABL_dat",
+    "finetangent": "TANGTABL_dat",
+    "tantoangle": "TANTOANG_dat",
+}
+
+DEFAULT_DATA = ["finetangent", "finesine", "viewangletox", "xtoviewangle"]
+
+# The hand-placed IRAM_ATTR set this tool replaced, plus the world column and
+# span drawers the 8 bit build narrows to; used when no profile is given
+DEFAULT_KEEP = [
+    "libprboom.a:r_bsp:R_AddLine",
+    "libprboom.a:r_segs:R_RenderMaskedSegRange",
+    "libprboom.a:r_segs:R_RenderSegLoop",
+    "libprboom.a:r_plane:R_MapPlane",
+    "libprboom.a:r_plane:R_FindPlane",
+    "libprboom.a:r_plane:R_DoDrawPlane",
+    "libprboom.a:v_video:V_DrawMemPatch",
+    "libprboom.a:r_draw:R_DrawColumn8_PointUV_PointZ",
+    "libprboom.a:r_draw:R_DrawSpan8_PointUV_PointZ",
+]
+
+
+class Symbol:
+    def __init__(self, archive, obj, name, size, kind):
+        self.archive = archive
+        self.obj = obj
+        self.name = name
+        self.size = size
+        self.kind = kind
+
+    @property
+    def rule(self):
+        return "%s:%s" % (self.obj, self.name)
+
+    @property
+    def key(self):
+        return "%s:%s:%s" % (self.archive, self.obj, self.name)
+
+
+def object_name(member):
+    """r_segs.c.obj / r_segs.o -> r_segs, the name linker fragments use."""
+    return re.sub(r"(\.c)?\.(obj|o)$", "", member)
+
+
+def read_symbols(nm, archive):
+    """Defined symbols with sizes: {archive:object:name: Symbol}."""
+    out = subprocess.run([nm, "-A", "-S", "--defined-only", archive],
+                         capture_output=True, text=True, check=True).stdout
+    symbols = {}
+    lib = os.path.basename(archive)
+    for line in out.splitlines():
+        # libprboom.a:r_segs.c.obj:00000000 00000120 t R_RenderSegLoop
+        m = re.match(r"^[^:]+:([^:]+):\s*[0-9a-fA-F]+\s+([0-9a-fA-F]+)\s+(\w)\s+(\S+)$", line)
+        if m:
+            member, size, kind, name = m.groups()
+            sym = Symbol(lib, object_name(member), name, int(size, 16), kind)
+            symbols[sym.key] = sym
+    return symbols
+
+
+def read_wad_tables():
+    """The prboom-wad-tables arrays, sized from the .dat files they embed."""
+    symbols = {}
+    for entry in sorted(os.listdir(WAD_TABLES_DIR)):
+        stem, ext = os.path.splitext(entry)
+        if ext == ".dat":
+            size = os.path.getsize(os.path.join(WAD_TABLES_DIR, entry))
+            sym = Symbol(WAD_TABLES_ARCHIVE, stem, stem + "_dat", size, "R")
+            symbols[sym.key] = sym
+    return symbols
+
+
+def read_references(objdump, archive):
+    """Relocations per function section: {archive:object:function: set(symbols)}."""
+    out = subprocess.run([objdump, "-r", archive],
+                         capture_output=True, text=True, check=True).stdout
+    refs = collections.defaultdict(set)
+    lib = os.path.basename(archive)
+    obj = None
+    section = None
+    for line in out.splitlines():
+        m = re.match(r"^(\S+):\s+file format", line)
+        if m:
+            obj = object_name(m.group(1))
+            section = None
+            continue
+        m = re.match(r"^RELOCATION RECORDS FOR \[\.(?:text|literal)\.([^\]]+)\]:", line)
+        if m:
+            section = "%s:%s:%s" % (lib, obj, m.group(1))
+            continue
+        if line.startswith("RELOCATION RECORDS"):
+            section = None
+            continue
+        if section:
+            fields = line.split()
+            if len(fields) >= 3 and re.match(r"^[0-9a-fA-F]+$", fields[0]):
+                target = re.sub(r"[+-]0x[0-9a-fA-F]+$", "", fields[2])
+                refs[section].add(re.sub(r"^\.(?:rodata|data|bss)\.", "", target))
+    return refs
+
+
+def read_metrics(path):
+    """Stall cycles, miss latency and uptime from a /metrics scrape."""
+    stalls = collections.Counter()
+    latency = uptime = 0
+    with open(path) as f:
+        for line in f:
+            m = re.match(r'^doom_phase_cycles_total\{phase="(\w+)",kind="(\w+)"\}\s+(\d+)', line)
+            if m and m.group(1) in ("sim", "render"):
+                stalls[m.group(2)] += int(m.group(3))
+            m = re.match(r"^doom_psram_miss_latency_cycles\s+(\d+)", line)
+            if m:
+                latency = int(m.group(1))
+            m = re.match(r"^doom_uptime_seconds\s+(\d+)", line)
+            if m:
+                uptime = int(m.group(1))
+    if not latency or not uptime:
+        sys.exit("error: %s has no miss latency or uptime; scrape /metrics "
+                 "from a device with performance counters" % path)
+    return stalls["istall"] / latency / uptime, stalls["dstall"] / latency / uptime
+
+
+def read_folded(path):
+    """Self and inclusive samples per function from folded stacks."""
+    self_samples = collections.Counter()
+    incl_samples = collections.Counter()
+    total = 0
+    with open(path) as f:
+        for line in f:
+            stack, _, count = line.rstrip("\n").rpartition(" ")
+            if not stack:
+                continue
+            count = int(count)
+            frames = stack.split(";")
+            total += count
+            self_samples[frames[-1]] += count
+            for name in set(frames):
+                incl_samples[name] += count
+    return self_samples, incl_samples, total
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("profile", nargs="?", help="folded stacks from tools/profile_fold.py")
+    parser.add_argument("--archive", action="append", default=[],
+                        help="component archive to place symbols from (repeatable)")
+    parser.add_argument("-o", "--output", help="linker fragment to write (default: stdout)")
+    parser.add_argument("--iram-budget", type=int, default=12 * 1024,
+                        help="bytes of IRAM to fill (default: %(default)s)")
+    parser.add_argument("--dram-budget", type=int, default=20 * 1024,
+                        help="bytes of DRAM for tables (default: %(default)s)")
+    parser.add_argument("--data", action="append",
+                        help="candidate table for DRAM (repeatable, default: %s)" % ", ".join(DEFAULT_DATA))
+    parser.add_argument("--keep", action="append", default=[],
+                        help="archive:object:function always placed in IRAM (repeatable)")
+    parser.add_argument("--min-samples", type=int, default=2,
+                        help="ignore functions with fewer self samples (default: %(default)s)")
+    parser.add_argument("--metrics", help="saved /metrics scrape, to estimate cache misses saved")
+    parser.add_argument("--nm", default="xtensa-esp32-elf-nm")
+    parser.add_argument("--objdump", default="xtensa-esp32-elf-objdump")
+    args = parser.parse_args()
+
+    symbols = {}
+    refs = collections.defaultdict(set)
+    archives = {os.path.basename(a) for a in args.archive}
+    for archive in args.archive:
+        symbols.update(read_symbols(args.nm, archive))
+        for func, targets in read_references(args.objdump, archive).items():
+            refs[func] |= targets
+    if WAD_TABLES_ARCHIVE not in archives:
+        symbols.update(read_wad_tables())
+
+    # Profiles and relocations name symbols without their object
+    by_name = collections.defaultdict(list)
+    for sym in symbols.values():
+        by_name[sym.name].append(sym)
+
+    if args.profile:
+        self_samples, incl_samples, total = read_folded(args.profile)
+        keep = args.keep
+    else:
+        self_samples, incl_samples, total = collections.Counter(), collections.Counter(), 0
+        keep = args.keep or DEFAULT_KEEP
+
+    # --- Functions -> IRAM ---------------------------------------------------
+    placed_text = []
+    iram_used = 0
+    for entry in keep:
+        lib, obj, name = entry.split(":")
+        sym = symbols.get(entry)
+        if sym is None and lib in archives:
+            sys.exit("error: %s is not in %s; if it is a static the compiler "
+                     "inlined, mark it PLACEDFUNC" % (entry, lib))
+        placed_text.append(sym or Symbol(lib, obj, name, 0, "t"))
+        iram_used += sym.size if sym else 0
+
+    candidates = []
+    ambiguous = []
+    for name, n in self_samples.items():
+        found = [sym for sym in by_name.get(name, []) if sym.kind in "tT" and sym.size > 0]
+        if len(found) > 1:
+            ambiguous.append(name)
+        elif found and n >= args.min_samples:
+            candidates.append(found[0])
+    candidates.sort(key=lambda s: self_samples[s.name] / s.size, reverse=True)
+    kept = {s.key for s in placed_text}
+    skipped_text = []
+    for sym in candidates:
+        if sym.key in kept:
+            continue
+        if iram_used + sym.size > args.iram_budget:
+            skipped_text.append(sym)
+            continue
+        placed_text.append(sym)
+        iram_used += sym.size
+    if ambiguous:
+        print("warning: %d profiled names are defined in several objects and were "
+              "not placed (%s)" % (len(ambiguous), ", ".join(sorted(ambiguous))), file=sys.stderr)
+
+    # --- Tables -> DRAM ------------------------------------------------------
+    data_weight = collections.Counter()
+    for func, targets in refs.items():
+        name = func.rsplit(":", 1)[1]
+        if len(by_name.get(name, [])) > 1:
+            continue
+        for target in targets:
+            data_weight[DATA_ALIASES.get(target, target)] += incl_samples.get(name, 0)
+
+    placed_data = []
+    in_ram = []
+    skipped_data = []
+    dram_used = 0
+    wanted = [DATA_ALIASES.get(d, d) for d in (args.data or DEFAULT_DATA)]
+    wanted = sorted(dict.fromkeys(wanted), key=lambda d: data_weight[d], reverse=True)
+    for name in wanted:
+        found = [sym for sym in by_name.get(name, []) if sym.kind not in "tT"]
+        sym = found[0] if len(found) == 1 else None
+        if not found:
+            skipped_data.append((name, "not found in archives"))
+        elif sym is None:
+            skipped_data.append((name, "defined in %d objects" % len(found)))
+        elif sym.kind in "bBdD":
+            in_ram.append(sym)
+        elif dram_used + sym.size > args.dram_budget:
+            skipped_data.append((name, "%d bytes over budget" % sym.size))
+        else:
+            placed_data.append(sym)
+            dram_used += sym.size
+
+    # --- Fragment ------------------------------------------------------------
+    # A rule for a symbol the archives did not size still places it, but the
+    # budget it uses is unknown; never report that as 0 bytes
+    unsized = [s for s in placed_text if s.size == 0]
+    if unsized:
+        iram = "IRAM unknown/%d bytes (%d of %d functions not sized)" % (
+            args.iram_budget, len(unsized), len(placed_text))
+        print("warning: %d placed functions not found in the archives (%s); "
+              "pass --archive from a build for their sizes" %
+              (len(unsized), ", ".join(s.name for s in unsized)), file=sys.stderr)
+    else:
+        iram = "IRAM %d/%d bytes" % (iram_used, args.iram_budget)
+    dram = "DRAM %d/%d bytes" % (dram_used, args.dram_budget)
+    lines = [
+        "# Generated by tools/gen_placement.py - do not edit by hand.",
+        "# Profile: %s" % (os.path.basename(args.profile) if args.profile else "none (default hot set)"),
+        "# %s, %s" % (iram, dram),
+    ]
+    by_archive = collections.defaultdict(list)
+    for sym in placed_text:
+        by_archive[sym.archive].append("%s (noflash)" % sym.rule)
+    for sym in placed_data:
+        by_archive[sym.archive].append("%s (noflash_data)" % sym.rule)
+    for lib in sorted(by_archive):
+        mapping = re.sub(r"\W", "_", re.sub(r"^lib|\.a$", "", lib))
+        lines += ["", "[mapping:%s_placement]" % mapping, "archive: %s" % lib, "entries:"]
+        lines += ["    %s" % e for e in by_archive[lib]]
+    text = "\n".join(lines) + "\n"
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+    # --- Report --------------------------------------------------------------
+    def pct(n):
+        return 100.0 * n / total if total else 0.0
+
+    report = sys.stderr
+    moved = sum(self_samples.get(s.name, 0) for s in placed_text)
+    print("IRAM: %d functions, %d bytes (%d flash cache lines)" %
+          (len(placed_text), iram_used, (iram_used + CACHE_LINE - 1) // CACHE_LINE), file=report)
+    for sym in placed_text:
+        print("  %-32s %6d B %6d samples %5.1f%%" %
+              (sym.name, sym.size, self_samples.get(sym.name, 0), pct(self_samples.get(sym.name, 0))), file=report)
+    for sym in skipped_text[:5]:
+        print("  (over budget) %-18s %6d B %6d samples" % (sym.name, sym.size, self_samples[sym.name]), file=report)
+    print("DRAM: %d tables, %d bytes" % (len(placed_data), dram_used), file=report)
+    for sym in placed_data:
+        print("  %-32s %6d B referenced by %5.1f%% of samples" % (sym.name, sym.size, pct(data_weight[sym.name])), file=report)
+    for sym in in_ram:
+        print("  %-32s %6d B already in RAM (%s)" % (sym.name, sym.size, ".bss" if sym.kind in "bB" else ".data"), file=report)
+    for name, why in skipped_data:
+        print("  %-32s skipped: %s" % (name, why), file=report)
+    if total and args.metrics:
+        # Stalls are assumed to fall where the samples do
+        imiss, dmiss = read_metrics(args.metrics)
+        table_share = pct(max([data_weight[s.name] for s in placed_data] or [0])) / 100
+        print("Expected: ~%.0f of %.0f instruction fetch misses/s saved (%.1f%% of samples"
+              " in placed code); tables above are read by %.1f%% of samples, up to"
+              " ~%.0f of %.0f data misses/s" %
+              (imiss * pct(moved) / 100, imiss, pct(moved), 100 * table_share,
+               dmiss * table_share, dmiss), file=report)
+    elif total:
+        print("Expected: %.1f%% of engine samples no longer fetch code through the flash cache;"
+              " pass --metrics for cache misses" % pct(moved), file=report)
+
+
+if __name__ == "__main__":
+    main()
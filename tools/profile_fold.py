@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Fold a sampling profile from /profile into flamegraph input.
+
+Reads the binary download written by perf_profiler_read(), symbolizes every
+PC against the firmware ELF with addr2line and prints one line per unique
+stack in the folded format understood by flamegraph.pl, inferno and
+speedscope:
+
+    doom;D_DoomLoop;D_Display;R_RenderPlayerView;R_DrawColumn 412
+
+Usage:
+    curl 'http://<device-ip>/profile?cmd=start'
+    curl 'http://<device-ip>/profile?cmd=stop'
+    curl -o doom.prof 'http://<device-ip>/profile'
+    tools/profile_fold.py build/esp32-doom.elf doom.prof > doom.folded
+    flamegraph.pl doom.folded > doom.svg
+
+Host builds write the same format with perf_profiler_write_file(); pass
+--addr2line addr2line to symbolize them.
+"""
+
+import argparse
+import collections
+import struct
+import subprocess
+import sys
+
+MAGIC = b"DPRF"
+FORMAT_VERSION = 1
+TASK_NAME_LEN = 16
+FLAG_IDLE = 0x01
+FLAG_TRUNCATED = 0x02
+
+
+def parse_profile(data):
+    """Return (header dict, task names, list of (task, flags, pcs leaf-first))."""
+    if data[:4] != MAGIC:
+        raise ValueError("not a profile download (bad magic)")
+    version, max_depth, hz, dropped, load_base, task_count = struct.unpack_from("<HHIIQI", data, 4)
+    if version != FORMAT_VERSION:
+        raise ValueError("unsupported profile version %d" % version)
+    off = 28
+    tasks = []
+    for _ in range(task_count):
+        raw = data[off:off + TASK_NAME_LEN]
+        tasks.append(raw.split(b"\0", 1)[0].decode("ascii", "replace") or "?")
+        off += TASK_NAME_LEN
+    (count,) = struct.unpack_from("<I", data, off)
+    off += 4
+    samples = []
+    for _ in range(count):
+        depth, flags, task, _reserved = struct.unpack_from("<BBBB", data, off)
+        off += 4
+        pcs = struct.unpack_from("<%dI" % depth, data, off)
+        off += 4 * depth
+        samples.append((task, flags, pcs))
+    header = {"max_depth": max_depth, "hz": hz, "dropped": dropped, "load_base": load_base}
+    return header, tasks, samples
+
+
+def symbolize(addr2line, elf, addresses):
+    """Map each address to a function name using one addr2line process."""
+    addresses = sorted(addresses)
+    if not addresses:
+        return {}
+    query = "\n".join("0x%x" % a for a in addresses) + "\n"
+    out = subprocess.run([addr2line, "-f", "-C", "-e", elf], input=query,
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    # addr2line prints "function\nfile:line" per address
+    names = {}
+    for i, addr in enumerate(addresses):
+        name = out[2 * i] if 2 * i < len(out) else "??"
+        names[addr] = name if name != "??" else "0x%x" % addr
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("elf", help="firmware ELF the samples were taken from")
+    parser.add_argument("profile", help="binary profile downloaded from /profile")
+    parser.add_argument("--addr2line", default="xtensa-esp32-elf-addr2line",
+                        help="addr2line binary for the target (default: %(default)s)")
+    parser.add_argument("--include-idle", action="store_true",
+                        help="keep samples taken while the idle task was running")
+    parser.add_argument("--no-task", action="store_true",
+                        help="do not prefix stacks with the task name")
+    args = parser.parse_args()
+
+    with open(args.profile, "rb") as f:
+        header, tasks, samples = parse_profile(f.read())
+
+    if not args.include_idle:
+        samples = [s for s in samples if not s[1] & FLAG_IDLE]
+
+    names = symbolize(args.addr2line, args.elf, {pc for _, _, pcs in samples for pc in pcs})
+
+    folded = collections.Counter()
+    for task, flags, pcs in samples:
+        frames = [names[pc] for pc in reversed(pcs)]
+        if flags & FLAG_TRUNCATED:
+            frames.insert(0, "[truncated]")
+        if not args.no_task:
+            frames.insert(0, tasks[task] if task < len(tasks) else "task%d" % task)
+        folded[";".join(frames) or "[unknown]"] += 1
+
+    for stack, count in sorted(folded.items()):
+        print("%s %d" % (stack, count))
+
+    print("%d samples at %d Hz, %d dropped, %d stacks" %
+          (len(samples), header["hz"], header["dropped"], len(folded)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
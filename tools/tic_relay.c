@@ -0,0 +1,823 @@
+/*
+ * Tic relay for PrBoom network games, and a headless test client for it.
+ *
+ * The relay plays the role of prboom_server: players join with PKT_INIT, get
+ * the game settings in PKT_SETUP, and the game starts once every seat has
+ * sent PKT_GO. From then on each player sends its ticcmds (PKT_TICC) and the
+ * relay sends back every tic all players have supplied (PKT_TICS). Packets
+ * carry several tics at once. The last `extratic` tics are repeated in every
+ * packet in both directions, so one lost datagram usually costs nothing.
+ * Gaps are repaired with PKT_RETRANS.
+ *
+ * Every few seconds the relay prints per-player bandwidth and lag. Lag is how
+ * long after the first player's copy of a tic this player's copy arrived.
+ * Hold is how long the relay had to keep a tic before all players had it.
+ *
+ * The test client (-connect) speaks the same protocol as d_client.c. It sends
+ * synthetic ticcmds derived from (player, tic), runs every tic it gets back,
+ * and checks all players' commands against that formula. It reports its tic
+ * round trip. Several of them on localhost make a multiplayer game without
+ * any hardware:
+ *
+ *   cc -O2 -o tic_relay tools/tic_relay.c
+ *   ./tic_relay -N 3 -x 1 &
+ *   ./tic_relay -connect 127.0.0.1 -time 20 -loss 5 &
+ *   ./tic_relay -connect 127.0.0.1 -time 20 &
+ *   ./tic_relay -connect 127.0.0.1 -time 20
+ *
+ * Options:
+ *   -p port       UDP port (5030)
+ *   -N players    seats to fill before the game starts (2)
+ *   -x extratic   tics repeated in every packet (1)
+ *   -c complevel  compatibility level (3, Ultimate Doom)
+ *   -s skill -e episode -l level -d deathmatch
+ *   -i seconds    report interval (5)
+ *   -loss percent drop this share of outgoing packets (testing)
+ *   -connect host[:port] [-time seconds]   run as a test client
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Wire format, from components/prboom/include/protocol.h */
+enum {
+  PKT_INIT, PKT_SETUP, PKT_GO, PKT_TICC, PKT_TICS, PKT_RETRANS,
+  PKT_EXTRA, PKT_QUIT, PKT_DOWN, PKT_WAD, PKT_BACKOFF,
+};
+
+typedef struct {
+  uint8_t checksum;
+  uint8_t type;
+  uint8_t reserved[2];
+  uint32_t tic;         /* network order */
+} __attribute__((packed)) packet_header_t;
+
+#define HEADER_SIZE       sizeof(packet_header_t)
+#define TICCMD_SIZE       8     /* sizeof(ticcmd_t) */
+#define GAME_OPTIONS_SIZE 64
+#define SETUP_SIZE        (9 + GAME_OPTIONS_SIZE + 1)
+#define MAXPLAYERS        4
+#define BACKUPTICS        12    /* doomstat.h */
+#define TICRATE           35
+#define DEFAULT_PORT      5030
+#define MAX_PACKET        1400
+
+#define TIC_RING          256   /* tics the relay keeps per player */
+#define MAX_SEND_TICS     (BACKUPTICS - 1)
+#define BACKOFF_TICS      (BACKUPTICS / 2)
+
+static int sock = -1;
+static int loss_percent;
+static volatile sig_atomic_t quit_requested;
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Same sum as ChecksumPacket in i_network.c: every byte after the first */
+static uint8_t checksum(const uint8_t *p, size_t len)
+{
+  uint8_t sum = 0;
+  size_t i;
+
+  for (i = 1; i < len; i++)
+    sum += p[i];
+  return sum;
+}
+
+static void packet_set(uint8_t *buf, int type, unsigned tic)
+{
+  packet_header_t *h = (packet_header_t *)buf;
+  h->type = type;
+  h->reserved[0] = h->reserved[1] = 0;
+  h->tic = htonl(tic);
+}
+
+static unsigned packet_tic(const uint8_t *buf)
+{
+  return ntohl(((const packet_header_t *)buf)->tic);
+}
+
+/* Returns bytes put on the wire (0 if the loss simulation ate the packet) */
+static size_t send_packet(uint8_t *buf, size_t len, const struct sockaddr_in *to)
+{
+  buf[0] = checksum(buf, len);
+  if (loss_percent && rand() % 100 < loss_percent)
+    return 0;
+  if (sendto(sock, buf, len, 0, (const struct sockaddr *)to, sizeof *to) != (ssize_t)len)
+    return 0;
+  return len;
+}
+
+/* Next valid packet without blocking, -1 when there is none */
+static ssize_t recv_packet(uint8_t *buf, size_t len, struct sockaddr_in *from)
+{
+  for (;;) {
+    socklen_t fromlen = sizeof *from;
+    ssize_t n = recvfrom(sock, buf, len, MSG_DONTWAIT, (struct sockaddr *)from, &fromlen);
+
+    if (n < 0)
+      return -1;
+    if (n >= (ssize_t)HEADER_SIZE && buf[0] == checksum(buf, n))
+      return n;
+  }
+}
+
+static void wait_readable(int ms)
+{
+  struct timeval tv = { ms / 1000, (ms % 1000) * 1000 };
+  fd_set fds;
+
+  FD_ZERO(&fds);
+  FD_SET(sock, &fds);
+  select(sock + 1, &fds, NULL, NULL, &tv);
+}
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  quit_requested = 1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Relay                                                                  */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+  int joined;
+  int ready;                    /* sent PKT_GO */
+  int playing;                  /* cleared on PKT_QUIT */
+  struct sockaddr_in addr;
+  unsigned from;                /* next tic expected from the player */
+  unsigned to;                  /* next tic the player needs from us */
+  unsigned quit_tic;            /* first tic without this player */
+  uint8_t cmds[TIC_RING][TICCMD_SIZE];
+  uint64_t arrived[TIC_RING];   /* first arrival of each tic */
+
+  /* statistics, reset every report */
+  uint64_t bytes_in, bytes_out;
+  unsigned packets_in, packets_out;
+  unsigned tics_in, tics_dup;
+  unsigned retrans_sent, retrans_recv, backoffs;
+  uint64_t lag_sum_us, lag_max_us;
+  unsigned lag_count;
+} relay_player_t;
+
+static struct {
+  int players;
+  int extratic;
+  int complevel, skill, episode, level, deathmatch;
+  int started;
+  unsigned rngseed;             /* one seed for everybody */
+  unsigned curtic;              /* every tic before this one is complete */
+  uint64_t first_arrival[TIC_RING];
+  uint64_t hold_sum_us, hold_max_us;
+  unsigned hold_count;
+  relay_player_t p[MAXPLAYERS];
+} relay;
+
+static int relay_find(const struct sockaddr_in *from)
+{
+  int i;
+
+  for (i = 0; i < relay.players; i++)
+    if (relay.p[i].joined && relay.p[i].addr.sin_addr.s_addr == from->sin_addr.s_addr &&
+        relay.p[i].addr.sin_port == from->sin_port)
+      return i;
+  return -1;
+}
+
+static void relay_send(int n, uint8_t *buf, size_t len)
+{
+  size_t sent = send_packet(buf, len, &relay.p[n].addr);
+
+  relay.p[n].bytes_out += sent;
+  relay.p[n].packets_out += sent != 0;
+}
+
+static void relay_send_setup(int n)
+{
+  uint8_t buf[HEADER_SIZE + SETUP_SIZE];
+  uint8_t *s = buf + HEADER_SIZE;
+  uint8_t *o = s + 9;
+  unsigned seed = relay.rngseed;
+
+  memset(buf, 0, sizeof buf);
+  packet_set(buf, PKT_SETUP, 0);
+  s[0] = relay.players;
+  s[1] = n;
+  s[2] = relay.skill;
+  s[3] = relay.episode;
+  s[4] = relay.level;
+  s[5] = relay.deathmatch;
+  s[6] = relay.complevel;
+  s[7] = 1;                     /* ticdup */
+  s[8] = relay.extratic;
+
+  /* G_WriteOptions layout with the engine defaults; every client reads the
+   * same bytes, which is all that matters for sync */
+  o[0] = 1;                     /* monsters_remember */
+  o[1] = 1;                     /* variable_friction */
+  o[2] = 0;                     /* weapon_recoil */
+  o[3] = 1;                     /* allow_pushers */
+  o[5] = 1;                     /* player_bobbing */
+  o[10] = seed >> 24;           /* rngseed */
+  o[11] = seed >> 16;
+  o[12] = seed >> 8;
+  o[13] = seed;
+  o[14] = 1;                    /* monster_infighting */
+  o[18] = 0;                    /* distfriend = 128 */
+  o[19] = 128;
+  o[21] = 1;                    /* monster_avoid_hazards */
+  o[22] = 1;                    /* monster_friction */
+  o[23] = 1;                    /* help_friends */
+  o[24] = 1;                    /* dog_jumping */
+  s[9 + GAME_OPTIONS_SIZE] = 0; /* numwads */
+  relay_send(n, buf, sizeof buf);
+}
+
+static void relay_broadcast(uint8_t *buf, size_t len, int except)
+{
+  int i;
+
+  for (i = 0; i < relay.players; i++)
+    if (i != except && relay.p[i].joined)
+      relay_send(i, buf, len);
+}
+
+static int relay_in_tic(int n, unsigned tic)
+{
+  return relay.p[n].playing || tic < relay.p[n].quit_tic;
+}
+
+/* Advance curtic over every tic all players have supplied */
+static void relay_update_curtic(void)
+{
+  uint64_t now = now_us();
+  int i;
+
+  for (;;) {
+    unsigned tic = relay.curtic;
+    uint64_t first = relay.first_arrival[tic % TIC_RING];
+    int any = 0;
+
+    for (i = 0; i < relay.players; i++) {
+      if (!relay_in_tic(i, tic))
+        continue;
+      if (relay.p[i].from <= tic)
+        return;
+      any = 1;
+    }
+    if (!any)
+      return;
+
+    for (i = 0; i < relay.players; i++) {
+      relay_player_t *p = &relay.p[i];
+      uint64_t lag;
+
+      if (!relay_in_tic(i, tic))
+        continue;
+      lag = p->arrived[tic % TIC_RING] - first;
+      p->lag_sum_us += lag;
+      p->lag_count++;
+      if (lag > p->lag_max_us)
+        p->lag_max_us = lag;
+    }
+    relay.hold_sum_us += now - first;
+    relay.hold_count++;
+    if (now - first > relay.hold_max_us)
+      relay.hold_max_us = now - first;
+    relay.curtic++;
+  }
+}
+
+/* Send player n everything it lacks, plus extratic tics again */
+static void relay_send_tics(int n)
+{
+  relay_player_t *p = &relay.p[n];
+  uint8_t buf[MAX_PACKET];
+  uint8_t *o = buf + HEADER_SIZE + 1;
+  unsigned start, tic, count;
+  int i;
+
+  if (!p->playing || p->to >= relay.curtic)
+    return;
+
+  start = p->to > (unsigned)relay.extratic ? p->to - relay.extratic : 0;
+  if (relay.curtic - start > MAX_SEND_TICS)
+    start = relay.curtic - MAX_SEND_TICS;
+  count = relay.curtic - start;
+
+  packet_set(buf, PKT_TICS, start);
+  buf[HEADER_SIZE] = count;
+  for (tic = start; tic < relay.curtic; tic++) {
+    uint8_t *nplayers = o++;
+    *nplayers = 0;
+    for (i = 0; i < relay.players; i++) {
+      if (!relay_in_tic(i, tic))
+        continue;
+      *o++ = i;
+      memcpy(o, relay.p[i].cmds[tic % TIC_RING], TICCMD_SIZE);
+      o += TICCMD_SIZE;
+      (*nplayers)++;
+    }
+  }
+  relay_send(n, buf, o - buf);
+  p->to = relay.curtic;
+}
+
+static void relay_ticc(int n, const uint8_t *buf, size_t len)
+{
+  relay_player_t *p = &relay.p[n];
+  unsigned tic = packet_tic(buf);
+  unsigned count, i;
+  uint64_t now = now_us();
+  uint8_t reply[HEADER_SIZE + 1];
+
+  if (len < HEADER_SIZE + 2)
+    return;
+  count = buf[HEADER_SIZE];
+  if (len < HEADER_SIZE + 2 + count * TICCMD_SIZE)
+    return;
+
+  if (tic > p->from) {
+    /* Missed some: ask for everything from the gap on */
+    packet_set(reply, PKT_RETRANS, p->from);
+    reply[HEADER_SIZE] = n;
+    relay_send(n, reply, sizeof reply);
+    p->retrans_sent++;
+    return;
+  }
+
+  for (i = 0; i < count; i++, tic++) {
+    if (tic < p->from) {
+      p->tics_dup++;
+      continue;
+    }
+    if (tic - relay.curtic >= TIC_RING)
+      break;                    /* far ahead of the slowest player */
+    memcpy(p->cmds[tic % TIC_RING], buf + HEADER_SIZE + 2 + i * TICCMD_SIZE, TICCMD_SIZE);
+    p->arrived[tic % TIC_RING] = now;
+    if (tic >= relay.curtic) {
+      int j, first = 1;
+      for (j = 0; j < relay.players; j++)
+        if (j != n && relay.p[j].from > tic)
+          first = 0;
+      if (first)
+        relay.first_arrival[tic % TIC_RING] = now;
+    }
+    p->from = tic + 1;
+    p->tics_in++;
+  }
+
+  relay_update_curtic();
+  for (i = 0; i < (unsigned)relay.players; i++)
+    relay_send_tics(i);
+
+  /* Running far ahead of the others only fills our buffers */
+  if (p->from > relay.curtic + BACKOFF_TICS) {
+    packet_set(reply, PKT_BACKOFF, relay.curtic);
+    reply[HEADER_SIZE] = n;
+    relay_send(n, reply, sizeof reply);
+    p->backoffs++;
+  }
+}
+
+static void relay_report(double seconds)
+{
+  int i;
+
+  printf("tic %u, hold avg %.1f ms max %.1f ms\n", relay.curtic,
+         relay.hold_count ? relay.hold_sum_us / 1000.0 / relay.hold_count : 0.0,
+         relay.hold_max_us / 1000.0);
+  printf("  pl  address               in B/s  out B/s  pkt in/out   tics  dup  lag avg/max ms  retrans  backoff\n");
+  for (i = 0; i < relay.players; i++) {
+    relay_player_t *p = &relay.p[i];
+    char addr[32];
+
+    if (!p->joined)
+      continue;
+    snprintf(addr, sizeof addr, "%s:%d", inet_ntoa(p->addr.sin_addr), ntohs(p->addr.sin_port));
+    printf("  %d%c %-21s %7.0f  %7.0f  %5u/%-5u %5u %4u  %6.1f/%-6.1f  %3u/%-3u  %u\n",
+           i + 1, p->playing ? ' ' : '-', addr,
+           p->bytes_in / seconds, p->bytes_out / seconds, p->packets_in, p->packets_out,
+           p->tics_in, p->tics_dup,
+           p->lag_count ? p->lag_sum_us / 1000.0 / p->lag_count : 0.0, p->lag_max_us / 1000.0,
+           p->retrans_sent, p->retrans_recv, p->backoffs);
+    p->bytes_in = p->bytes_out = 0;
+    p->packets_in = p->packets_out = p->tics_in = p->tics_dup = 0;
+    p->retrans_sent = p->retrans_recv = p->backoffs = 0;
+    p->lag_sum_us = p->lag_max_us = 0;
+    p->lag_count = 0;
+  }
+  relay.hold_sum_us = relay.hold_max_us = 0;
+  relay.hold_count = 0;
+  fflush(stdout);
+}
+
+static int relay_run(int port, int interval)
+{
+  struct sockaddr_in addr;
+  uint8_t buf[MAX_PACKET];
+  uint64_t last_report = now_us();
+  int i, remaining;
+
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(sock, (struct sockaddr *)&addr, sizeof addr) < 0) {
+    perror("bind");
+    return 1;
+  }
+  printf("tic relay on port %d: %d players, extratic %d, complevel %d\n",
+         port, relay.players, relay.extratic, relay.complevel);
+  fflush(stdout);
+
+  while (!quit_requested) {
+    struct sockaddr_in from;
+    ssize_t len;
+    int n;
+
+    wait_readable(100);
+    while ((len = recv_packet(buf, sizeof buf, &from)) > 0) {
+      packet_header_t *h = (packet_header_t *)buf;
+
+      n = relay_find(&from);
+      if (n >= 0) {
+        relay.p[n].bytes_in += len;
+        relay.p[n].packets_in++;
+      }
+
+      switch (h->type) {
+      case PKT_INIT:
+        if (n < 0 && !relay.started) {
+          int want = len >= (ssize_t)HEADER_SIZE + 2 ? ntohs(*(uint16_t *)(buf + HEADER_SIZE)) : 0;
+          if (want < 0 || want >= relay.players || relay.p[want].joined)
+            for (want = 0; want < relay.players && relay.p[want].joined; want++)
+              ;
+          if (want == relay.players)
+            break;              /* game full */
+          n = want;
+          memset(&relay.p[n], 0, sizeof relay.p[n]);
+          relay.p[n].joined = relay.p[n].playing = 1;
+          relay.p[n].addr = from;
+          printf("player %d joined from %s:%d\n", n + 1, inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+          fflush(stdout);
+        }
+        if (n >= 0)
+          relay_send_setup(n);
+        break;
+
+      case PKT_GO:
+        if (n < 0)
+          break;
+        relay.p[n].ready = 1;
+        if (!relay.started) {
+          for (i = 0; i < relay.players && relay.p[i].ready; i++)
+            ;
+          if (i < relay.players)
+            break;
+          relay.started = 1;
+          printf("all %d players ready, game started\n", relay.players);
+          fflush(stdout);
+          packet_set(buf, PKT_GO, 0);
+          relay_broadcast(buf, HEADER_SIZE, -1);
+        } else {
+          /* Our GO got lost on the way to this one */
+          packet_set(buf, PKT_GO, 0);
+          relay_send(n, buf, HEADER_SIZE);
+        }
+        break;
+
+      case PKT_TICC:
+        if (n >= 0 && relay.started && relay.p[n].playing)
+          relay_ticc(n, buf, len);
+        break;
+
+      case PKT_RETRANS:
+        if (n >= 0 && relay.p[n].playing) {
+          relay.p[n].to = packet_tic(buf);
+          relay.p[n].retrans_recv++;
+          relay_send_tics(n);
+        }
+        break;
+
+      case PKT_EXTRA:
+        if (n >= 0)
+          relay_broadcast(buf, len, n);
+        break;
+
+      case PKT_QUIT:
+        if (n >= 0 && relay.p[n].playing) {
+          relay.p[n].playing = 0;
+          relay.p[n].quit_tic = relay.p[n].from;
+          printf("player %d quit at tic %u\n", n + 1, relay.p[n].quit_tic);
+          fflush(stdout);
+          /* The others drop the player at the first tic we will send without it */
+          packet_set(buf, PKT_QUIT, relay.p[n].quit_tic);
+          buf[HEADER_SIZE] = n;
+          relay_broadcast(buf, HEADER_SIZE + 1, n);
+          relay_update_curtic();
+          for (i = 0; i < relay.players; i++)
+            relay_send_tics(i);
+        }
+        break;
+
+      default:
+        break;
+      }
+    }
+
+    if (now_us() - last_report >= (uint64_t)interval * 1000000) {
+      relay_report((now_us() - last_report) / 1e6);
+      last_report = now_us();
+    }
+
+    if (relay.started) {
+      for (remaining = 0, i = 0; i < relay.players; i++)
+        remaining += relay.p[i].playing;
+      if (!remaining)
+        break;
+    }
+  }
+
+  if (quit_requested) {
+    packet_set(buf, PKT_DOWN, 0);
+    relay_broadcast(buf, HEADER_SIZE, -1);
+  }
+  relay_report((now_us() - last_report) / 1e6);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test client                                                            */
+/* ---------------------------------------------------------------------- */
+
+/* Deterministic ticcmd so every client can check every other player's */
+static void bot_cmd(uint8_t *cmd, int player, unsigned tic)
+{
+  uint32_t x = (tic + 1) * 2654435761u ^ (player + 1) * 40503u;
+  int i;
+
+  for (i = 0; i < TICCMD_SIZE; i++, x = x * 1103515245u + 12345u)
+    cmd[i] = x >> 24;
+}
+
+static int bot_run(const char *server, int seconds)
+{
+  struct addrinfo hints, *res;
+  struct sockaddr_in relay_addr, from;
+  char host[64];
+  const char *colon = strrchr(server, ':');
+  int port = colon ? atoi(colon + 1) : DEFAULT_PORT;
+  size_t hostlen = colon ? (size_t)(colon - server) : strlen(server);
+  uint8_t buf[MAX_PACKET];
+  uint8_t cmds[BACKUPTICS][MAXPLAYERS][TICCMD_SIZE];
+  uint64_t made_us[BACKUPTICS];
+  int me = -1, players = 0, extratic = 0;
+  unsigned maketic = 0, gametic = 0, remotetic = 0, remotesend = 0;
+  unsigned verified = 0, mismatches = 0, packets_in = 0, packets_out = 0;
+  uint64_t bytes_in = 0, bytes_out = 0, rtt_sum = 0, rtt_max = 0, rtt_count = 0;
+  uint64_t start, lastmade, laststep;
+  ssize_t len;
+
+  if (hostlen >= sizeof host)
+    return 1;
+  memcpy(host, server, hostlen);
+  host[hostlen] = 0;
+  memset(&hints, 0, sizeof hints);
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host, NULL, &hints, &res) != 0) {
+    fprintf(stderr, "cannot resolve %s\n", host);
+    return 1;
+  }
+  relay_addr = *(struct sockaddr_in *)res->ai_addr;
+  relay_addr.sin_port = htons(port);
+  freeaddrinfo(res);
+
+  /* Join: PKT_INIT until PKT_SETUP, then PKT_GO until PKT_GO */
+  while (me < 0 && !quit_requested) {
+    packet_set(buf, PKT_INIT, 0);
+    buf[HEADER_SIZE] = buf[HEADER_SIZE + 1] = 0;
+    send_packet(buf, HEADER_SIZE + 2, &relay_addr);
+    wait_readable(500);
+    while ((len = recv_packet(buf, sizeof buf, &from)) > 0)
+      if (buf[1] == PKT_SETUP && len >= (ssize_t)(HEADER_SIZE + 9)) {
+        players = buf[HEADER_SIZE];
+        me = buf[HEADER_SIZE + 1];
+        extratic = buf[HEADER_SIZE + 8];
+      }
+  }
+  if (me < 0)
+    return 1;
+  printf("joined as player %d/%d, extratic %d\n", me + 1, players, extratic);
+  fflush(stdout);
+  for (;;) {
+    if (quit_requested)
+      return 1;
+    packet_set(buf, PKT_GO, 0);
+    buf[HEADER_SIZE] = me;
+    send_packet(buf, HEADER_SIZE + 1, &relay_addr);
+    wait_readable(100);
+    if ((len = recv_packet(buf, sizeof buf, &from)) > 0 && buf[1] == PKT_GO)
+      break;
+  }
+
+  start = lastmade = laststep = now_us();
+  while (!quit_requested && now_us() - start < (uint64_t)seconds * 1000000) {
+    unsigned newtics;
+
+    /* Receive, as NetUpdate does */
+    while ((len = recv_packet(buf, sizeof buf, &from)) > 0) {
+      bytes_in += len;
+      packets_in++;
+      if (buf[1] == PKT_TICS) {
+        const uint8_t *p = buf + HEADER_SIZE + 1;
+        const uint8_t *end = buf + len;
+        unsigned ptic = packet_tic(buf), tics = buf[HEADER_SIZE];
+        unsigned first = remotetic;
+
+        if (ptic > remotetic) {
+          packet_set(buf, PKT_RETRANS, remotetic);
+          buf[HEADER_SIZE] = me;
+          bytes_out += send_packet(buf, HEADER_SIZE + 1, &relay_addr);
+          packets_out++;
+          continue;
+        }
+        if (ptic + tics <= remotetic)
+          continue;
+        remotetic = ptic;
+        while (tics-- && p < end) {
+          int n = *p++;
+          while (n-- && p + 1 + TICCMD_SIZE <= end) {
+            int pl = *p++;
+            if (pl < MAXPLAYERS)
+              memcpy(cmds[remotetic % BACKUPTICS][pl], p, TICCMD_SIZE);
+            p += TICCMD_SIZE;
+          }
+          if (remotetic >= first) {
+            uint64_t rtt = now_us() - made_us[remotetic % BACKUPTICS];
+            rtt_sum += rtt;
+            rtt_count++;
+            if (rtt > rtt_max)
+              rtt_max = rtt;
+          }
+          remotetic++;
+        }
+      } else if (buf[1] == PKT_RETRANS) {
+        remotesend = packet_tic(buf);
+      } else if (buf[1] == PKT_BACKOFF) {
+        lastmade += 1000000 / TICRATE;
+      } else if (buf[1] == PKT_QUIT) {
+        printf("player %d left at tic %u\n", buf[HEADER_SIZE] + 1, packet_tic(buf));
+      } else if (buf[1] == PKT_DOWN) {
+        printf("relay went down\n");
+        quit_requested = 1;
+      }
+    }
+
+    /* Make tics on the 35 Hz clock */
+    newtics = (now_us() - lastmade) * TICRATE / 1000000;
+    lastmade += (uint64_t)newtics * 1000000 / TICRATE;
+    while (newtics-- && maketic - gametic <= BACKUPTICS / 2) {
+      bot_cmd(cmds[maketic % BACKUPTICS][me], me, maketic);
+      made_us[maketic % BACKUPTICS] = now_us();
+      maketic++;
+    }
+
+    if (maketic > remotesend) {
+      uint8_t *o = buf + HEADER_SIZE + 2;
+      unsigned sendtics;
+
+      remotesend = remotesend > (unsigned)extratic ? remotesend - extratic : 0;
+      sendtics = maketic - remotesend;
+      packet_set(buf, PKT_TICC, remotesend);
+      buf[HEADER_SIZE] = sendtics;
+      buf[HEADER_SIZE + 1] = me;
+      while (sendtics--) {
+        bot_cmd(o, me, remotesend++);
+        o += TICCMD_SIZE;
+      }
+      bytes_out += send_packet(buf, o - buf, &relay_addr);
+      packets_out++;
+    }
+
+    /* Run tics, checking everybody's commands */
+    while (gametic < remotetic) {
+      int pl;
+      for (pl = 0; pl < players; pl++) {
+        uint8_t expect[TICCMD_SIZE];
+        bot_cmd(expect, pl, gametic);
+        if (!memcmp(expect, cmds[gametic % BACKUPTICS][pl], TICCMD_SIZE))
+          verified++;
+        else
+          mismatches++;
+        memset(cmds[gametic % BACKUPTICS][pl], 0, TICCMD_SIZE);
+      }
+      gametic++;
+      laststep = now_us();
+    }
+
+    /* Stalled: ask again, like TryRunTics after 10 tics */
+    if (now_us() - laststep > 10 * 1000000 / TICRATE) {
+      if (remotesend)
+        remotesend--;
+      packet_set(buf, PKT_RETRANS, remotetic);
+      buf[HEADER_SIZE] = me;
+      bytes_out += send_packet(buf, HEADER_SIZE + 1, &relay_addr);
+      packets_out++;
+      laststep = now_us();
+    }
+
+    wait_readable(1000 / TICRATE / 2);
+  }
+
+  packet_set(buf, PKT_QUIT, gametic);
+  buf[HEADER_SIZE] = me;
+  for (len = 0; len < 4; len++) {
+    send_packet(buf, HEADER_SIZE + 1, &relay_addr);
+    usleep(10000);
+  }
+
+  {
+    double elapsed = (now_us() - start) / 1e6;
+    printf("player %d: %u tics in %.1f s, %u commands verified, %u wrong\n",
+           me + 1, gametic, elapsed, verified, mismatches);
+    printf("player %d: tic round trip avg %.1f ms max %.1f ms, %.0f B/s out %.0f B/s in, %u/%u packets\n",
+           me + 1, rtt_count ? rtt_sum / 1000.0 / rtt_count : 0.0, rtt_max / 1000.0,
+           bytes_out / elapsed, bytes_in / elapsed, packets_out, packets_in);
+  }
+  return mismatches != 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *connect_to = NULL;
+  int port = DEFAULT_PORT, interval = 5, seconds = 30;
+  int i;
+
+  relay.players = 2;
+  relay.extratic = 1;
+  relay.complevel = 3;
+  relay.skill = 2;
+  relay.episode = 1;
+  relay.level = 1;
+
+  for (i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+    if (!val)
+      goto usage;
+    if (!strcmp(arg, "-p")) port = atoi(val);
+    else if (!strcmp(arg, "-N")) relay.players = atoi(val);
+    else if (!strcmp(arg, "-x")) relay.extratic = atoi(val);
+    else if (!strcmp(arg, "-c")) relay.complevel = atoi(val);
+    else if (!strcmp(arg, "-s")) relay.skill = atoi(val) - 1;
+    else if (!strcmp(arg, "-e")) relay.episode = atoi(val);
+    else if (!strcmp(arg, "-l")) relay.level = atoi(val);
+    else if (!strcmp(arg, "-d")) relay.deathmatch = atoi(val);
+    else if (!strcmp(arg, "-i")) interval = atoi(val);
+    else if (!strcmp(arg, "-loss")) loss_percent = atoi(val);
+    else if (!strcmp(arg, "-connect")) connect_to = val;
+    else if (!strcmp(arg, "-time")) seconds = atoi(val);
+    else goto usage;
+    i++;
+  }
+  if (relay.players < 1 || relay.players > MAXPLAYERS || relay.extratic < 0 ||
+      relay.extratic >= MAX_SEND_TICS || interval < 1)
+    goto usage;
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  srand((unsigned)now_us());
+  relay.rngseed = (unsigned)time(NULL);
+  sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    perror("socket");
+    return 1;
+  }
+  return connect_to ? bot_run(connect_to, seconds) : relay_run(port, interval);
+
+usage:
+  fprintf(stderr, "usage: %s [-p port] [-N players] [-x extratic] [-c complevel] [-s skill]\n"
+                  "          [-e episode] [-l level] [-d deathmatch] [-i seconds] [-loss percent]\n"
+                  "       %s -connect host[:port] [-time seconds] [-loss percent]\n", argv[0], argv[0]);
+  return 2;
+}